@@ -22,6 +22,10 @@
 #include "config.h"
 
 #include <vector>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include <cstring>
 
 #include <gta/gta.hpp>
 
@@ -229,6 +233,327 @@ static void combine(gta::type t, combine_mode_t mode, bool force, size_t n, cons
     }
 }
 
+/* Block kernels. A kernel combines one component of a block of elements from
+ * all inputs into an accumulator array, in the same order of operations as
+ * combine(). Integer kernels do not throw on overflow: they only record that
+ * it happened, and the caller then recomputes the block with combine(), which
+ * implements the exact error and clamping behaviour. */
+
+typedef bool (*combine_kernel_t)(size_t inputs, const unsigned char *const *src, size_t stride,
+        void *acc, unsigned char *dst, size_t n);
+
+template<typename T, typename OP>
+static inline bool accumulate(size_t inputs, const unsigned char *const *src, size_t stride,
+        T *acc, size_t n)
+{
+    OP op;
+    bool overflow = false;
+    for (size_t k = 0; k < n; k++)
+    {
+        std::memcpy(acc + k, src[0] + k * stride, sizeof(T));
+    }
+    for (size_t i = 1; i < inputs; i++)
+    {
+        const unsigned char *s = src[i];
+        for (size_t k = 0; k < n; k++)
+        {
+            T v;
+            std::memcpy(&v, s + k * stride, sizeof(T));
+            acc[k] = op(acc[k], v, overflow);
+        }
+    }
+    return !overflow;
+}
+
+template<typename T, typename OP>
+static bool combine_kernel(size_t inputs, const unsigned char *const *src, size_t stride,
+        void *acc, unsigned char *dst, size_t n)
+{
+    T *a = static_cast<T *>(acc);
+    bool ok = (stride == sizeof(T)
+            ? accumulate<T, OP>(inputs, src, sizeof(T), a, n)
+            : accumulate<T, OP>(inputs, src, stride, a, n));
+    if (ok)
+    {
+        for (size_t k = 0; k < n; k++)
+        {
+            std::memcpy(dst + k * stride, a + k, sizeof(T));
+        }
+    }
+    return ok;
+}
+
+template<typename T>
+struct min_op
+{
+    T operator()(T r, T s, bool &) const
+    {
+        return (s < r ? s : r);
+    }
+};
+
+template<typename T>
+struct max_op
+{
+    T operator()(T r, T s, bool &) const
+    {
+        return (s > r ? s : r);
+    }
+};
+
+template<typename T>
+static inline bool is_negative(T x)
+{
+    return (static_cast<typename std::make_signed<T>::type>(x) < 0);
+}
+
+// Integer arithmetic wraps around in the unsigned type; overflow is detected
+// from the operands and the result.
+template<typename T>
+struct int_add_op
+{
+    T operator()(T r, T s, bool &overflow) const
+    {
+        typedef typename std::make_unsigned<T>::type U;
+        T t = static_cast<T>(static_cast<U>(r) + static_cast<U>(s));
+        overflow |= (std::numeric_limits<T>::is_signed ? is_negative<T>((r ^ t) & (s ^ t)) : t < r);
+        return t;
+    }
+};
+
+template<typename T>
+struct int_sub_op
+{
+    T operator()(T r, T s, bool &overflow) const
+    {
+        typedef typename std::make_unsigned<T>::type U;
+        T t = static_cast<T>(static_cast<U>(r) - static_cast<U>(s));
+        overflow |= (std::numeric_limits<T>::is_signed ? is_negative<T>((r ^ s) & (r ^ t)) : r < s);
+        return t;
+    }
+};
+
+// Types of up to 32 bits are multiplied in 64 bits. For wider types, the
+// product is checked by division, which does not vectorize anyway.
+template<typename T>
+struct int_mul_op
+{
+    T operator()(T r, T s, bool &overflow) const
+    {
+        if (sizeof(T) <= 4)
+        {
+            typedef typename std::conditional<std::numeric_limits<T>::is_signed, int64_t, uint64_t>::type W;
+            W w = static_cast<W>(r) * static_cast<W>(s);
+            overflow |= (w < static_cast<W>(std::numeric_limits<T>::min())
+                    || w > static_cast<W>(std::numeric_limits<T>::max()));
+            return static_cast<T>(w);
+        }
+        else
+        {
+            typedef typename std::make_unsigned<T>::type U;
+            T t = static_cast<T>(static_cast<U>(r) * static_cast<U>(s));
+            if (std::numeric_limits<T>::is_signed && (r == static_cast<T>(-1) || s == static_cast<T>(-1)))
+                overflow |= (r == std::numeric_limits<T>::min() || s == std::numeric_limits<T>::min());
+            else
+                overflow |= (r != static_cast<T>(0) && t / r != s);
+            return t;
+        }
+    }
+};
+
+template<typename T>
+struct int_div_op
+{
+    T operator()(T r, T s, bool &overflow) const
+    {
+        bool bad = (s == static_cast<T>(0)
+                || (std::numeric_limits<T>::is_signed
+                    && r == std::numeric_limits<T>::min() && s == static_cast<T>(-1)));
+        overflow |= bad;
+        return (bad ? r : r / s);
+    }
+};
+
+template<typename T>
+struct float_add_op
+{
+    T operator()(T r, T s, bool &) const
+    {
+        return r + s;
+    }
+};
+
+template<typename T>
+struct float_sub_op
+{
+    T operator()(T r, T s, bool &) const
+    {
+        return r - s;
+    }
+};
+
+template<typename T>
+struct float_mul_op
+{
+    T operator()(T r, T s, bool &) const
+    {
+        return r * s;
+    }
+};
+
+template<typename T>
+struct float_div_op
+{
+    T operator()(T r, T s, bool &) const
+    {
+        return r / s;
+    }
+};
+
+template<typename T>
+struct or_op
+{
+    T operator()(T r, T s, bool &) const
+    {
+        return r | s;
+    }
+};
+
+template<typename T>
+struct and_op
+{
+    T operator()(T r, T s, bool &) const
+    {
+        return r & s;
+    }
+};
+
+template<typename T>
+struct xor_op
+{
+    T operator()(T r, T s, bool &) const
+    {
+        return r ^ s;
+    }
+};
+
+template<typename T>
+static combine_kernel_t int_kernel(combine_mode_t mode)
+{
+    switch (mode)
+    {
+    case mode_min:
+        return combine_kernel<T, min_op<T> >;
+    case mode_max:
+        return combine_kernel<T, max_op<T> >;
+    case mode_add:
+        return combine_kernel<T, int_add_op<T> >;
+    case mode_sub:
+        return combine_kernel<T, int_sub_op<T> >;
+    case mode_mul:
+        return combine_kernel<T, int_mul_op<T> >;
+    case mode_div:
+        return combine_kernel<T, int_div_op<T> >;
+    default:
+        return NULL;
+    }
+}
+
+template<typename T>
+static combine_kernel_t float_kernel(combine_mode_t mode)
+{
+    switch (mode)
+    {
+    case mode_min:
+        return combine_kernel<T, min_op<T> >;
+    case mode_max:
+        return combine_kernel<T, max_op<T> >;
+    case mode_add:
+        return combine_kernel<T, float_add_op<T> >;
+    case mode_sub:
+        return combine_kernel<T, float_sub_op<T> >;
+    case mode_mul:
+        return combine_kernel<T, float_mul_op<T> >;
+    case mode_div:
+        return combine_kernel<T, float_div_op<T> >;
+    default:
+        return NULL;
+    }
+}
+
+template<typename T>
+static combine_kernel_t bit_kernel(combine_mode_t mode)
+{
+    switch (mode)
+    {
+    case mode_or:
+        return combine_kernel<T, or_op<T> >;
+    case mode_and:
+        return combine_kernel<T, and_op<T> >;
+    case mode_xor:
+        return combine_kernel<T, xor_op<T> >;
+    default:
+        return NULL;
+    }
+}
+
+/* Select the kernel for a component type, with the same dispatch as
+ * combine(). Returns NULL if there is none; combine() is used then. */
+static combine_kernel_t kernel(gta::type t, combine_mode_t mode)
+{
+    if (mode == mode_and || mode == mode_or || mode == mode_xor)
+    {
+        if (t == gta::int8 || t == gta::uint8)
+            return bit_kernel<uint8_t>(mode);
+        else if (t == gta::int16 || t == gta::uint16)
+            return bit_kernel<uint16_t>(mode);
+        else if (t == gta::int32 || t == gta::uint32 || t == gta::float32)
+            return bit_kernel<uint32_t>(mode);
+        else if (t == gta::int64 || t == gta::uint64 || t == gta::float64)
+            return bit_kernel<uint64_t>(mode);
+#ifdef HAVE_UINT128_T
+        else if (t == gta::int128 || t == gta::uint128 || t == gta::float128)
+            return bit_kernel<uint128_t>(mode);
+#endif
+    }
+    else
+    {
+        if (t == gta::int8)
+            return int_kernel<int8_t>(mode);
+        else if (t == gta::uint8)
+            return int_kernel<uint8_t>(mode);
+        else if (t == gta::int16)
+            return int_kernel<int16_t>(mode);
+        else if (t == gta::uint16)
+            return int_kernel<uint16_t>(mode);
+        else if (t == gta::int32)
+            return int_kernel<int32_t>(mode);
+        else if (t == gta::uint32)
+            return int_kernel<uint32_t>(mode);
+        else if (t == gta::int64)
+            return int_kernel<int64_t>(mode);
+        else if (t == gta::uint64)
+            return int_kernel<uint64_t>(mode);
+#ifdef HAVE_INT128_T
+        else if (t == gta::int128)
+            return int_kernel<int128_t>(mode);
+#endif
+#ifdef HAVE_UINT128_T
+        else if (t == gta::uint128)
+            return int_kernel<uint128_t>(mode);
+#endif
+        else if (t == gta::float32)
+            return float_kernel<float>(mode);
+        else if (t == gta::float64)
+            return float_kernel<double>(mode);
+#ifdef HAVE_FLOAT128_T
+        else if (t == gta::float128)
+            return float_kernel<float128_t>(mode);
+#endif
+    }
+    return NULL;
+}
+
 extern "C" int gtatool_combine(int argc, char *argv[])
 {
     std::vector<opt::option *> options;
@@ -358,34 +683,54 @@ extern "C" int gtatool_combine(int argc, char *argv[])
             {
                 array_loops[i].start_element_loop(element_loops[i], hdri[i], hdro);
             }
-            blob element_buf(checked_cast<size_t>(hdro.element_size()));
+            const size_t max_block_bytes = 64 * 1024;
+            const size_t element_size = checked_cast<size_t>(hdro.element_size());
+            size_t block_elements = std::max(static_cast<uintmax_t>(1),
+                    std::min(hdro.elements(), static_cast<uintmax_t>(max_block_bytes / element_size)));
+            blob block_buf(block_elements, element_size);
             std::vector<size_t> component_offsets(hdro.components());
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            std::vector<combine_kernel_t> kernels(hdro.components());
+            size_t max_component_size = 1;
+            for (uintmax_t c = 0; c < hdro.components(); c++)
             {
-                for (uintmax_t c = 0; c < hdro.components(); c++)
-                {
-                    component_offsets[c] = static_cast<const char*>(hdro.component(element_buf.ptr(), c))
-                        - element_buf.ptr<const char>();
-                }
+                component_offsets[c] = static_cast<const char*>(hdro.component(block_buf.ptr(), c))
+                    - block_buf.ptr<const char>();
+                kernels[c] = kernel(hdro.component_type(c), m);
+                max_component_size = std::max(max_component_size, checked_cast<size_t>(hdro.component_size(c)));
             }
-            std::vector<const void*> element_ptrs(arguments.size());
+            blob acc(block_elements, max_component_size);
+            std::vector<const unsigned char*> block_ptrs(arguments.size());
+            std::vector<const unsigned char*> src(arguments.size());
             std::vector<const void*> component_ptrs(arguments.size());
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            for (uintmax_t e = 0; e < hdro.elements(); e += block_elements)
             {
+                size_t n = std::min(hdro.elements() - e, static_cast<uintmax_t>(block_elements));
                 for (size_t i = 0; i < arguments.size(); i++)
                 {
-                    element_ptrs[i] = element_loops[i].read();
+                    block_ptrs[i] = static_cast<const unsigned char*>(element_loops[i].read(n));
                 }
                 for (uintmax_t c = 0; c < hdro.components(); c++)
                 {
+                    unsigned char *dst = block_buf.ptr<unsigned char>(component_offsets[c]);
                     for (size_t i = 0; i < arguments.size(); i++)
                     {
-                        component_ptrs[i] = static_cast<const char*>(element_ptrs[i]) + component_offsets[c];
+                        src[i] = block_ptrs[i] + component_offsets[c];
+                    }
+                    if (kernels[c] && kernels[c](arguments.size(), &src[0], element_size, acc.ptr(), dst, n))
+                    {
+                        continue;
+                    }
+                    for (size_t k = 0; k < n; k++)
+                    {
+                        for (size_t i = 0; i < arguments.size(); i++)
+                        {
+                            component_ptrs[i] = src[i] + k * element_size;
+                        }
+                        combine(hdro.component_type(c), m, force.value(), arguments.size(), &component_ptrs[0],
+                                static_cast<void*>(dst + k * element_size));
                     }
-                    combine(hdro.component_type(c), m, force.value(), arguments.size(), &component_ptrs[0],
-                            static_cast<void*>(element_buf.ptr<char>(component_offsets[c])));
                 }
-                element_loops[0].write(element_buf.ptr());
+                element_loops[0].write(block_buf.ptr(), n);
             }
         }
         array_loops[0].finish();
@@ -24,7 +24,13 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <cstring>
 #include <limits>
+#include <algorithm>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <gta/gta.hpp>
 
@@ -33,6 +39,7 @@
 #include "base/opt.h"
 #include "base/str.h"
 #include "base/chk.h"
+#include "base/fio.h"
 
 #include "lib.h"
 
@@ -48,10 +55,53 @@ extern "C" void gtatool_create_help(void)
             "The dimensions and components must be given as comma-separated lists. "
             "An initial value for all array elements can be given as a comma-separated list, "
             "with one entry for each element component. "
-            "The default initial value is zero for all element components.\n"
+            "The default initial value is zero for all element components. "
+            "Zero-filled data written to a regular file is created as a sparse "
+            "region where the file system supports this, which makes it cheap to "
+            "allocate large arrays that are later modified in place.\n"
             "Example: -d 256,128 -c uint8,uint8,uint8 -v 32,64,128");
 }
 
+/* Try to write zero-filled array data of the given size by extending the
+ * output file, so that the data becomes a hole that the file system does not
+ * need to allocate. This only works if the output is a regular file and we
+ * are at its end. Returns false if the data still needs to be written.
+ * The data counts as written in the statistics. */
+static bool write_zero_data_sparse(FILE *f, uintmax_t size)
+{
+#if HAVE_FTRUNCATE
+    stats_t &stats = stats_t::current();
+    double t = stats_t::now();
+    struct stat st;
+    fio::flush(f);
+    if (size == 0 || fstat(fileno(f), &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        return false;
+    }
+    off_t pos = fio::tell(f);
+    if (pos < 0 || st.st_size != pos
+            || size > static_cast<uintmax_t>(std::numeric_limits<off_t>::max() - pos))
+    {
+        return false;
+    }
+    if (ftruncate(fileno(f), pos + static_cast<off_t>(size)) != 0)
+    {
+        return false;
+    }
+    fio::seek(f, 0, SEEK_END);
+    if (stats.enabled)
+    {
+        stats.io_time += stats_t::now() - t;
+        stats.data_bytes_out += size;
+    }
+    return true;
+#else
+    (void)f;
+    (void)size;
+    return false;
+#endif
+}
+
 extern "C" int gtatool_create(int argc, char *argv[])
 {
     std::vector<opt::option *> options;
@@ -101,15 +151,50 @@ extern "C" int gtatool_create(int argc, char *argv[])
         {
             valuelist_from_string(value.value(), comp_types, comp_sizes, v.ptr());
         }
+        bool zero = true;
+        for (size_t i = 0; i < v.size(); i++)
+        {
+            if (v.ptr<unsigned char>()[i] != 0)
+            {
+                zero = false;
+                break;
+            }
+        }
+        /* Replicate the value into a buffer of up to 1 MiB so that the data
+         * can be written in large pieces. */
+        size_t buf_elements = 1;
+        if (hdr.element_size() > 0)
+        {
+            buf_elements = std::max(static_cast<uintmax_t>(1), std::min(hdr.elements(),
+                        static_cast<uintmax_t>(1024 * 1024) / hdr.element_size()));
+        }
+        blob buf;
         array_loop.start(std::vector<std::string>(), arguments.size() == 1 ? arguments[0] : "");
         for (uintmax_t i = 0; i < n.value(); i++)
         {
             array_loop.write(hdr, name);
+            if (hdr.compression() == gta::none && zero
+                    && write_zero_data_sparse(array_loop.file_out(), hdr.data_size()))
+            {
+                gtatool_progress.elements_written(array_loop.file_out(), hdr.elements());
+                continue;
+            }
+            if (buf.size() == 0)
+            {
+                buf.resize(buf_elements, v.size());
+                for (size_t j = 0; j < buf_elements; j++)
+                {
+                    std::memcpy(buf.ptr(j * v.size()), v.ptr(), v.size());
+                }
+            }
             element_loop_t element_loop;
             array_loop.start_element_loop(element_loop, gta::header(), hdr);
-            for (uintmax_t j = 0; j < hdr.elements(); j++)
+            uintmax_t remaining = hdr.elements();
+            while (remaining > 0)
             {
-                element_loop.write(v.ptr());
+                size_t k = std::min(remaining, static_cast<uintmax_t>(buf_elements));
+                element_loop.write(buf.ptr(), k);
+                remaining -= k;
             }
         }
         array_loop.finish();
@@ -22,6 +22,10 @@
 #include "config.h"
 
 #include <cmath>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
 
 #include <gta/gta.hpp>
 
@@ -29,6 +33,7 @@
 #include "base/opt.h"
 #include "base/fio.h"
 #include "base/chk.h"
+#include "base/str.h"
 
 #include "lib.h"
 
@@ -36,7 +41,7 @@
 extern "C" void gtatool_diff_help(void)
 {
     msg::req_txt(
-            "diff [-a|--absolute] [-f|--force] <file0> <file1>\n"
+            "diff [-a|--absolute] [-f|--force] [-s|--stats] [-q|--quiet] [-j|--jobs=<n>] <file0> <file1>\n"
             "\n"
             "Compute the differences between two GTA streams.\n"
             "The GTAs must be compatible in dimensions and component types. This command produces "
@@ -48,6 +53,13 @@ extern "C" void gtatool_diff_help(void)
             "in the given component type (e.g. 10 - 20 in uint8), this command will abort by default. "
             "Use -f to force clamping of values to the representable range instead, or use the "
             "component-convert command to work with different component types.\n"
+            "With -s or -q, no output GTAs are produced. Instead, -s prints for each pair of arrays the number "
+            "of differing elements and, for each component, the maximum absolute error, the root mean square "
+            "error, and the peak signal-to-noise ratio. The peak value is the range of the component type for "
+            "integer types, and the largest finite absolute input value for floating point types. "
+            "With -q, nothing is printed. In both modes, the exit status is 0 if all arrays are equal, "
+            "1 if they differ, and 2 on errors, including invalid command lines.\n"
+            "The computation uses n threads; the default is the number of processors.\n"
             "Example: diff a.gta b.gta > diff.gta");
 }
 
@@ -167,6 +179,454 @@ static void diff(gta::type t, bool absolute, bool force, const void* c0, const v
 #endif
 }
 
+/* Block kernels for the difference arrays. They compute the same results as
+ * diff(), but do not throw on overflow: they only record that it happened,
+ * and the caller then recomputes the block with diff(), which implements the
+ * exact error and clamping behaviour. */
+
+typedef bool (*diff_kernel_t)(const unsigned char *x, const unsigned char *y, size_t stride,
+        unsigned char *d, size_t n);
+
+template<typename T, typename OP>
+static inline bool diff_rows(const unsigned char *x, const unsigned char *y, size_t stride,
+        unsigned char *d, size_t n)
+{
+    OP op;
+    bool overflow = false;
+    for (size_t k = 0; k < n; k++)
+    {
+        T a, b, z;
+        std::memcpy(&a, x + k * stride, sizeof(T));
+        std::memcpy(&b, y + k * stride, sizeof(T));
+        z = op(a, b, overflow);
+        std::memcpy(d + k * stride, &z, sizeof(T));
+    }
+    return !overflow;
+}
+
+template<typename T, typename OP>
+static bool diff_kernel(const unsigned char *x, const unsigned char *y, size_t stride,
+        unsigned char *d, size_t n)
+{
+    return (stride == sizeof(T)
+            ? diff_rows<T, OP>(x, y, sizeof(T), d, n)
+            : diff_rows<T, OP>(x, y, stride, d, n));
+}
+
+template<typename T, bool ABS>
+struct signed_int_diff_op
+{
+    T operator()(T x, T y, bool &overflow) const
+    {
+        typedef typename std::make_unsigned<T>::type U;
+        T z = static_cast<T>(static_cast<U>(x) - static_cast<U>(y));
+        overflow |= (((x ^ y) & (x ^ z)) < 0);
+        if (ABS)
+        {
+            overflow |= (z == std::numeric_limits<T>::min());
+            z = (z < 0 ? static_cast<T>(-static_cast<U>(z)) : z);
+        }
+        return z;
+    }
+};
+
+template<typename T, bool ABS>
+struct unsigned_int_diff_op
+{
+    T operator()(T x, T y, bool &overflow) const
+    {
+        if (ABS)
+        {
+            return (x > y ? x - y : y - x);
+        }
+        else
+        {
+            overflow |= (x < y);
+            return x - y;
+        }
+    }
+};
+
+template<typename T, bool ABS>
+struct float_diff_op
+{
+    T operator()(T x, T y, bool &) const
+    {
+        T z = x - y;
+        return (ABS ? std::abs(z) : z);
+    }
+};
+
+template<typename T>
+static diff_kernel_t signed_int_diff_kernel(bool absolute)
+{
+    return (absolute ? diff_kernel<T, signed_int_diff_op<T, true> > : diff_kernel<T, signed_int_diff_op<T, false> >);
+}
+
+template<typename T>
+static diff_kernel_t unsigned_int_diff_kernel(bool absolute)
+{
+    return (absolute ? diff_kernel<T, unsigned_int_diff_op<T, true> > : diff_kernel<T, unsigned_int_diff_op<T, false> >);
+}
+
+template<typename T>
+static diff_kernel_t float_diff_kernel(bool absolute)
+{
+    return (absolute ? diff_kernel<T, float_diff_op<T, true> > : diff_kernel<T, float_diff_op<T, false> >);
+}
+
+/* Select the kernel for a component type, with the same dispatch as diff().
+ * Returns NULL if there is none; diff() is used then. */
+static diff_kernel_t diff_kernel_for(gta::type t, bool absolute)
+{
+    if (t == gta::int8)
+        return signed_int_diff_kernel<int8_t>(absolute);
+    else if (t == gta::uint8)
+        return unsigned_int_diff_kernel<uint8_t>(absolute);
+    else if (t == gta::int16)
+        return signed_int_diff_kernel<int16_t>(absolute);
+    else if (t == gta::uint16)
+        return unsigned_int_diff_kernel<uint16_t>(absolute);
+    else if (t == gta::int32)
+        return signed_int_diff_kernel<int32_t>(absolute);
+    else if (t == gta::uint32)
+        return unsigned_int_diff_kernel<uint32_t>(absolute);
+    else if (t == gta::int64)
+        return signed_int_diff_kernel<int64_t>(absolute);
+    else if (t == gta::uint64)
+        return unsigned_int_diff_kernel<uint64_t>(absolute);
+#ifdef HAVE_INT128_T
+    else if (t == gta::int128)
+        return signed_int_diff_kernel<int128_t>(absolute);
+#endif
+#ifdef HAVE_UINT128_T
+    else if (t == gta::uint128)
+        return unsigned_int_diff_kernel<uint128_t>(absolute);
+#endif
+    else if (t == gta::float32)
+        return float_diff_kernel<float>(absolute);
+    else if (t == gta::float64)
+        return float_diff_kernel<double>(absolute);
+    return NULL;
+}
+
+/* Summary statistics of the differences in one component. Differences are
+ * computed in double precision. Pairs with a NaN difference do not contribute
+ * to the errors. Squares of large differences overflow double precision, so
+ * the differences are divided by a power of two before they are squared. */
+
+/* Return the power of two by which differences up to max_abs are divided
+ * before squaring: 1 for small or infinite values, so that no precision is
+ * lost where it is not necessary. */
+static double sq_scale(double max_abs)
+{
+    if (!(max_abs > 1.0) || !std::isfinite(max_abs))
+        return 1.0;
+    int e;
+    std::frexp(max_abs, &e);
+    return std::ldexp(1.0, e);
+}
+
+struct diff_stats_t
+{
+    uintmax_t valid;            // number of value pairs with a non-NaN difference
+    double max_abs_error;
+    double scale;               // the squared errors are those of the differences divided by scale
+    double sum_sq_error;
+    double peak;                // largest finite absolute input value
+
+    diff_stats_t() : valid(0), max_abs_error(0.0), scale(1.0), sum_sq_error(0.0), peak(0.0)
+    {
+    }
+
+    void add(const diff_stats_t &s)
+    {
+        valid += s.valid;
+        max_abs_error = std::max(max_abs_error, s.max_abs_error);
+        if (s.scale > scale)
+        {
+            double f = scale / s.scale;
+            sum_sq_error = sum_sq_error * f * f + s.sum_sq_error;
+            scale = s.scale;
+        }
+        else
+        {
+            double f = s.scale / scale;
+            sum_sq_error += s.sum_sq_error * f * f;
+        }
+        peak = std::max(peak, s.peak);
+    }
+
+    double root_mean_square_error() const
+    {
+        if (std::isinf(max_abs_error))
+            return max_abs_error;
+        return scale * std::sqrt(sum_sq_error / valid);
+    }
+};
+
+typedef void (*stats_kernel_t)(const unsigned char *x, const unsigned char *y, size_t stride,
+        size_t n, unsigned char *differs, diff_stats_t &stats);
+
+template<typename T>
+static void int_stats_kernel(const unsigned char *x, const unsigned char *y, size_t stride,
+        size_t n, unsigned char *differs, diff_stats_t &stats)
+{
+    double max_abs_error = 0.0;
+    for (size_t k = 0; k < n; k++)
+    {
+        T a, b;
+        std::memcpy(&a, x + k * stride, sizeof(T));
+        std::memcpy(&b, y + k * stride, sizeof(T));
+        double ad = std::fabs(static_cast<double>(a) - static_cast<double>(b));
+        differs[k] |= (a != b);
+        max_abs_error = (ad > max_abs_error ? ad : max_abs_error);
+    }
+    double scale = sq_scale(max_abs_error);
+    double inv_scale = 1.0 / scale;
+    double sum_sq_error = 0.0;
+    for (size_t k = 0; k < n; k++)
+    {
+        T a, b;
+        std::memcpy(&a, x + k * stride, sizeof(T));
+        std::memcpy(&b, y + k * stride, sizeof(T));
+        double d = (static_cast<double>(a) - static_cast<double>(b)) * inv_scale;
+        sum_sq_error += d * d;
+    }
+    stats.valid = n;
+    stats.max_abs_error = max_abs_error;
+    stats.scale = scale;
+    stats.sum_sq_error = sum_sq_error;
+}
+
+template<typename T>
+static void float_stats_kernel(const unsigned char *x, const unsigned char *y, size_t stride,
+        size_t n, unsigned char *differs, diff_stats_t &stats)
+{
+    uintmax_t valid = 0;
+    double max_abs_error = 0.0;
+    double peak = 0.0;
+    for (size_t k = 0; k < n; k++)
+    {
+        T a, b;
+        std::memcpy(&a, x + k * stride, sizeof(T));
+        std::memcpy(&b, y + k * stride, sizeof(T));
+        double da = static_cast<double>(a);
+        double db = static_cast<double>(b);
+        double d = da - db;
+        differs[k] |= (a != b && !(a != a && b != b));
+        if (d == d)
+        {
+            double ad = std::fabs(d);
+            valid++;
+            max_abs_error = (ad > max_abs_error ? ad : max_abs_error);
+        }
+        if (std::isfinite(da))
+            peak = std::max(peak, std::fabs(da));
+        if (std::isfinite(db))
+            peak = std::max(peak, std::fabs(db));
+    }
+    double scale = sq_scale(max_abs_error);
+    double inv_scale = 1.0 / scale;
+    double sum_sq_error = 0.0;
+    for (size_t k = 0; k < n; k++)
+    {
+        T a, b;
+        std::memcpy(&a, x + k * stride, sizeof(T));
+        std::memcpy(&b, y + k * stride, sizeof(T));
+        double d = (static_cast<double>(a) - static_cast<double>(b)) * inv_scale;
+        if (d == d)
+            sum_sq_error += d * d;
+    }
+    stats.valid = valid;
+    stats.max_abs_error = max_abs_error;
+    stats.scale = scale;
+    stats.sum_sq_error = sum_sq_error;
+    stats.peak = peak;
+}
+
+static stats_kernel_t stats_kernel_for(gta::type t)
+{
+    if (t == gta::int8)
+        return int_stats_kernel<int8_t>;
+    else if (t == gta::uint8)
+        return int_stats_kernel<uint8_t>;
+    else if (t == gta::int16)
+        return int_stats_kernel<int16_t>;
+    else if (t == gta::uint16)
+        return int_stats_kernel<uint16_t>;
+    else if (t == gta::int32)
+        return int_stats_kernel<int32_t>;
+    else if (t == gta::uint32)
+        return int_stats_kernel<uint32_t>;
+    else if (t == gta::int64)
+        return int_stats_kernel<int64_t>;
+    else if (t == gta::uint64)
+        return int_stats_kernel<uint64_t>;
+#ifdef HAVE_INT128_T
+    else if (t == gta::int128)
+        return int_stats_kernel<int128_t>;
+#endif
+#ifdef HAVE_UINT128_T
+    else if (t == gta::uint128)
+        return int_stats_kernel<uint128_t>;
+#endif
+    else if (t == gta::float32)
+        return float_stats_kernel<float>;
+    else if (t == gta::float64)
+        return float_stats_kernel<double>;
+#ifdef HAVE_FLOAT128_T
+    else if (t == gta::float128)
+        return float_stats_kernel<float128_t>;
+#endif
+    return NULL;
+}
+
+/* Peak value of a component type for the signal-to-noise ratio of integer
+ * types: the range of the type. Returns zero for floating point types, whose
+ * peak value is taken from the data. */
+static double type_peak(gta::type t)
+{
+    switch (t)
+    {
+    case gta::int8:
+    case gta::uint8:
+        return 255.0;
+    case gta::int16:
+    case gta::uint16:
+        return 65535.0;
+    case gta::int32:
+    case gta::uint32:
+        return 4294967295.0;
+    case gta::int64:
+    case gta::uint64:
+        return 18446744073709551615.0;
+    case gta::int128:
+    case gta::uint128:
+        return 340282366920938463463374607431768211455.0;
+    default:
+        return 0.0;
+    }
+}
+
+/* The elements of an array pair are processed in blocks of block_size
+ * elements. Each batch of blocks is distributed over several threads. In
+ * statistics mode, the results are kept per block and added up in block order
+ * afterwards, so that they do not depend on the number of threads. */
+
+static const size_t block_size = 1024;
+
+// Number of blocks that each thread computes in one batch.
+static const size_t blocks_per_job = 64;
+
+struct diff_plan_t
+{
+    bool absolute;
+    bool force;
+    size_t element_size;
+    std::vector<gta::type> types;
+    std::vector<size_t> offsets;
+    std::vector<diff_kernel_t> diff_kernels;    // empty in statistics mode
+    std::vector<stats_kernel_t> stats_kernels;  // empty when producing arrays
+};
+
+/* Process the n elements e0 and e1, starting with block number first_block in
+ * the batch. Difference elements are written to d, and statistics to
+ * stats[block * components + component] and differing[block]. */
+static void diff_blocks(const diff_plan_t &plan, size_t first_block,
+        const unsigned char *e0, const unsigned char *e1, size_t n,
+        unsigned char *d, diff_stats_t *stats, uintmax_t *differing)
+{
+    const size_t components = plan.types.size();
+    std::vector<unsigned char> differs(plan.stats_kernels.empty() ? 0 : block_size);
+    for (size_t b = 0; b * block_size < n; b++)
+    {
+        size_t offset = b * block_size * plan.element_size;
+        size_t m = std::min(n - b * block_size, block_size);
+        if (!plan.stats_kernels.empty())
+        {
+            std::memset(&(differs[0]), 0, m);
+        }
+        for (size_t c = 0; c < components; c++)
+        {
+            const unsigned char *x = e0 + offset + plan.offsets[c];
+            const unsigned char *y = e1 + offset + plan.offsets[c];
+            if (!plan.stats_kernels.empty())
+            {
+                plan.stats_kernels[c](x, y, plan.element_size, m, &(differs[0]),
+                        stats[(first_block + b) * components + c]);
+                continue;
+            }
+            unsigned char *z = d + offset + plan.offsets[c];
+            if (plan.diff_kernels[c] && plan.diff_kernels[c](x, y, plan.element_size, z, m))
+            {
+                continue;
+            }
+            for (size_t k = 0; k < m; k++)
+            {
+                diff(plan.types[c], plan.absolute, plan.force,
+                        x + k * plan.element_size, y + k * plan.element_size, z + k * plan.element_size);
+            }
+        }
+        if (!plan.stats_kernels.empty())
+        {
+            uintmax_t count = 0;
+            for (size_t k = 0; k < m; k++)
+            {
+                count += differs[k];
+            }
+            differing[first_block + b] = count;
+        }
+    }
+}
+
+class diff_job_t : public block_job_t
+{
+public:
+    const diff_plan_t &plan;
+    const unsigned char *e0, *e1;
+    size_t n;
+    unsigned char *d;
+    diff_stats_t *stats;
+    uintmax_t *differing;
+
+    diff_job_t(const diff_plan_t &p) : plan(p), e0(NULL), e1(NULL), n(0), d(NULL), stats(NULL), differing(NULL)
+    {
+    }
+
+    void run(size_t first_block, size_t blocks)
+    {
+        size_t offset = first_block * block_size * plan.element_size;
+        diff_blocks(plan, first_block, e0 + offset, e1 + offset,
+                std::min(n - first_block * block_size, blocks * block_size),
+                d ? d + offset : NULL, stats, differing);
+    }
+};
+
+/* Return whether the command line asks for -s or -q, even if it is invalid
+ * otherwise, so that an invalid command line can be reported with the exit
+ * status of these modes. */
+static bool summary_requested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg(argv[i]);
+        if (arg == "--")
+            break;
+        if (arg == "--stats" || arg == "--quiet")
+            return true;
+        if (arg.length() > 1 && arg[0] == '-' && arg[1] != '-')
+        {
+            for (size_t j = 1; j < arg.length() && arg[j] != 'j'; j++)
+            {
+                if (arg[j] == 's' || arg[j] == 'q')
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
 extern "C" int gtatool_diff(int argc, char *argv[])
 {
     std::vector<opt::option *> options;
@@ -176,10 +636,16 @@ extern "C" int gtatool_diff(int argc, char *argv[])
     options.push_back(&absolute);
     opt::flag force("force", 'f', opt::optional);
     options.push_back(&force);
+    opt::flag stats("stats", 's', opt::optional);
+    options.push_back(&stats);
+    opt::flag quiet("quiet", 'q', opt::optional);
+    options.push_back(&quiet);
+    opt::val<int> jobs("jobs", 'j', opt::optional, 1, 1024, processor_count());
+    options.push_back(&jobs);
     std::vector<std::string> arguments;
     if (!opt::parse(argc, argv, options, 2, 2, arguments))
     {
-        return 1;
+        return (summary_requested(argc, argv) ? 2 : 1);
     }
     if (help.value())
     {
@@ -187,6 +653,9 @@ extern "C" int gtatool_diff(int argc, char *argv[])
         return 0;
     }
 
+    const bool summary = stats.value() || quiet.value();
+    const size_t threads = jobs.value();
+    bool differences = false;
     try
     {
         array_loop_t array_loops[2];
@@ -199,7 +668,10 @@ extern "C" int gtatool_diff(int argc, char *argv[])
         {
             if (!array_loops[1].read(hdri[1], namei[1]))
             {
-                msg::wrn_txt("ignoring additional array(s) from %s", arguments[0].c_str());
+                if (!quiet.value())
+                {
+                    msg::wrn_txt("ignoring additional array(s) from %s", arguments[0].c_str());
+                }
                 break;
             }
 
@@ -253,42 +725,119 @@ extern "C" int gtatool_diff(int argc, char *argv[])
             
             gta::header hdro = hdri[0];
             hdro.set_compression(gta::none);
-            std::string nameo;
-            array_loops[0].write(hdro, nameo);
+            if (!summary)
+            {
+                std::string nameo;
+                array_loops[0].write(hdro, nameo);
+            }
             if (hdri[1].data_size() == 0)
             {
+                if (stats.value())
+                {
+                    msg::req(namei[0] + ":");
+                    msg::req(4, std::string("differing elements: 0 of ") + str::from(hdro.elements()));
+                }
                 continue;
             }
 
             element_loop_t element_loops[2];
             array_loops[0].start_element_loop(element_loops[0], hdri[0], hdro);
             array_loops[1].start_element_loop(element_loops[1], hdri[1], hdro);
-            blob element_buf(checked_cast<size_t>(hdro.element_size()));
-            std::vector<size_t> component_offsets(hdro.components());
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            const size_t batch_size = threads * blocks_per_job * block_size;
+            blob d(summary ? 1 : std::min(hdro.elements(), static_cast<uintmax_t>(batch_size)),
+                    checked_cast<size_t>(hdro.element_size()));
+            diff_plan_t plan;
+            plan.absolute = absolute.value();
+            plan.force = force.value();
+            plan.element_size = checked_cast<size_t>(hdro.element_size());
+            plan.types.resize(hdro.components());
+            plan.offsets.resize(hdro.components());
+            for (uintmax_t c = 0; c < hdro.components(); c++)
+            {
+                plan.types[c] = hdro.component_type(c);
+                plan.offsets[c] = static_cast<const char*>(hdro.component(d.ptr(), c)) - d.ptr<const char>();
+                if (summary)
+                    plan.stats_kernels.push_back(stats_kernel_for(plan.types[c]));
+                else
+                    plan.diff_kernels.push_back(diff_kernel_for(plan.types[c], plan.absolute));
+            }
+            const size_t components = plan.types.size();
+            const size_t batch_blocks = threads * blocks_per_job;
+            std::vector<diff_stats_t> block_stats(summary ? batch_blocks * components : 0);
+            std::vector<uintmax_t> block_differing(summary ? batch_blocks : 0);
+            std::vector<diff_stats_t> array_stats(components);
+            uintmax_t array_differing = 0;
+            diff_job_t job(plan);
+            job.d = (summary ? NULL : d.ptr<unsigned char>());
+            job.stats = (summary ? &(block_stats[0]) : NULL);
+            job.differing = (summary ? &(block_differing[0]) : NULL);
+            for (uintmax_t e = 0; e < hdro.elements(); e += batch_size)
+            {
+                size_t n = checked_cast<size_t>(std::min(hdro.elements() - e, static_cast<uintmax_t>(batch_size)));
+                size_t blocks = (n - 1) / block_size + 1;
+                job.e0 = static_cast<const unsigned char *>(element_loops[0].read(n));
+                job.e1 = static_cast<const unsigned char *>(element_loops[1].read(n));
+                job.n = n;
+                run_blocks(job, blocks, threads);
+                if (summary)
+                {
+                    for (size_t b = 0; b < blocks; b++)
+                    {
+                        array_differing += block_differing[b];
+                        for (size_t c = 0; c < components; c++)
+                        {
+                            array_stats[c].add(block_stats[b * components + c]);
+                        }
+                    }
+                    if (!stats.value() && array_differing > 0)
+                    {
+                        // The exit status is known; the rest of the input does not matter.
+                        break;
+                    }
+                }
+                else
+                {
+                    element_loops[0].write(d.ptr(), n);
+                }
+            }
+            if (array_differing > 0)
             {
-                for (uintmax_t c = 0; c < hdro.components(); c++)
+                if (!stats.value())
                 {
-                    component_offsets[c] = static_cast<const char*>(hdro.component(element_buf.ptr(), c))
-                        - element_buf.ptr<const char>();
+                    return 1;
                 }
+                differences = true;
             }
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            if (stats.value())
             {
-                const void* e0 = element_loops[0].read();
-                const void* e1 = element_loops[1].read();
-                for (uintmax_t c = 0; c < hdro.components(); c++)
+                msg::req(namei[0] + ":");
+                msg::req(4, std::string("differing elements: ") + str::from(array_differing)
+                        + " of " + str::from(hdro.elements()));
+                for (size_t c = 0; c < components; c++)
                 {
-                    diff(hdro.component_type(c), absolute.value(), force.value(),
-                            static_cast<const void*>(static_cast<const char*>(e0) + component_offsets[c]),
-                            static_cast<const void*>(static_cast<const char*>(e1) + component_offsets[c]),
-                            static_cast<void*>(element_buf.ptr<char>(component_offsets[c])));
+                    const diff_stats_t &cs = array_stats[c];
+                    double peak = type_peak(plan.types[c]);
+                    if (peak <= 0.0)
+                    {
+                        peak = cs.peak;
+                    }
+                    double rmse = (cs.valid > 0 ? cs.root_mean_square_error() : 0.0);
+                    msg::req(4, std::string("element component ") + str::from(c) + ": "
+                            + type_to_string(hdro.component_type(c), hdro.component_size(c)));
+                    msg::req(8, std::string("maximum absolute error = ")
+                            + (cs.valid > 0 ? str::from(cs.max_abs_error) : "unavailable"));
+                    msg::req(8, std::string("root mean square error = ")
+                            + (cs.valid > 0 ? str::from(rmse) : "unavailable"));
+                    /* 10 log10(peak^2 / mse), computed without squaring */
+                    msg::req(8, std::string("peak signal-to-noise ratio = ")
+                            + (cs.valid == 0 ? "unavailable"
+                                : rmse <= 0.0 ? "infinite"
+                                : str::from(20.0 * std::log10(peak) - 20.0 * std::log10(rmse)) + " dB"));
                 }
-                element_loops[0].write(element_buf.ptr());
             }
         }
         array_loops[0].finish();
-        if (array_loops[1].read(hdri[1], namei[1]))
+        if (array_loops[1].read(hdri[1], namei[1]) && !quiet.value())
         {
             msg::wrn_txt("ignoring additional array(s) from %s", arguments[1].c_str());
         }
@@ -297,8 +846,8 @@ extern "C" int gtatool_diff(int argc, char *argv[])
     catch (std::exception &e)
     {
         msg::err_txt("%s", e.what());
-        return 1;
+        return (summary ? 2 : 1);
     }
 
-    return 0;
+    return (differences ? 1 : 0);
 }
@@ -25,6 +25,7 @@
 #include <cstdio>
 #include <cstring>
 #include <cctype>
+#include <algorithm>
 
 #include <gta/gta.hpp>
 
@@ -32,6 +33,7 @@
 #include "base/blb.h"
 #include "base/opt.h"
 #include "base/str.h"
+#include "base/fio.h"
 #include "base/chk.h"
 
 #include "lib.h"
@@ -47,6 +49,112 @@ extern "C" void gtatool_extract_help(void)
             "Example: extract -l 10,10 -h 19,19 image.gta > image-10x10.gta");
 }
 
+/* Maximum size of the sub-array part that is read with one read_block() call */
+static const size_t max_slab_size = 16 * 1024 * 1024;
+/* Maximum size of the part of an input row that is read at once */
+static const size_t max_piece_size = 1024 * 1024;
+
+/* Read the sub-array with read_block(), in slabs that consist of complete
+ * rows and planes of the sub-array where possible. Everything outside of the
+ * sub-array is skipped by seeking. */
+static void extract_seekable(array_loop_t &array_loop, const gta::header &hdri, const gta::header &hdro,
+        const std::vector<uintmax_t> &low, const std::vector<uintmax_t> &high)
+{
+    const size_t dims = low.size();
+    const size_t element_size = checked_cast<size_t>(hdri.element_size());
+    const uintmax_t data_offset = fio::tell(array_loop.file_in(), array_loop.filename_in());
+    // Find the dimension k along which the sub-array is cut into slabs, and
+    // the number of indices in this dimension per slab.
+    size_t k = 0;
+    uintmax_t slice_size = element_size;
+    while (k < dims - 1 && checked_mul(slice_size, hdro.dimension_size(k)) <= max_slab_size)
+    {
+        slice_size *= hdro.dimension_size(k);
+        k++;
+    }
+    const uintmax_t slab_indices = std::max(static_cast<uintmax_t>(1), max_slab_size / slice_size);
+    blob slab(checked_cast<size_t>(checked_mul(slice_size, std::min(slab_indices, hdro.dimension_size(k)))));
+    std::vector<uintmax_t> lower(low);
+    std::vector<uintmax_t> higher(high);
+    for (size_t i = k + 1; i < dims; i++)
+    {
+        higher[i] = lower[i];
+    }
+    element_loop_t element_loop;
+    array_loop.start_element_loop(element_loop, hdri, hdro);
+    for (;;)
+    {
+        for (uintmax_t j = low[k]; j <= high[k]; j += slab_indices)
+        {
+            lower[k] = j;
+            higher[k] = std::min(high[k], j + slab_indices - 1);
+            hdri.read_block(array_loop.file_in(), data_offset, &(lower[0]), &(higher[0]), slab.ptr());
+            element_loop.write(slab.ptr(), checked_cast<size_t>(slice_size / element_size * (higher[k] - lower[k] + 1)));
+        }
+        // Go to the next slab position in the dimensions above k
+        size_t i = k + 1;
+        for (; i < dims; i++)
+        {
+            if (lower[i] < high[i])
+            {
+                lower[i]++;
+                higher[i] = lower[i];
+                break;
+            }
+            lower[i] = low[i];
+            higher[i] = low[i];
+        }
+        if (i == dims)
+        {
+            break;
+        }
+    }
+    fio::seek(array_loop.file_in(), data_offset, SEEK_SET, array_loop.filename_in());
+    array_loop.skip_data(hdri);
+}
+
+/* Read the input sequentially, row by row, and copy the part of each row that
+ * lies inside the sub-array. */
+static void extract_stream(array_loop_t &array_loop, const gta::header &hdri, const gta::header &hdro,
+        const std::vector<uintmax_t> &low, const std::vector<uintmax_t> &high)
+{
+    const size_t dims = low.size();
+    const size_t element_size = checked_cast<size_t>(hdri.element_size());
+    const uintmax_t row_size = hdri.dimension_size(0);
+    const uintmax_t rows = hdri.elements() / row_size;
+    const uintmax_t piece_size = std::max(static_cast<size_t>(1), max_piece_size / element_size);
+    std::vector<uintmax_t> index(dims, 0);
+    element_loop_t element_loop;
+    array_loop.start_element_loop(element_loop, hdri, hdro);
+    for (uintmax_t r = 0; r < rows; r++)
+    {
+        bool in_sub_array = true;
+        for (size_t i = 1; i < dims; i++)
+        {
+            if (index[i] < low[i] || index[i] > high[i])
+            {
+                in_sub_array = false;
+                break;
+            }
+        }
+        for (uintmax_t e = 0; e < row_size; e += piece_size)
+        {
+            size_t n = checked_cast<size_t>(std::min(piece_size, row_size - e));
+            const unsigned char *piece = static_cast<const unsigned char *>(element_loop.read(n));
+            if (in_sub_array && e <= high[0] && e + n > low[0])
+            {
+                uintmax_t a = std::max(e, low[0]);
+                uintmax_t b = std::min(e + n - 1, high[0]);
+                element_loop.write(piece + (a - e) * element_size, checked_cast<size_t>(b - a + 1));
+            }
+        }
+        for (size_t i = 1; i < dims && ++index[i] == hdri.dimension_size(i); i++)
+        {
+            index[i] = 0;
+        }
+    }
+}
+
 extern "C" int gtatool_extract(int argc, char *argv[])
 {
     std::vector<opt::option *> options;
@@ -114,26 +222,18 @@ extern "C" int gtatool_extract(int argc, char *argv[])
             }
             array_loop.write(hdro, nameo);
 
-            element_loop_t element_loop;
-            std::vector<uintmax_t> index(hdro.dimensions());
-            array_loop.start_element_loop(element_loop, hdri, hdro);
-            for (uintmax_t e = 0; e < hdri.elements(); e++)
+            if (hdro.data_size() == 0)
             {
-                const void *src = element_loop.read();
-                hdri.linear_index_to_indices(e, &(index[0]));
-                bool in_sub_array = true;
-                for (size_t i = 0; i < index.size(); i++)
-                {
-                    if (index[i] < low.value()[i] || index[i] > high.value()[i])
-                    {
-                        in_sub_array = false;
-                        break;
-                    }
-                }
-                if (in_sub_array)
-                {
-                    element_loop.write(src);
-                }
+                array_loop.skip_data(hdri);
+                continue;
+            }
+            if (fio::seekable(array_loop.file_in()) && hdri.compression() == gta::none)
+            {
+                extract_seekable(array_loop, hdri, hdro, low.value(), high.value());
+            }
+            else
+            {
+                extract_stream(array_loop, hdri, hdro, low.value(), high.value());
             }
         }
         array_loop.finish();
@@ -24,6 +24,8 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <cstring>
+#include <algorithm>
 
 #include <gta/gta.hpp>
 
@@ -31,18 +33,89 @@
 #include "base/blb.h"
 #include "base/opt.h"
 #include "base/str.h"
+#include "base/fio.h"
 #include "base/chk.h"
 
 #include "lib.h"
 
 
+/* Provides the fill value for the elements of the box, from a buffer that
+ * holds as many copies of the value as needed. */
+class fill_data : public box_data_t
+{
+private:
+    const blob &_value;
+    blob _buf;
+    size_t _buf_elements;
+
+public:
+    fill_data(const blob &value) : _value(value), _buf(), _buf_elements(0)
+    {
+    }
+
+    const void *next(size_t n)
+    {
+        if (n > _buf_elements)
+        {
+            _buf.resize(n, _value.size());
+            for (size_t i = _buf_elements; i < n; i++)
+            {
+                std::memcpy(_buf.ptr(i * _value.size()), _value.ptr(), _value.size());
+            }
+            _buf_elements = n;
+        }
+        return _buf.ptr();
+    }
+};
+
+/* Check the array, and get the fill value and the box to fill (which is
+ * clipped to the array). */
+static void prepare(const gta::header &hdr, const std::string &name,
+        const opt::tuple<uintmax_t> &low, const opt::tuple<uintmax_t> &high, const opt::string &value,
+        blob &v, std::vector<uintmax_t> &box_low, std::vector<uintmax_t> &box_high)
+{
+    if (!low.values().empty() && low.value().size() != hdr.dimensions())
+    {
+        throw exc(name + ": array has incompatible number of dimensions");
+    }
+    v.resize(checked_cast<size_t>(hdr.element_size()));
+    if (value.values().empty())
+    {
+        memset(v.ptr(), 0, hdr.element_size());
+    }
+    else
+    {
+        std::vector<gta::type> comp_types;
+        std::vector<uintmax_t> comp_sizes;
+        for (uintmax_t i = 0; i < hdr.components(); i++)
+        {
+            comp_types.push_back(hdr.component_type(i));
+            if (hdr.component_type(i) == gta::blob)
+            {
+                comp_sizes.push_back(hdr.component_size(i));
+            }
+        }
+        valuelist_from_string(value.value(), comp_types, comp_sizes, v.ptr());
+    }
+    box_low.resize(hdr.dimensions());
+    box_high.resize(hdr.dimensions());
+    for (uintmax_t i = 0; i < hdr.dimensions(); i++)
+    {
+        box_low[i] = (low.values().empty() ? 0 : low.value()[i]);
+        box_high[i] = (high.values().empty() ? hdr.dimension_size(i) - 1
+                : std::min(high.value()[i], hdr.dimension_size(i) - 1));
+    }
+}
+
 extern "C" void gtatool_fill_help(void)
 {
     msg::req_txt(
-            "fill [-l|--low=<l0>[,<l1>[,...]]] [-h|--high=<h0>[,<h1>[,...]]] [-v|--value=<v0>[,<v1>[,...]]] [<files>...]\n"
+            "fill [-l|--low=<l0>[,<l1>[,...]]] [-h|--high=<h0>[,<h1>[,...]]] [-v|--value=<v0>[,<v1>[,...]]] [--in-place] [<files>...]\n"
             "\n"
             "Fills a subset of the input arrays with a given value. The subset is given by its low and high coordinates (inclusive). "
             "The default is to fill the complete array with zeroes.\n"
+            "With --in-place, the arrays in the given files are modified directly instead of writing new arrays to "
+            "standard output. Only the filled subset is written. This requires uncompressed arrays.\n"
             "Example: fill -l 20,20 -h 29,29 -v 32,64,128 < img1.gta > img2.gta");
 }
 
@@ -57,6 +130,8 @@ extern "C" int gtatool_fill(int argc, char *argv[])
     options.push_back(&high);
     opt::string value("value", 'v', opt::optional);
     options.push_back(&value);
+    opt::flag in_place("in-place", '\0', opt::optional);
+    options.push_back(&in_place);
     std::vector<std::string> arguments;
     if (!opt::parse(argc, argv, options, -1, -1, arguments))
     {
@@ -85,68 +160,75 @@ extern "C" int gtatool_fill(int argc, char *argv[])
             return 1;
         }
     }
+    if (in_place.value() && arguments.empty())
+    {
+        msg::err_txt("--in-place requires file arguments");
+        return 1;
+    }
 
     try
     {
-        array_loop_t array_loop;
-        gta::header hdri, hdro;
-        std::string namei, nameo;
-        array_loop.start(arguments, "");
-        while (array_loop.read(hdri, namei))
+        blob v;
+        std::vector<uintmax_t> box_low, box_high;
+        if (in_place.value())
         {
-            if (!low.values().empty() && low.value().size() != hdri.dimensions())
+            for (size_t a = 0; a < arguments.size(); a++)
             {
-                throw exc(namei + ": array has incompatible number of dimensions");
-            }
-            blob v(checked_cast<size_t>(hdri.element_size()));
-            if (value.values().empty())
-            {
-                memset(v.ptr(), 0, hdri.element_size());
-            }
-            else
-            {
-                std::vector<gta::type> comp_types;
-                std::vector<uintmax_t> comp_sizes;
-                for (uintmax_t i = 0; i < hdri.components(); i++)
+                const std::string &filename = arguments[a];
+                FILE *f = fio::open(filename, "r+");
+                try
                 {
-                    comp_types.push_back(hdri.component_type(i));
-                    if (hdri.component_type(i) == gta::blob)
+                    for (uintmax_t k = 0; fio::has_more(f, filename); k++)
                     {
-                        comp_sizes.push_back(hdri.component_size(i));
+                        const std::string name = filename + " array " + str::from(k);
+                        gta::header hdr;
+                        hdr.read_from(f);
+                        prepare(hdr, name, low, high, value, v, box_low, box_high);
+                        if (hdr.compression() != gta::none)
+                        {
+                            throw exc(name + ": cannot modify compressed array in place");
+                        }
+                        uintmax_t data_offset = fio::tell(f, filename);
+                        if (hdr.data_size() > 0)
+                        {
+                            fill_data data(v);
+                            replace_box_in_place(hdr, f, data_offset, box_low, box_high, data);
+                        }
+                        fio::seek(f, data_offset, SEEK_SET, filename);
+                        hdr.skip_data(f);
                     }
                 }
-                valuelist_from_string(value.value(), comp_types, comp_sizes, v.ptr());
+                catch (...)
+                {
+                    std::fclose(f);
+                    throw;
+                }
+                fio::close(f, filename);
             }
-            hdro = hdri;
-            hdro.set_compression(gta::none);
-            array_loop.write(hdro, nameo);
-
-            if (hdro.data_size() > 0)
+        }
+        else
+        {
+            array_loop_t array_loop;
+            gta::header hdri, hdro;
+            std::string namei, nameo;
+            array_loop.start(arguments, "");
+            while (array_loop.read(hdri, namei))
             {
-                element_loop_t element_loop;
-                std::vector<uintmax_t> index(hdri.dimensions());
-                array_loop.start_element_loop(element_loop, hdri, hdro);
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                prepare(hdri, namei, low, high, value, v, box_low, box_high);
+                hdro = hdri;
+                hdro.set_compression(gta::none);
+                array_loop.write(hdro, nameo);
+
+                if (hdro.data_size() > 0)
                 {
-                    const void *src = element_loop.read();
-                    hdro.linear_index_to_indices(e, &(index[0]));
-                    bool replace = true;
-                    if (!low.values().empty())
-                    {
-                        for (size_t i = 0; i < index.size(); i++)
-                        {
-                            if (index[i] < low.value()[i] || index[i] > high.value()[i])
-                            {
-                                replace = false;
-                                break;
-                            }
-                        }
-                    }
-                    element_loop.write(replace ? v.ptr() : src);
+                    element_loop_t element_loop;
+                    array_loop.start_element_loop(element_loop, hdri, hdro);
+                    fill_data data(v);
+                    replace_box(element_loop, hdri, box_low, box_high, data);
                 }
             }
+            array_loop.finish();
         }
-        array_loop.finish();
     }
     catch (std::exception &e)
     {
@@ -25,6 +25,10 @@
 #include <cstdio>
 #include <cctype>
 #include <cmath>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <mutex>
 
 #include <gta/gta.hpp>
 
@@ -38,12 +42,262 @@
 extern "C" void gtatool_info_help(void)
 {
     msg::req_txt(
-            "info [-s|--statistics] [<files...>]\n"
+            "info [-s|--statistics] [--quantiles=<p0>[,<p1>...]] [--histogram=<n>] [-j|--jobs=<n>] [<files...>]\n"
             "\n"
             "Print information about GTAs.\n"
             "If --statistics is given, simple statistics about the values in each component "
             "are computed and printed (in double precision, regardless of input type). Values "
-            "that are not finite numbers are ignored.");
+            "that are not finite numbers are ignored, and so are values equal to the NO_DATA_VALUE "
+            "tag of a component. The statistics are computed with n threads; the default is the "
+            "number of processors. The results do not depend on the number of threads.\n"
+            "The options --quantiles and --histogram imply --statistics. The first prints the "
+            "quantiles for the given probabilities (e.g. 0.01,0.5,0.99 for the 1%% percentile, the median, "
+            "and the 99%% percentile), and the second prints a histogram with n bins of equal width "
+            "between the minimum and maximum value. Both are computed in the same pass as the other "
+            "statistics. They are exact for 8 and 16 bit integer types. For other types, they are based "
+            "on buckets of values that differ by at most 1/128 relative to their magnitude, "
+            "and each quantile is the center of its bucket.");
+}
+
+/* A sketch of the distribution of the values of a component, for quantiles
+ * and histograms: the number of values in each bucket, by bucket key. For 8
+ * and 16 bit integer types, each value has its own bucket. For other types, a
+ * bucket holds all values that agree in sign, exponent, and the highest
+ * sketch_bits bits of the mantissa of their double representation. Bucket
+ * counts simply add up, so sketches can be merged in any order. The counts
+ * are kept in a flat array of all possible keys, divided into pages that are
+ * allocated when first used, so that the memory needed depends on the range
+ * of values that actually occur. */
+
+static const int sketch_bits = 7;
+
+class sketch_t
+{
+private:
+    // All keys are in [-key_offset, key_offset).
+    static const int64_t key_offset = INT64_C(1) << (11 + sketch_bits);
+    static const int page_bits = 7;
+    std::vector<std::vector<uintmax_t> > _pages;
+
+public:
+    sketch_t() : _pages((2 * key_offset) >> page_bits)
+    {
+    }
+
+    void add(int64_t key)
+    {
+        uint64_t i = key + key_offset;
+        std::vector<uintmax_t> &page = _pages[i >> page_bits];
+        if (page.empty())
+        {
+            page.resize(1 << page_bits, 0);
+        }
+        page[i & ((1 << page_bits) - 1)]++;
+    }
+
+    void add(const sketch_t &sketch)
+    {
+        for (size_t p = 0; p < _pages.size(); p++)
+        {
+            const std::vector<uintmax_t> &page = sketch._pages[p];
+            if (!page.empty())
+            {
+                if (_pages[p].empty())
+                {
+                    _pages[p] = page;
+                }
+                else
+                {
+                    for (size_t i = 0; i < page.size(); i++)
+                    {
+                        _pages[p][i] += page[i];
+                    }
+                }
+            }
+        }
+    }
+
+    // Get the non-empty buckets as (key, count) pairs, sorted by key.
+    void buckets(std::vector<std::pair<int64_t, uintmax_t> > &b) const
+    {
+        b.clear();
+        for (size_t p = 0; p < _pages.size(); p++)
+        {
+            for (size_t i = 0; i < _pages[p].size(); i++)
+            {
+                if (_pages[p][i] > 0)
+                {
+                    b.push_back(std::make_pair(static_cast<int64_t>((p << page_bits) + i) - key_offset, _pages[p][i]));
+                }
+            }
+        }
+    }
+};
+
+static int64_t sketch_key(double x, bool exact)
+{
+    if (exact)
+    {
+        return static_cast<int64_t>(x);
+    }
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(double));
+    int64_t k = (bits & ~(UINT64_C(1) << 63)) >> (52 - sketch_bits);
+    return ((bits >> 63) ? -k - 1 : k);
+}
+
+/* The representative value of a bucket: its center */
+static double sketch_value(int64_t key, bool exact)
+{
+    if (exact)
+    {
+        return key;
+    }
+    bool negative = (key < 0);
+    uint64_t k = (negative ? -(key + 1) : key);
+    uint64_t lo_bits = k << (52 - sketch_bits);
+    uint64_t hi_bits = (k + 1) << (52 - sketch_bits);
+    double lo, hi;
+    std::memcpy(&lo, &lo_bits, sizeof(double));
+    std::memcpy(&hi, &hi_bits, sizeof(double));
+    double v = (std::isfinite(hi) ? lo + (hi - lo) / 2.0 : lo);
+    return (negative ? -v : v);
+}
+
+static bool sketch_is_exact(gta::type t)
+{
+    return (t == gta::int8 || t == gta::uint8 || t == gta::int16 || t == gta::uint16);
+}
+
+/* The elements are processed in blocks of block_size elements. Each batch of
+ * blocks is distributed over several threads. The statistics are kept per
+ * block and combined in block order afterwards, so that the results do not
+ * depend on the number of threads. Each run of a thread fills its own
+ * sketches, which are merged into the sketches of the array at its end. */
+
+static const size_t block_size = component_stats_block_size;
+
+// Number of blocks that each thread computes in one batch.
+static const size_t blocks_per_job = 16;
+
+class stats_job_t : public block_job_t
+{
+private:
+    std::mutex _sketches_mutex;
+
+public:
+    size_t element_size;
+    std::vector<size_t> offsets;
+    std::vector<component_stats_kernel_t> kernels;
+    std::vector<bool> exact;
+    std::vector<blob> nodata;
+    std::vector<bool> have_nodata;
+    const unsigned char *elements;
+    size_t n;
+    std::vector<component_stats_t> block_stats;
+    std::vector<sketch_t> sketches;     // empty if not needed
+
+    void run(size_t first_block, size_t blocks)
+    {
+        const size_t components = kernels.size();
+        std::vector<double> buf(block_size);
+        std::vector<unsigned char> valid(block_size);
+        std::vector<sketch_t> run_sketches(sketches.size());
+        for (size_t b = first_block; b < first_block + blocks; b++)
+        {
+            size_t m = std::min(n - b * block_size, block_size);
+            for (size_t c = 0; c < components; c++)
+            {
+                component_stats_t &s = block_stats[b * components + c];
+                kernels[c](elements + b * block_size * element_size + offsets[c], element_size, m,
+                        have_nodata[c] ? nodata[c].ptr() : NULL, &(buf[0]), &(valid[0]), s);
+                if (!run_sketches.empty())
+                {
+                    for (size_t k = 0; k < m; k++)
+                    {
+                        if (valid[k])
+                        {
+                            run_sketches[c].add(sketch_key(buf[k], exact[c]));
+                        }
+                    }
+                }
+                component_stats_finish(&(buf[0]), &(valid[0]), m, s);
+            }
+        }
+        if (!sketches.empty())
+        {
+            std::lock_guard<std::mutex> lock(_sketches_mutex);
+            for (size_t c = 0; c < components; c++)
+            {
+                sketches[c].add(run_sketches[c]);
+            }
+        }
+    }
+};
+
+/* The representative value of a bucket, limited to the range of the values */
+static double sketch_value(int64_t key, bool exact, const component_stats_t &stats)
+{
+    return std::min(stats.max, std::max(stats.min, sketch_value(key, exact)));
+}
+
+/* Print quantiles. The quantile for probability p is the value with rank
+ * p * (n - 1), rounded to the nearest integer, among the n sorted values. */
+static void print_quantiles(const sketch_t &sketch, bool exact, const component_stats_t &stats,
+        const std::vector<double> &probabilities)
+{
+    std::vector<std::pair<int64_t, uintmax_t> > buckets;
+    sketch.buckets(buckets);
+    for (size_t i = 0; i < probabilities.size(); i++)
+    {
+        std::string value = "unavailable";
+        if (stats.n > 0)
+        {
+            uintmax_t rank = std::min(stats.n - 1, static_cast<uintmax_t>(probabilities[i] * (stats.n - 1) + 0.5));
+            uintmax_t count = 0;
+            for (size_t j = 0; j < buckets.size(); j++)
+            {
+                count += buckets[j].second;
+                if (count > rank)
+                {
+                    value = str::from(sketch_value(buckets[j].first, exact, stats));
+                    break;
+                }
+            }
+        }
+        std::ostringstream p;
+        p << probabilities[i];
+        msg::req(8, std::string("quantile ") + p.str() + " = " + value);
+    }
+}
+
+/* Print a histogram with the given number of bins of equal width between the
+ * minimum and maximum value. */
+static void print_histogram(const sketch_t &sketch, bool exact, const component_stats_t &stats, int bins)
+{
+    if (stats.n == 0)
+    {
+        msg::req(8, "histogram unavailable");
+        return;
+    }
+    std::vector<uintmax_t> counts(bins, 0);
+    double width = (stats.max - stats.min) / bins;
+    std::vector<std::pair<int64_t, uintmax_t> > buckets;
+    sketch.buckets(buckets);
+    for (size_t j = 0; j < buckets.size(); j++)
+    {
+        double v = sketch_value(buckets[j].first, exact, stats);
+        int bin = (width > 0.0 ? static_cast<int>((v - stats.min) / width) : 0);
+        counts[std::min(std::max(bin, 0), bins - 1)] += buckets[j].second;
+    }
+    msg::req(8, std::string("histogram with ") + str::from(bins) + " bins:");
+    for (int b = 0; b < bins; b++)
+    {
+        double lo = stats.min + b * width;
+        double hi = (b == bins - 1 ? stats.max : stats.min + (b + 1) * width);
+        msg::req(12, std::string("[") + str::from(lo) + ", " + str::from(hi)
+                + (b == bins - 1 ? "]: " : "): ") + str::from(counts[b]));
+    }
 }
 
 extern "C" int gtatool_info(int argc, char *argv[])
@@ -53,6 +307,12 @@ extern "C" int gtatool_info(int argc, char *argv[])
     options.push_back(&help);
     opt::flag statistics("statistics", 's', opt::optional);
     options.push_back(&statistics);
+    opt::tuple<double> quantiles("quantiles", '\0', opt::optional, 0.0, 1.0);
+    options.push_back(&quantiles);
+    opt::val<int> histogram("histogram", '\0', opt::optional, 1, 1024 * 1024, 10);
+    options.push_back(&histogram);
+    opt::val<int> jobs("jobs", 'j', opt::optional, 1, 1024, processor_count());
+    options.push_back(&jobs);
     std::vector<std::string> arguments;
     if (!opt::parse(argc, argv, options, -1, -1, arguments))
     {
@@ -64,264 +324,72 @@ extern "C" int gtatool_info(int argc, char *argv[])
         return 0;
     }
 
+    const bool want_quantiles = !quantiles.values().empty();
+    const bool want_histogram = !histogram.values().empty();
+    const bool want_sketch = want_quantiles || want_histogram;
+    const bool want_statistics = statistics.value() || want_sketch;
     try
     {
         array_loop_t array_loop;
         gta::header hdr;
         std::string name;
         array_loop.start(arguments, "");
-        std::vector<double> minima;
-        std::vector<double> maxima;
-        std::vector<double> sum;
-        std::vector<double> squaresum;
-        std::vector<uintmax_t> valid_values;
+        std::vector<component_stats_t> stats;
+        std::vector<sketch_t> sketches;
         while (array_loop.read(hdr, name))
         {
-            if (statistics.value() && hdr.data_size() != 0)
+            if (want_statistics && hdr.data_size() != 0)
             {
-                minima.clear();
-                maxima.clear();
-                sum.clear();
-                squaresum.clear();
-                valid_values.clear();
-                minima.resize(checked_cast<size_t>(hdr.components()), +std::numeric_limits<double>::max());
-                maxima.resize(checked_cast<size_t>(hdr.components()), -std::numeric_limits<double>::max());
-                sum.resize(checked_cast<size_t>(hdr.components()), 0.0);
-                squaresum.resize(checked_cast<size_t>(hdr.components()), 0.0);
-                valid_values.resize(checked_cast<size_t>(hdr.components()), 0);
-                element_loop_t element_loop;
-                array_loop.start_element_loop(element_loop, hdr, hdr);
-                for (uintmax_t e = 0; e < hdr.elements(); e++)
+                const size_t threads = jobs.value();
+                const size_t components = checked_cast<size_t>(hdr.components());
+                stats_job_t job;
+                job.element_size = checked_cast<size_t>(hdr.element_size());
+                job.offsets.resize(components);
+                job.kernels.resize(components);
+                job.exact.resize(components);
+                job.nodata.resize(components);
+                job.have_nodata.resize(components);
+                blob element(job.element_size);
+                for (size_t c = 0; c < components; c++)
                 {
-                    const void *element = element_loop.read();
-                    for (uintmax_t c = 0; c < hdr.components(); c++)
+                    bool have_nodata;
+                    job.offsets[c] = static_cast<const char*>(hdr.component(element.ptr(), c)) - element.ptr<const char>();
+                    job.kernels[c] = component_stats_plan(hdr, c, job.nodata[c], have_nodata);
+                    if (!job.kernels[c])
                     {
-                        union
+                        if (hdr.component_taglist(c).get("NO_DATA_VALUE"))
                         {
-                            int8_t int8_v;
-                            uint8_t uint8_v;
-                            int16_t int16_v;
-                            uint16_t uint16_v;
-                            int32_t int32_v;
-                            uint32_t uint32_v;
-                            int64_t int64_v;
-                            uint64_t uint64_v;
-#ifdef HAVE_INT128_T
-                            int128_t int128_v;
-#endif
-#ifdef HAVE_UINT128_T
-                            uint128_t uint128_v;
-#endif
-                            float float_v;
-                            double double_v;
-#ifdef HAVE_FLOAT128_T
-                            float128_t float128_v;
-#endif
-                        } nodata_value;
-                        bool have_nodata_value = false;
-                        const char* tagval = hdr.component_taglist(c).get("NO_DATA_VALUE");
-                        if (tagval)
-                        {
-                            switch (hdr.component_type(c))
-                            {
-                            case gta::int8:
-                                have_nodata_value = (str::to(tagval, &nodata_value.int8_v) == 0);
-                                break;
-                            case gta::uint8:
-                                have_nodata_value = (str::to(tagval, &nodata_value.uint8_v) == 0);
-                                break;
-                            case gta::int16:
-                                have_nodata_value = (str::to(tagval, &nodata_value.int16_v) == 0);
-                                break;
-                            case gta::uint16:
-                                have_nodata_value = (str::to(tagval, &nodata_value.uint16_v) == 0);
-                                break;
-                            case gta::int32:
-                                have_nodata_value = (str::to(tagval, &nodata_value.int32_v) == 0);
-                                break;
-                            case gta::uint32:
-                                have_nodata_value = (str::to(tagval, &nodata_value.uint32_v) == 0);
-                                break;
-                            case gta::int64:
-                                have_nodata_value = (str::to(tagval, &nodata_value.int64_v) == 0);
-                                break;
-                            case gta::uint64:
-                                have_nodata_value = (str::to(tagval, &nodata_value.uint64_v) == 0);
-                                break;
-#ifdef HAVE_INT128_T
-                            case gta::int128:
-                                have_nodata_value = (str::to(tagval, &nodata_value.int128_v) == 0);
-                                break;
-#endif
-#ifdef HAVE_UINT128_T
-                            case gta::uint128:
-                                have_nodata_value = (str::to(tagval, &nodata_value.uint128_v) == 0);
-                                break;
-#endif
-                            case gta::float32:
-                            case gta::cfloat32:
-                                have_nodata_value = (str::to(tagval, &nodata_value.float_v) == 0);
-                                break;
-                            case gta::float64:
-                            case gta::cfloat64:
-                                have_nodata_value = (str::to(tagval, &nodata_value.double_v) == 0);
-                                break;
-#ifdef HAVE_FLOAT128_T
-                            case gta::float128:
-                            case gta::cfloat128:
-                                have_nodata_value = (str::to(tagval, &nodata_value.double_v) == 0);
-                                break;
-#endif
-                            default:
-                                throw exc(std::string("cannot handle NO_DATA_VALUE for component type ")
-                                        + type_to_string(hdr.component_type(c), hdr.component_size(c)));
-                                break;
-                            }
-                        }
-                        const void *component = hdr.component(element, c);
-                        double val = std::numeric_limits<double>::quiet_NaN();
-                        switch (hdr.component_type(c))
-                        {
-                        case gta::int8:
-                            {
-                                int8_t v;
-                                memcpy(&v, component, sizeof(int8_t));
-                                if (!have_nodata_value || v != nodata_value.int8_v)
-                                    val = v;
-                            }
-                            break;
-                        case gta::uint8:
-                            {
-                                uint8_t v;
-                                memcpy(&v, component, sizeof(uint8_t));
-                                if (!have_nodata_value || v != nodata_value.uint8_v)
-                                    val = v;
-                            }
-                            break;
-                        case gta::int16:
-                            {
-                                int16_t v;
-                                memcpy(&v, component, sizeof(int16_t));
-                                if (!have_nodata_value || v != nodata_value.int16_v)
-                                    val = v;
-                            }
-                            break;
-                        case gta::uint16:
-                            {
-                                uint16_t v;
-                                memcpy(&v, component, sizeof(uint16_t));
-                                if (!have_nodata_value || v != nodata_value.uint16_v)
-                                    val = v;
-                            }
-                            break;
-                        case gta::int32:
-                            {
-                                int32_t v;
-                                memcpy(&v, component, sizeof(int32_t));
-                                if (!have_nodata_value || v != nodata_value.int32_v)
-                                    val = v;
-                            }
-                            break;
-                        case gta::uint32:
-                            {
-                                uint32_t v;
-                                memcpy(&v, component, sizeof(uint32_t));
-                                if (!have_nodata_value || v != nodata_value.uint32_v)
-                                    val = v;
-                            }
-                            break;
-                        case gta::int64:
-                            {
-                                int64_t v;
-                                memcpy(&v, component, sizeof(int64_t));
-                                if (!have_nodata_value || v != nodata_value.int64_v)
-                                    val = v;
-                            }
-                            break;
-                        case gta::uint64:
-                            {
-                                uint64_t v;
-                                memcpy(&v, component, sizeof(uint64_t));
-                                if (!have_nodata_value || v != nodata_value.uint64_v)
-                                    val = v;
-                            }
-                            break;
-#ifdef HAVE_INT128_T
-                        case gta::int128:
-                            {
-                                int128_t v;
-                                memcpy(&v, component, sizeof(int128_t));
-                                if (!have_nodata_value || v != nodata_value.int128_v)
-                                    val = v;
-                            }
-                            break;
-#endif
-#ifdef HAVE_UINT128_T
-                        case gta::uint128:
-                            {
-                                uint128_t v;
-                                memcpy(&v, component, sizeof(uint128_t));
-                                if (!have_nodata_value || v != nodata_value.uint128_v)
-                                    val = v;
-                            }
-                            break;
-#endif
-                        case gta::float32:
-                        case gta::cfloat32:
-                            {
-                                float v;
-                                memcpy(&v, component, sizeof(float));
-                                if (!have_nodata_value || std::memcmp(&v, &nodata_value.float_v, sizeof(float)) != 0)
-                                    val = v;
-                            }
-                            break;
-                        case gta::float64:
-                        case gta::cfloat64:
-                            {
-                                double v;
-                                memcpy(&v, component, sizeof(double));
-                                if (!have_nodata_value || std::memcmp(&v, &nodata_value.double_v, sizeof(double)) != 0)
-                                    val = v;
-                            }
-                            break;
-#ifdef HAVE_FLOAT128_T
-                        case gta::float128:
-                        case gta::cfloat128:
-                            {
-                                float128_t v;
-                                memcpy(&v, component, sizeof(float128_t));
-                                if (!have_nodata_value || std::memcmp(&v, &nodata_value.double_v, sizeof(float128_t)) != 0)
-                                    val = v;
-                            }
-                            break;
-#endif
-                        default:
-                            throw exc(std::string("cannot compute minimum/maximum for component type ")
+                            throw exc(std::string("cannot handle NO_DATA_VALUE for component type ")
                                     + type_to_string(hdr.component_type(c), hdr.component_size(c)));
-                            break;
                         }
-                        if (std::isfinite(val))
+                        throw exc(std::string("cannot compute minimum/maximum for component type ")
+                                + type_to_string(hdr.component_type(c), hdr.component_size(c)));
+                    }
+                    job.exact[c] = sketch_is_exact(hdr.component_type(c));
+                    job.have_nodata[c] = have_nodata;
+                }
+                const size_t batch_size = threads * blocks_per_job * block_size;
+                job.block_stats.resize(threads * blocks_per_job * components);
+                job.sketches.resize(want_sketch ? components : 0);
+                stats.clear();
+                stats.resize(components);
+                element_loop_t element_loop;
+                array_loop.start_element_loop(element_loop, hdr, hdr);
+                for (uintmax_t e = 0; e < hdr.elements(); e += batch_size)
+                {
+                    job.n = checked_cast<size_t>(std::min(hdr.elements() - e, static_cast<uintmax_t>(batch_size)));
+                    job.elements = static_cast<const unsigned char*>(element_loop.read(job.n));
+                    size_t blocks = (job.n - 1) / block_size + 1;
+                    run_blocks(job, blocks, threads);
+                    for (size_t b = 0; b < blocks; b++)
+                    {
+                        for (size_t c = 0; c < components; c++)
                         {
-                            if (valid_values[c] == 0)
-                            {
-                                minima[c] = val;
-                                maxima[c] = val;
-                                sum[c] = val;
-                                squaresum[c] = val * val;
-                            }
-                            else
-                            {
-                                if (val < minima[c])
-                                    minima[c] = val;
-                                else if (val > maxima[c])
-                                    maxima[c] = val;
-                                sum[c] += val;
-                                squaresum[c] += val * val;
-                            }
-                            valid_values[c]++;
+                            stats[c].add(job.block_stats[b * components + c]);
                         }
                     }
                 }
+                sketches.swap(job.sketches);
             }
             else
             {
@@ -410,21 +478,23 @@ extern "C" int gtatool_info(int argc, char *argv[])
                 msg::req(4, std::string("element component ") + str::from(i) + ": "
                         + type_to_string(hdr.component_type(i), hdr.component_size(i)) + ", "
                         + str::human_readable_memsize(hdr.component_size(i)));
-                if (statistics.value() && hdr.data_size() != 0)
+                if (want_statistics && hdr.data_size() != 0)
                 {
-                    msg::req(8, std::string("minimum value = ") + (valid_values[i] > 0 ? str::from(minima[i]) : "unavailable"));
-                    msg::req(8, std::string("maximum value = ") + (valid_values[i] > 0 ? str::from(maxima[i]) : "unavailable"));
-                    double mean = 0.0, variance = 0.0, deviation = 0.0;
-                    if (valid_values[i] > 0) {
-                        mean = sum[i] / valid_values[i];
+                    const component_stats_t &cs = stats[i];
+                    double variance = (cs.n > 1 ? cs.m2 / (cs.n - 1) : 0.0);
+                    msg::req(8, std::string("minimum value = ") + (cs.n > 0 ? str::from(cs.min) : "unavailable"));
+                    msg::req(8, std::string("maximum value = ") + (cs.n > 0 ? str::from(cs.max) : "unavailable"));
+                    msg::req(8, std::string("sample mean = ") + (cs.n > 0 ? str::from(cs.mean()) : "unavailable"));
+                    msg::req(8, std::string("sample variance = ") + (cs.n > 1 ? str::from(variance) : "unavailable"));
+                    msg::req(8, std::string("sample deviation = ") + (cs.n > 1 ? str::from(std::sqrt(variance)) : "unavailable"));
+                    if (want_quantiles)
+                    {
+                        print_quantiles(sketches[i], sketch_is_exact(hdr.component_type(i)), cs, quantiles.value());
                     }
-                    if (valid_values[i] > 1) {
-                        variance = (squaresum[i] - sum[i] / hdr.elements() * sum[i]) / (valid_values[i] - 1);
-                        deviation = std::sqrt(variance);
+                    if (want_histogram)
+                    {
+                        print_histogram(sketches[i], sketch_is_exact(hdr.component_type(i)), cs, histogram.value());
                     }
-                    msg::req(8, std::string("sample mean = ") + (valid_values[i] > 0 ? str::from(mean) : "unavailable"));
-                    msg::req(8, std::string("sample variance = ") + (valid_values[i] > 1 ? str::from(variance) : "unavailable"));
-                    msg::req(8, std::string("sample deviation = ") + (valid_values[i] > 1 ? str::from(deviation) : "unavailable"));
                 }
                 for (uintmax_t j = 0; j < hdr.component_taglist(i).tags(); j++)
                 {
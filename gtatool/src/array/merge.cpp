@@ -24,6 +24,7 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <algorithm>
 
 #include <gta/gta.hpp>
 
@@ -174,28 +175,67 @@ extern "C" int gtatool_merge(int argc, char *argv[])
                 hdro.component_taglist(c) = hdri[0].component_taglist(c);
             }
             array_loops[0].write(hdro, nameo);
-            if (hdro.data_size() > 0)
+            bool concatenation = true;
+            for (uintmax_t d = dimension.value() + 1; d < hdro.dimensions(); d++)
             {
-                std::vector<uintmax_t> indices(hdro.dimensions());
+                if (hdro.dimension_size(d) != 1)
+                {
+                    concatenation = false;
+                    break;
+                }
+            }
+            if (hdro.data_size() > 0 && concatenation)
+            {
+                // All dimensions above the merge dimension have size 1, so
+                // the output data is the concatenation of the input data.
+                // Copy it in bulk.
+                for (size_t i = 0; i < arguments.size(); i++)
+                {
+                    array_loops[i].copy_data(hdri[i], array_loops[0], hdri[i]);
+                }
+            }
+            else if (hdro.data_size() > 0)
+            {
+                // The output data is a fixed interleave of contiguous
+                // segments: for each index combination of the dimensions
+                // above the merge dimension, one segment from each input in
+                // order. A segment of input j covers all elements of its
+                // lower dimensions, including the merge dimension.
+                uintmax_t lower_elements = 1;
+                for (uintmax_t d = 0; d < dimension.value(); d++)
+                {
+                    lower_elements = checked_mul(lower_elements, hdro.dimension_size(d));
+                }
+                uintmax_t segments = 1;
+                for (uintmax_t d = dimension.value() + 1; d < hdro.dimensions(); d++)
+                {
+                    segments *= hdro.dimension_size(d);
+                }
+                std::vector<uintmax_t> segment_elements(arguments.size());
+                for (size_t j = 0; j < arguments.size(); j++)
+                {
+                    segment_elements[j] = checked_mul(lower_elements, hdri[j].dimension_size(dimension.value()));
+                }
+                // Copy in pieces of at most 1 MiB, but at least one element.
+                uintmax_t max_piece_elements = std::max(static_cast<uintmax_t>(1),
+                        static_cast<uintmax_t>(1024 * 1024) / hdro.element_size());
                 std::vector<element_loop_t> element_loops(arguments.size());
-                for (size_t i = 0; i < element_loops.size(); i++)
+                for (size_t j = 0; j < element_loops.size(); j++)
                 {
-                    array_loops[i].start_element_loop(element_loops[i], hdri[i], hdro);
+                    array_loops[j].start_element_loop(element_loops[j], hdri[j], hdro);
                 }
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                for (uintmax_t s = 0; s < segments; s++)
                 {
-                    hdro.linear_index_to_indices(e, &(indices[0]));
-                    uintmax_t dim = 0;
-                    size_t j;
-                    for (j = 0; j < arguments.size(); j++)
+                    for (size_t j = 0; j < arguments.size(); j++)
                     {
-                        dim += hdri[j].dimension_size(dimension.value());
-                        if (indices[dimension.value()] < dim)
+                        uintmax_t remaining = segment_elements[j];
+                        while (remaining > 0)
                         {
-                            break;
+                            size_t n = checked_cast<size_t>(std::min(remaining, max_piece_elements));
+                            element_loops[0].write(element_loops[j].read(n), n);
+                            remaining -= n;
                         }
                     }
-                    element_loops[0].write(element_loops[j].read());
                 }
             }
         }
@@ -24,6 +24,8 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <cstring>
+#include <algorithm>
 
 #include <gta/gta.hpp>
 
@@ -48,6 +50,118 @@ extern "C" void gtatool_resize_help(void)
             "Example: resize -d 100,100 -i -50,-50 < img200x200.gta > center100x100.gta");
 }
 
+/* Resizing works on rows, i.e. runs of elements along dimension 0. Each
+ * output row either corresponds to an input row, or consists only of the fill
+ * value. An output row that corresponds to an input row is a run of fill
+ * values, a contiguous segment of the input row, and another run of fill
+ * values. Fill values are written from a buffer that holds many copies of the
+ * fill value. Input rows are read in pieces, in ascending order; rows that
+ * are not needed are read and discarded. */
+
+static const size_t max_buffer_size = 1024 * 1024;
+
+static void write_fill(element_loop_t &element_loop, const blob &fill_buf, size_t fill_elements, uintmax_t n)
+{
+    while (n > 0)
+    {
+        size_t m = checked_cast<size_t>(std::min(n, static_cast<uintmax_t>(fill_elements)));
+        element_loop.write(fill_buf.ptr(), m);
+        n -= m;
+    }
+}
+
+// Read input row in pieces, and write the part [low,high) of it (which may be empty).
+static void copy_row(element_loop_t &element_loop, uintmax_t row_size, size_t piece_size, size_t element_size,
+        uintmax_t low, uintmax_t high)
+{
+    for (uintmax_t e = 0; e < row_size; e += piece_size)
+    {
+        size_t n = checked_cast<size_t>(std::min(row_size - e, static_cast<uintmax_t>(piece_size)));
+        const unsigned char *piece = static_cast<const unsigned char *>(element_loop.read(n));
+        uintmax_t a = std::max(e, low);
+        uintmax_t b = std::min(e + n, high);
+        if (a < b)
+        {
+            element_loop.write(piece + (a - e) * element_size, checked_cast<size_t>(b - a));
+        }
+    }
+}
+
+static void resize(array_loop_t &array_loop, const gta::header &hdri, const gta::header &hdro,
+        const std::vector<intmax_t> &offset, const void *value)
+{
+    const size_t dims = checked_cast<size_t>(hdri.dimensions());
+    const size_t element_size = checked_cast<size_t>(hdri.element_size());
+    const size_t buffer_elements = std::max(static_cast<size_t>(1), max_buffer_size / element_size);
+    blob fill_buf(buffer_elements, element_size);
+    for (size_t k = 0; k < buffer_elements; k++)
+    {
+        std::memcpy(fill_buf.ptr(k * element_size), value, element_size);
+    }
+    const uintmax_t in_row_size = hdri.dimension_size(0);
+    const uintmax_t in_rows = hdri.elements() / in_row_size;
+    const uintmax_t out_row_size = hdro.dimension_size(0);
+    const uintmax_t out_rows = hdro.elements() / out_row_size;
+    // The segment [low,high) of an input row is written to the segment
+    // [low+offset[0],high+offset[0]) of the output row.
+    intmax_t in_low = std::max(static_cast<intmax_t>(0), checked_sub(static_cast<intmax_t>(0), offset[0]));
+    intmax_t in_high = std::min(checked_cast<intmax_t>(in_row_size),
+            checked_sub(checked_cast<intmax_t>(out_row_size), offset[0]));
+    if (in_high < in_low)
+    {
+        in_high = in_low;
+    }
+    uintmax_t fill_before = std::min(static_cast<uintmax_t>(std::max(static_cast<intmax_t>(0), offset[0])), out_row_size);
+    uintmax_t fill_after = out_row_size - fill_before - (in_high - in_low);
+
+    element_loop_t element_loop;
+    array_loop.start_element_loop(element_loop, hdri, hdro);
+    uintmax_t in_rows_read = 0;
+    std::vector<uintmax_t> out_index(dims, 0);
+    for (uintmax_t r = 0; r < out_rows; r++)
+    {
+        // Find the input row for this output row, if any
+        bool from_input = true;
+        uintmax_t in_row = 0;
+        uintmax_t in_row_factor = 1;
+        for (size_t i = 1; i < dims; i++)
+        {
+            intmax_t in_index = checked_sub(checked_cast<intmax_t>(out_index[i]), offset[i]);
+            if (in_index < 0 || static_cast<uintmax_t>(in_index) >= hdri.dimension_size(i))
+            {
+                from_input = false;
+                break;
+            }
+            in_row += in_index * in_row_factor;
+            in_row_factor *= hdri.dimension_size(i);
+        }
+        if (from_input && in_high > in_low)
+        {
+            // elements are guaranteed to be in ascending order
+            for (; in_rows_read < in_row; in_rows_read++)
+            {
+                copy_row(element_loop, in_row_size, buffer_elements, element_size, 0, 0);
+            }
+            write_fill(element_loop, fill_buf, buffer_elements, fill_before);
+            copy_row(element_loop, in_row_size, buffer_elements, element_size, in_low, in_high);
+            in_rows_read++;
+            write_fill(element_loop, fill_buf, buffer_elements, fill_after);
+        }
+        else
+        {
+            write_fill(element_loop, fill_buf, buffer_elements, out_row_size);
+        }
+        for (size_t i = 1; i < dims && ++out_index[i] == hdro.dimension_size(i); i++)
+        {
+            out_index[i] = 0;
+        }
+    }
+    for (; in_rows_read < in_rows; in_rows_read++)
+    {
+        copy_row(element_loop, in_row_size, buffer_elements, element_size, 0, 0);
+    }
+}
+
 extern "C" int gtatool_resize(int argc, char *argv[])
 {
     std::vector<opt::option *> options;
@@ -117,56 +231,12 @@ extern "C" int gtatool_resize(int argc, char *argv[])
 
             if (hdro.data_size() > 0)
             {
-                element_loop_t element_loop;
-                uintmax_t read_in_elements = 0;
-                std::vector<intmax_t> in_index(hdri.dimensions());
-                std::vector<uintmax_t> out_index(hdro.dimensions());
-                array_loop.start_element_loop(element_loop, hdri, hdro);
-                for (uintmax_t linear_out_index = 0; linear_out_index < hdro.elements(); linear_out_index++)
-                {
-                    hdro.linear_index_to_indices(linear_out_index, &(out_index[0]));
-                    bool from_input = true;
-                    for (uintmax_t i = 0; i < hdri.dimensions(); i++)
-                    {
-                        if (!index.values().empty())
-                        {
-                            in_index[i] = checked_sub(checked_cast<intmax_t>(out_index[i]), index.value()[i]);
-                        }
-                        else
-                        {
-                            in_index[i] = out_index[i];
-                        }
-                        if (in_index[i] < 0 || static_cast<uintmax_t>(in_index[i]) >= hdri.dimension_size(i))
-                        {
-                            from_input = false;
-                        }
-                    }
-                    const void *src = NULL;
-                    if (from_input)
-                    {
-                        std::vector<uintmax_t> requested_in_index(in_index.size());
-                        for (size_t i = 0; i < requested_in_index.size(); i++)
-                        {
-                            requested_in_index[i] = in_index[i];
-                        }
-                        uintmax_t requested_linear_in_index = hdri.indices_to_linear_index(&(requested_in_index[0]));
-                        // elements are guaranteed to be in ascending order
-                        for (uintmax_t i = read_in_elements; i <= requested_linear_in_index; i++)
-                        {
-                            src = element_loop.read();
-                        }
-                        read_in_elements = requested_linear_in_index + 1;
-                    }
-                    else
-                    {
-                        src = v.ptr();
-                    }
-                    element_loop.write(src);
-                }
-                for (uintmax_t i = read_in_elements; i < hdri.elements(); i++)
+                std::vector<intmax_t> offset(hdri.dimensions(), 0);
+                if (!index.values().empty())
                 {
-                    element_loop.read();
+                    offset = index.value();
                 }
+                resize(array_loop, hdri, hdro, offset, v.ptr());
             }
         }
         array_loop.finish();
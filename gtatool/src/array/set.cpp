@@ -24,6 +24,7 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <algorithm>
 
 #include <gta/gta.hpp>
 
@@ -31,19 +32,154 @@
 #include "base/blb.h"
 #include "base/opt.h"
 #include "base/str.h"
+#include "base/fio.h"
 #include "base/chk.h"
 
 #include "lib.h"
 
 
+/* Provides the elements of the source array that lie inside the box, reading
+ * the source array sequentially and discarding all other elements. */
+class set_data : public box_data_t
+{
+private:
+    element_loop_t &_src_loop;
+    const gta::header &_hdr_src;
+    const std::vector<uintmax_t> &_low;
+    const std::vector<uintmax_t> &_high;
+    const std::vector<intmax_t> &_index;
+    size_t _piece_elements;
+    std::vector<uintmax_t> _row;        // current box row, in array coordinates
+    uintmax_t _row_offset;              // number of elements of the current row already provided
+    uintmax_t _src_pos;                 // number of source elements already read
+
+    void skip(uintmax_t n)
+    {
+        while (n > 0)
+        {
+            size_t m = checked_cast<size_t>(std::min(n, static_cast<uintmax_t>(_piece_elements)));
+            _src_loop.read(m);
+            n -= m;
+            _src_pos += m;
+        }
+    }
+
+public:
+    set_data(element_loop_t &src_loop, const gta::header &hdr_src,
+            const std::vector<uintmax_t> &low, const std::vector<uintmax_t> &high,
+            const std::vector<intmax_t> &index) :
+        _src_loop(src_loop), _hdr_src(hdr_src), _low(low), _high(high), _index(index),
+        _piece_elements(std::max(static_cast<size_t>(1),
+                    max_piece_size / checked_cast<size_t>(hdr_src.element_size()))),
+        _row(low), _row_offset(0), _src_pos(0)
+    {
+    }
+
+    const void *next(size_t n)
+    {
+        std::vector<uintmax_t> src_index(_row.size());
+        for (size_t i = 0; i < _row.size(); i++)
+        {
+            src_index[i] = _row[i] - _index[i];
+        }
+        uintmax_t src_pos = _hdr_src.indices_to_linear_index(&(src_index[0])) + _row_offset;
+        skip(src_pos - _src_pos);
+        const void *ptr = _src_loop.read(n);
+        _src_pos += n;
+        _row_offset += n;
+        if (_row_offset == _high[0] - _low[0] + 1)
+        {
+            _row_offset = 0;
+            for (size_t i = 1; i < _row.size(); i++)
+            {
+                if (_row[i] < _high[i])
+                {
+                    _row[i]++;
+                    break;
+                }
+                _row[i] = _low[i];
+            }
+        }
+        return ptr;
+    }
+
+    // Read the remaining source elements.
+    void finish()
+    {
+        skip(_hdr_src.elements() - _src_pos);
+    }
+};
+
+/* Check the array and the source array, and get the box that the source array
+ * covers in the array. */
+static void prepare(const gta::header &hdr, const std::string &name,
+        const gta::header &hdr_src, const std::string &name_src,
+        const opt::tuple<intmax_t> &index, std::vector<intmax_t> &offset,
+        std::vector<uintmax_t> &box_low, std::vector<uintmax_t> &box_high)
+{
+    if (!index.value().empty())
+    {
+        if (index.value().size() != hdr_src.dimensions())
+        {
+            throw exc(name_src + ": incompatible with given index");
+        }
+    }
+    if (hdr.dimensions() != hdr_src.dimensions())
+    {
+        throw exc(name + ": incompatible number of dimensions");
+    }
+    if (hdr.components() != hdr_src.components())
+    {
+        throw exc(name + ": incompatible element components");
+    }
+    for (uintmax_t i = 0; i < hdr.components(); i++)
+    {
+        if (hdr.component_type(i) != hdr_src.component_type(i)
+                || hdr.component_size(i) != hdr_src.component_size(i))
+        {
+            throw exc(name + ": incompatible element components");
+        }
+    }
+    offset.assign(hdr.dimensions(), 0);
+    if (!index.values().empty())
+    {
+        offset = index.value();
+    }
+    box_low.resize(hdr.dimensions());
+    box_high.resize(hdr.dimensions());
+    bool empty = false;
+    for (uintmax_t i = 0; i < hdr.dimensions(); i++)
+    {
+        intmax_t l = std::max(static_cast<intmax_t>(0), offset[i]);
+        intmax_t h = std::min(checked_cast<intmax_t>(hdr.dimension_size(i) - 1),
+                checked_add(offset[i], checked_cast<intmax_t>(hdr_src.dimension_size(i) - 1)));
+        if (l > h)
+        {
+            empty = true;
+        }
+        else
+        {
+            box_low[i] = l;
+            box_high[i] = h;
+        }
+    }
+    if (empty && hdr.dimensions() > 0)
+    {
+        box_low[0] = 1;
+        box_high[0] = 0;
+    }
+}
+
 extern "C" void gtatool_set_help(void)
 {
     msg::req_txt(
-            "set [-i|--index=<i0>[,<i1>[,...]]] -s|--source=<file> [<files>...]\n"
+            "set [-i|--index=<i0>[,<i1>[,...]]] -s|--source=<file> [--in-place] [<files>...]\n"
             "\n"
             "Replaces a subset of the input arrays with the given source array. "
             "The source array will be placed at the given index, or at the origin if no index is given. "
             "Parts of the source array that do not fit into the input array(s) are ignored.\n"
+            "With --in-place, the arrays in the given files are modified directly instead of writing new arrays to "
+            "standard output. Only the replaced subset is written. This requires uncompressed arrays.\n"
             "Example: set -i 20,20 -s img40x40.gta img100x100.gta > img.gta");
 }
 
@@ -56,6 +192,8 @@ extern "C" int gtatool_set(int argc, char *argv[])
     options.push_back(&index);
     opt::string source("source", 's', opt::required);
     options.push_back(&source);
+    opt::flag in_place("in-place", '\0', opt::optional);
+    options.push_back(&in_place);
     std::vector<std::string> arguments;
     if (!opt::parse(argc, argv, options, -1, -1, arguments))
     {
@@ -66,104 +204,99 @@ extern "C" int gtatool_set(int argc, char *argv[])
         gtatool_set_help();
         return 0;
     }
+    if (in_place.value() && arguments.empty())
+    {
+        msg::err_txt("--in-place requires file arguments");
+        return 1;
+    }
 
     try
     {
-        array_loop_t array_loop;
-        gta::header hdri, hdro;
-        std::string namei, nameo;
-        array_loop.start(arguments, "");
-        while (array_loop.read(hdri, namei))
+        std::vector<intmax_t> offset;
+        std::vector<uintmax_t> box_low, box_high;
+        if (in_place.value())
         {
-            array_loop_t array_loop_src;
-            gta::header hdr_src;
-            std::string name_src;
-            array_loop_src.start(source.value(), "");
-            if (!array_loop_src.read(hdr_src, name_src))
-            {
-                throw exc(source.value() + " is empty");
-            }
-            if (!index.value().empty())
-            {
-                if (index.value().size() != hdr_src.dimensions())
-                {
-                    throw exc(name_src + ": incompatible with given index");
-                }
-            }
-            if (hdri.dimensions() != hdr_src.dimensions())
-            {
-                throw exc(namei + ": incompatible number of dimensions");
-            }
-            if (hdri.components() != hdr_src.components())
-            {
-                throw exc(namei + ": incompatible element components");
-            }
-            for (uintmax_t i = 0; i < hdri.components(); i++)
+            for (size_t a = 0; a < arguments.size(); a++)
             {
-                if (hdri.component_type(i) != hdr_src.component_type(i)
-                        || hdri.component_size(i) != hdr_src.component_size(i))
+                const std::string &filename = arguments[a];
+                FILE *f = fio::open(filename, "r+");
+                try
                 {
-                    throw exc(namei + ": incompatible element components");
-                }
-            }
-            hdro = hdri;
-            hdro.set_compression(gta::none);
-            array_loop.write(hdro, nameo);
-
-            if (hdro.data_size() > 0)
-            {
-                element_loop_t element_loop;
-                element_loop_t element_loop_src;
-                uintmax_t read_src_elements = 0;
-                std::vector<intmax_t> src_index(hdr_src.dimensions());
-                std::vector<uintmax_t> out_index(hdro.dimensions());
-                array_loop.start_element_loop(element_loop, hdri, hdro);
-                array_loop_src.start_element_loop(element_loop_src, hdr_src, gta::header());
-                for (uintmax_t linear_out_index = 0; linear_out_index < hdro.elements(); linear_out_index++)
-                {
-                    hdro.linear_index_to_indices(linear_out_index, &(out_index[0]));
-                    bool from_src = true;
-                    for (uintmax_t i = 0; i < hdr_src.dimensions(); i++)
+                    for (uintmax_t k = 0; fio::has_more(f, filename); k++)
                     {
-                        if (!index.values().empty())
+                        const std::string name = filename + " array " + str::from(k);
+                        gta::header hdr;
+                        hdr.read_from(f);
+                        array_loop_t array_loop_src;
+                        gta::header hdr_src;
+                        std::string name_src;
+                        array_loop_src.start(source.value(), "");
+                        if (!array_loop_src.read(hdr_src, name_src))
                         {
-                            src_index[i] = checked_sub(checked_cast<intmax_t>(out_index[i]), index.value()[i]);
+                            throw exc(source.value() + " is empty");
                         }
-                        else
-                        {
-                            src_index[i] = out_index[i];
-                        }
-                        if (src_index[i] < 0 || static_cast<uintmax_t>(src_index[i]) >= hdr_src.dimension_size(i))
-                        {
-                            from_src = false;
-                        }
-                    }
-                    const void *src = element_loop.read();
-                    if (from_src)
-                    {
-                        std::vector<uintmax_t> requested_src_index(src_index.size());
-                        for (size_t i = 0; i < requested_src_index.size(); i++)
+                        prepare(hdr, name, hdr_src, name_src, index, offset, box_low, box_high);
+                        if (hdr.compression() != gta::none)
                         {
-                            requested_src_index[i] = src_index[i];
+                            throw exc(name + ": cannot modify compressed array in place");
                         }
-                        uintmax_t requested_linear_src_index = hdr_src.indices_to_linear_index(&(requested_src_index[0]));
-                        // elements are guaranteed to be in ascending order
-                        for (uintmax_t i = read_src_elements; i <= requested_linear_src_index; i++)
+                        uintmax_t data_offset = fio::tell(f, filename);
+                        if (hdr.data_size() > 0)
                         {
-                            src = element_loop_src.read();
+                            element_loop_t element_loop_src;
+                            array_loop_src.start_element_loop(element_loop_src, hdr_src, gta::header());
+                            set_data data(element_loop_src, hdr_src, box_low, box_high, offset);
+                            replace_box_in_place(hdr, f, data_offset, box_low, box_high, data);
+                            data.finish();
                         }
-                        read_src_elements = requested_linear_src_index + 1;
+                        array_loop_src.finish();
+                        fio::seek(f, data_offset, SEEK_SET, filename);
+                        hdr.skip_data(f);
                     }
-                    element_loop.write(src);
                 }
-                for (uintmax_t i = read_src_elements; i < hdr_src.elements(); i++)
+                catch (...)
+                {
+                    std::fclose(f);
+                    throw;
+                }
+                fio::close(f, filename);
+            }
+        }
+        else
+        {
+            array_loop_t array_loop;
+            gta::header hdri, hdro;
+            std::string namei, nameo;
+            array_loop.start(arguments, "");
+            while (array_loop.read(hdri, namei))
+            {
+                array_loop_t array_loop_src;
+                gta::header hdr_src;
+                std::string name_src;
+                array_loop_src.start(source.value(), "");
+                if (!array_loop_src.read(hdr_src, name_src))
+                {
+                    throw exc(source.value() + " is empty");
+                }
+                prepare(hdri, namei, hdr_src, name_src, index, offset, box_low, box_high);
+                hdro = hdri;
+                hdro.set_compression(gta::none);
+                array_loop.write(hdro, nameo);
+
+                if (hdro.data_size() > 0)
                 {
-                    element_loop_src.read();
+                    element_loop_t element_loop;
+                    element_loop_t element_loop_src;
+                    array_loop.start_element_loop(element_loop, hdri, hdro);
+                    array_loop_src.start_element_loop(element_loop_src, hdr_src, gta::header());
+                    set_data data(element_loop_src, hdr_src, box_low, box_high, offset);
+                    replace_box(element_loop, hdri, box_low, box_high, data);
+                    data.finish();
                 }
+                array_loop_src.finish();
             }
-            array_loop_src.finish();
+            array_loop.finish();
         }
-        array_loop.finish();
     }
     catch (std::exception &e)
     {
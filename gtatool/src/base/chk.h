@@ -197,7 +197,7 @@ T checked_mul(T a, T b)
             }
         }
     }
-    else
+    else if (!std::numeric_limits<T>::is_signed)
     {
         if (!(b == static_cast<T>(0) || !(std::numeric_limits<T>::max() / b < a)))
         {
@@ -24,6 +24,7 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <algorithm>
 
 #include <gta/gta.hpp>
 
@@ -156,31 +157,35 @@ extern "C" int gtatool_component_add(int argc, char *argv[])
             array_loop.write(hdro, nameo);
             element_loop_t element_loop;
             array_loop.start_element_loop(element_loop, hdri, hdro);
-            blob element_out(checked_cast<size_t>(hdro.element_size()));
             size_t old_comp_pre_size = 0;
             for (uintmax_t i = 0; i < hdro_new_comp_index; i++)
             {
                 old_comp_pre_size += hdro.component_size(i);
             }
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            // Source 0 is the input element, source 1 the constant new components
+            std::vector<size_t> strides(2);
+            strides[0] = checked_cast<size_t>(hdri.element_size());
+            strides[1] = 0;
+            const size_t new_comp_size = checked_cast<size_t>(hdrt.element_size());
+            component_shuffle_t shuffle;
+            shuffle.start(strides, checked_cast<size_t>(hdro.element_size()));
+            shuffle.add(0, 0, 0, old_comp_pre_size);
+            shuffle.add(1, 0, old_comp_pre_size, new_comp_size);
+            shuffle.add(0, old_comp_pre_size, old_comp_pre_size + new_comp_size,
+                    strides[0] - old_comp_pre_size);
+            shuffle.finish();
+            const size_t block_elements = shuffle.block_elements();
+            blob block_out(checked_cast<size_t>(hdro.element_size()), block_elements);
+            const void *srcs[2] = { NULL, comp_values.ptr() };
+            for (uintmax_t e = 0; e < hdro.elements(); e += block_elements)
             {
-                const void *element_in = NULL;
+                size_t n = checked_cast<size_t>(std::min(static_cast<uintmax_t>(block_elements), hdro.elements() - e));
                 if (hdri.element_size() > 0)
                 {
-                    element_in = element_loop.read();
+                    srcs[0] = element_loop.read(n);
                 }
-                if (element_in)
-                {
-                    std::memcpy(element_out.ptr(), element_in, old_comp_pre_size);
-                }
-                std::memcpy(element_out.ptr(old_comp_pre_size), comp_values.ptr(), hdrt.element_size());
-                if (element_in)
-                {
-                    std::memcpy(element_out.ptr(old_comp_pre_size + hdrt.element_size()),
-                            static_cast<const char *>(element_in) + old_comp_pre_size,
-                            hdri.element_size() - old_comp_pre_size);
-                }
-                element_loop.write(element_out.ptr());
+                shuffle.run(n, srcs, block_out.ptr());
+                element_loop.write(block_out.ptr(), n);
             }
         }
         array_loop.finish();
@@ -26,6 +26,12 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cctype>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <exception>
 #include <unistd.h>
 
 #include <gta/gta.hpp>
@@ -46,7 +52,8 @@
 extern "C" void gtatool_component_compute_help(void)
 {
     msg::req_txt(
-            "component-compute -e|--expression=<exp0> [-e|--expression=<exp1> [...]] [<files>...]\n"
+            "component-compute [-j|--jobs=<n>] [--seed=<s>] [--compatible-random] "
+            "-e|--expression=<exp0> [-e|--expression=<exp1> [...]] [<files>...]\n"
             "\n"
             "Compute array element components. For each array element in an input GTA with n array element components, "
             "the components c0..c(n-1) can be recomputed using the given expression(s). "
@@ -59,6 +66,13 @@ extern "C" void gtatool_component_compute_help(void)
             "The expressions are evaluated using the muParser library, with additions taken from mucalc. See "
             "<https://git.marlam.de/gitweb/?p=mucalc.git> for an overview "
             "of functions and operators that can be used.\n"
+            "The computation uses n threads; the default is the number of processors. "
+            "Each array element has its own streams of random numbers for random() and drand48(), "
+            "so that the results do not depend on the number of threads. The random() streams are derived from "
+            "the given seed, or from a random seed if none is given. The drand48() streams always use the same seed "
+            "unless srand48() is called. "
+            "With --compatible-random, a single thread computes all elements using one global random number state, "
+            "as in previous versions of this command.\n"
             "Example: component-compute -e 'c3 = 0.2126 * c0 + 0.7152 * c1 + 0.0722 * c2' rgba.gta > rgb+lum.gta");
 }
 
@@ -160,6 +174,546 @@ static double my_random()
 }
 
 
+/* Random numbers for parallel evaluation.
+ *
+ * The functions above use global state and thus require the elements to be
+ * computed one after the other. For parallel evaluation, each array element
+ * instead gets its own streams for random() and drand48(). These streams are
+ * counter-based: the n-th number of a stream is a hash of n and of the stream
+ * key, and the key is a hash of the seed, the array index, and the element
+ * index. The results therefore depend neither on the number of threads nor on
+ * the block size. srand48(x) restarts the drand48() stream of the current
+ * element with a key that depends only on x.
+ *
+ * The functions are muParser bulk functions, which receive the index of the
+ * current element within the evaluated block. The streams of the block belong
+ * to the evaluator that runs in the calling thread. */
+
+static const uint64_t drand48_default_seed = UINT64_C(0x1234abcd330e);
+
+static uint64_t mix64(uint64_t x)
+{
+    // This is the finalizer of splitmix64.
+    x ^= x >> 30;
+    x *= UINT64_C(0xbf58476d1ce4e5b9);
+    x ^= x >> 27;
+    x *= UINT64_C(0x94d049bb133111eb);
+    x ^= x >> 31;
+    return x;
+}
+
+static double rng_next(uint64_t key, uint64_t &counter)
+{
+    counter++;
+    uint64_t x = mix64(key + counter * UINT64_C(0x9e3779b97f4a7c15));
+    return (x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+class rng_streams_t
+{
+private:
+    uint64_t _random_base;
+    uint64_t _drand48_base;
+
+public:
+    std::vector<uint64_t> random_key;
+    std::vector<uint64_t> random_counter;
+    std::vector<uint64_t> drand48_key;
+    std::vector<uint64_t> drand48_counter;
+
+    void init(uint64_t seed, uintmax_t array_index, size_t bulk_size)
+    {
+        _random_base = mix64(mix64(seed) + array_index);
+        _drand48_base = mix64(mix64(drand48_default_seed) + array_index);
+        random_key.resize(bulk_size);
+        random_counter.resize(bulk_size);
+        drand48_key.resize(bulk_size);
+        drand48_counter.resize(bulk_size);
+    }
+
+    // Start the streams of n elements, beginning with the given element index.
+    void start(uintmax_t first_element, size_t n)
+    {
+        for (size_t k = 0; k < n; k++)
+        {
+            random_key[k] = mix64(_random_base + first_element + k);
+            random_counter[k] = 0;
+            drand48_key[k] = mix64(_drand48_base + first_element + k);
+            drand48_counter[k] = 0;
+        }
+    }
+};
+
+static thread_local rng_streams_t *rng_streams;
+
+static double bulk_srand48(int k, int /* thread */, double x)
+{
+    rng_streams->drand48_key[k] = mix64(static_cast<uint64_t>(static_cast<long>(x)));
+    rng_streams->drand48_counter[k] = 0;
+    return x;
+}
+
+static double bulk_drand48(int k, int /* thread */)
+{
+    return rng_next(rng_streams->drand48_key[k], rng_streams->drand48_counter[k]);
+}
+
+static double bulk_random(int k, int /* thread */)
+{
+    return rng_next(rng_streams->random_key[k], rng_streams->random_counter[k]);
+}
+
+static uint64_t random_seed_from_system()
+{
+    uint64_t seed;
+    FILE* f = fopen("/dev/urandom", "r");
+    if (!f || fread(&seed, sizeof(seed), 1, f) != 1)
+    {
+        seed = (static_cast<uint64_t>(getpid()) << 32) ^ static_cast<uint64_t>(time(NULL));
+    }
+    if (f)
+    {
+        fclose(f);
+    }
+    return seed;
+}
+
+
+/* Evaluation happens in blocks of elements, using the bulk mode of muParser.
+ * In bulk mode, each variable is an array with one entry per element of the
+ * block, and assignments to component variables write back into these arrays.
+ * Blocks are distributed over several threads; each thread uses its own
+ * evaluator with its own parsers and variable arrays.
+ * With --compatible-random, the elements are evaluated one at a time, so that
+ * the random number functions with global state see the elements in order.
+ * The same applies if the muParser library does not evaluate bulk expressions
+ * as described; see bulk_mode_usable(). */
+
+static const size_t block_size = 1024;
+
+/* Check at runtime whether the muParser library evaluates bulk expressions as
+ * the evaluator expects: assignments must write into the variable arrays at
+ * the offset of each element, and bulk functions must be called in the
+ * calling thread with the index of the element. Depending on the version and
+ * build options of muParser, assignments may go to the first entry only, or
+ * bulk evaluations may run in OpenMP threads of muParser, which cannot access
+ * the random number streams of the evaluator. */
+
+static std::thread::id bulk_probe_thread;
+static std::atomic<bool> bulk_probe_foreign_thread(false);
+
+static double bulk_probe(int k, int thread)
+{
+    if (thread != 0 || std::this_thread::get_id() != bulk_probe_thread)
+    {
+        bulk_probe_foreign_thread = true;
+    }
+    return k;
+}
+
+static bool bulk_mode_usable()
+{
+    const int n = 64;
+    std::vector<double> x(n), y(n, -1.0), results(n);
+    for (int k = 0; k < n; k++)
+    {
+        x[k] = 2 * k;
+    }
+    bulk_probe_thread = std::this_thread::get_id();
+    bulk_probe_foreign_thread = false;
+    try
+    {
+        mu::Parser parser;
+        parser.DefineFun("probe", bulk_probe, false);
+        parser.DefineVar("x", &(x[0]));
+        parser.DefineVar("y", &(y[0]));
+        parser.SetExpr("y = x + probe()");
+        parser.Eval(&(results[0]), n);
+    }
+    catch (mu::Parser::exception_type &)
+    {
+        return false;
+    }
+    if (bulk_probe_foreign_thread)
+    {
+        return false;
+    }
+    for (int k = 0; k < n; k++)
+    {
+        if (y[k] != 3 * k || results[k] != 3 * k)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Number of blocks that each thread computes in one batch.
+static const size_t blocks_per_job = 64;
+
+/* A component variable: a scalar of the given type at the given byte offset
+ * inside an array element. Complex components provide two of these. */
+struct comp_var_t
+{
+    gta::type type;
+    size_t offset;
+};
+
+template<typename T>
+static void get_values(const unsigned char *element, size_t element_size, size_t n, double *values)
+{
+    for (size_t k = 0; k < n; k++)
+    {
+        T v;
+        std::memcpy(&v, element + k * element_size, sizeof(T));
+        values[k] = v;
+    }
+}
+
+template<typename T>
+static void set_values(const double *values, size_t n, unsigned char *element, size_t element_size)
+{
+    for (size_t k = 0; k < n; k++)
+    {
+        T v = values[k];
+        std::memcpy(element + k * element_size, &v, sizeof(T));
+    }
+}
+
+static void get_comp_var(const comp_var_t &cv, const unsigned char *elements, size_t element_size, size_t n, double *values)
+{
+    const unsigned char *element = elements + cv.offset;
+    switch (cv.type)
+    {
+    case gta::int8:
+        get_values<int8_t>(element, element_size, n, values);
+        break;
+    case gta::uint8:
+        get_values<uint8_t>(element, element_size, n, values);
+        break;
+    case gta::int16:
+        get_values<int16_t>(element, element_size, n, values);
+        break;
+    case gta::uint16:
+        get_values<uint16_t>(element, element_size, n, values);
+        break;
+    case gta::int32:
+        get_values<int32_t>(element, element_size, n, values);
+        break;
+    case gta::uint32:
+        get_values<uint32_t>(element, element_size, n, values);
+        break;
+    case gta::int64:
+        get_values<int64_t>(element, element_size, n, values);
+        break;
+    case gta::uint64:
+        get_values<uint64_t>(element, element_size, n, values);
+        break;
+#ifdef HAVE_INT128_T
+    case gta::int128:
+        get_values<int128_t>(element, element_size, n, values);
+        break;
+#endif
+#ifdef HAVE_UINT128_T
+    case gta::uint128:
+        get_values<uint128_t>(element, element_size, n, values);
+        break;
+#endif
+    case gta::float32:
+        get_values<float>(element, element_size, n, values);
+        break;
+    case gta::float64:
+        get_values<double>(element, element_size, n, values);
+        break;
+#ifdef HAVE_FLOAT128_T
+    case gta::float128:
+        get_values<float128_t>(element, element_size, n, values);
+        break;
+#endif
+    default:
+        // cannot happen
+        assert(false);
+        break;
+    }
+}
+
+static void set_comp_var(const comp_var_t &cv, const double *values, size_t n, unsigned char *elements, size_t element_size)
+{
+    unsigned char *element = elements + cv.offset;
+    switch (cv.type)
+    {
+    case gta::int8:
+        set_values<int8_t>(values, n, element, element_size);
+        break;
+    case gta::uint8:
+        set_values<uint8_t>(values, n, element, element_size);
+        break;
+    case gta::int16:
+        set_values<int16_t>(values, n, element, element_size);
+        break;
+    case gta::uint16:
+        set_values<uint16_t>(values, n, element, element_size);
+        break;
+    case gta::int32:
+        set_values<int32_t>(values, n, element, element_size);
+        break;
+    case gta::uint32:
+        set_values<uint32_t>(values, n, element, element_size);
+        break;
+    case gta::int64:
+        set_values<int64_t>(values, n, element, element_size);
+        break;
+    case gta::uint64:
+        set_values<uint64_t>(values, n, element, element_size);
+        break;
+#ifdef HAVE_INT128_T
+    case gta::int128:
+        set_values<int128_t>(values, n, element, element_size);
+        break;
+#endif
+#ifdef HAVE_UINT128_T
+    case gta::uint128:
+        set_values<uint128_t>(values, n, element, element_size);
+        break;
+#endif
+    case gta::float32:
+        set_values<float>(values, n, element, element_size);
+        break;
+    case gta::float64:
+        set_values<double>(values, n, element, element_size);
+        break;
+#ifdef HAVE_FLOAT128_T
+    case gta::float128:
+        set_values<float128_t>(values, n, element, element_size);
+        break;
+#endif
+    default:
+        // cannot happen
+        assert(false);
+        break;
+    }
+}
+
+struct evaluator_t
+{
+    gta::header hdr;
+    std::vector<comp_var_t> comp_vars;
+    size_t bulk_size;
+    bool compatible_random;
+    rng_streams_t streams;
+    // Variable arrays: the component variables, then c, d, d0..d(d-1), and i0..i(d-1).
+    size_t dims;
+    size_t index_vars_index;
+    std::vector<double> var_arrays;
+    std::vector<double *> var;
+    std::vector<double> results;
+    std::vector<mu::Parser> parsers;
+
+    void init(const gta::header &hdri, const std::vector<comp_var_t> &cvs,
+            const std::vector<std::string> &expressions, size_t bs, bool compat,
+            uint64_t seed, uintmax_t array_index)
+    {
+        hdr = hdri;
+        comp_vars = cvs;
+        bulk_size = bs;
+        compatible_random = compat;
+        streams.init(seed, array_index, bulk_size);
+        dims = checked_cast<size_t>(hdr.dimensions());
+        const size_t comp_vars_index = 0;
+        const size_t components_var_index = comp_vars.size();
+        const size_t dimensions_var_index = components_var_index + 1;
+        const size_t dim_vars_index = dimensions_var_index + 1;
+        index_vars_index = dim_vars_index + dims;
+        const size_t vars = index_vars_index + dims;
+        var_arrays.resize(checked_mul(vars, bulk_size));
+        var.resize(vars);
+        for (size_t v = 0; v < vars; v++)
+        {
+            var[v] = &(var_arrays[v * bulk_size]);
+        }
+        std::fill(var[components_var_index], var[components_var_index] + bulk_size,
+                static_cast<double>(hdr.components()));
+        std::fill(var[dimensions_var_index], var[dimensions_var_index] + bulk_size,
+                static_cast<double>(hdr.dimensions()));
+        for (size_t i = 0; i < dims; i++)
+        {
+            std::fill(var[dim_vars_index + i], var[dim_vars_index + i] + bulk_size,
+                    static_cast<double>(hdr.dimension_size(i)));
+        }
+        results.resize(bulk_size);
+        parsers.resize(expressions.size());
+        for (size_t p = 0; p < expressions.size(); p++)
+        {
+            parsers[p].ClearConst();
+            parsers[p].DefineConst("e", e);
+            parsers[p].DefineConst("pi", pi);
+            parsers[p].DefineOprt("%", mod, mu::prMUL_DIV, mu::oaLEFT, true);
+            parsers[p].DefineFun("deg", deg);
+            parsers[p].DefineFun("rad", rad);
+            parsers[p].DefineFun("atan2", atan2);
+            parsers[p].DefineFun("fract", fract);
+            parsers[p].DefineFun("pow", pow);
+            parsers[p].DefineFun("exp2", exp2);
+            parsers[p].DefineFun("cbrt", cbrt);
+            parsers[p].DefineFun("int", int_);
+            parsers[p].DefineFun("ceil", ceil);
+            parsers[p].DefineFun("floor", floor);
+            parsers[p].DefineFun("round", round);
+            parsers[p].DefineFun("trunc", trunc);
+            parsers[p].DefineFun("med", med);
+            parsers[p].DefineFun("clamp", clamp);
+            parsers[p].DefineFun("step", step);
+            parsers[p].DefineFun("smoothstep", smoothstep);
+            parsers[p].DefineFun("mix", mix);
+            if (compatible_random)
+            {
+                parsers[p].DefineFun("random", my_random, false);
+                parsers[p].DefineFun("srand48", my_srand48, false);
+                parsers[p].DefineFun("drand48", drand48, false);
+            }
+            else
+            {
+                parsers[p].DefineFun("random", bulk_random, false);
+                parsers[p].DefineFun("srand48", bulk_srand48, false);
+                parsers[p].DefineFun("drand48", bulk_drand48, false);
+            }
+            parsers[p].DefineInfixOprt("+", unary_plus);
+            size_t v = comp_vars_index;
+            for (uintmax_t i = 0; i < hdr.components(); i++)
+            {
+                if (hdr.component_type(i) == gta::cfloat32
+                        || hdr.component_type(i) == gta::cfloat64
+                        || hdr.component_type(i) == gta::cfloat128)
+                {
+                    parsers[p].DefineVar(std::string("c") + str::from(i) + "re", var[v++]);
+                    parsers[p].DefineVar(std::string("c") + str::from(i) + "im", var[v++]);
+                }
+                else
+                {
+                    parsers[p].DefineVar(std::string("c") + str::from(i), var[v++]);
+                }
+            }
+            parsers[p].DefineVar("c", var[components_var_index]);
+            parsers[p].DefineVar("d", var[dimensions_var_index]);
+            for (size_t i = 0; i < dims; i++)
+            {
+                parsers[p].DefineVar(std::string("d") + str::from(i), var[dim_vars_index + i]);
+                parsers[p].DefineVar(std::string("i") + str::from(i), var[index_vars_index + i]);
+            }
+            parsers[p].SetExpr(expressions[p]);
+        }
+    }
+
+    // Compute n elements, starting with the element with the given index.
+    void compute(uintmax_t first_element, size_t n, unsigned char *elements)
+    {
+        const size_t element_size = checked_cast<size_t>(hdr.element_size());
+        std::vector<uintmax_t> index(dims);
+        uintmax_t rest = first_element;
+        for (size_t i = 0; i < dims; i++)
+        {
+            index[i] = rest % hdr.dimension_size(i);
+            rest /= hdr.dimension_size(i);
+        }
+        for (size_t k0 = 0; k0 < n; k0 += bulk_size)
+        {
+            const uintmax_t e = first_element + k0;
+            const size_t m = std::min(n - k0, bulk_size);
+            unsigned char *chunk = elements + k0 * element_size;
+            if (!compatible_random)
+            {
+                streams.start(e, m);
+            }
+            // set the variables
+            for (size_t k = 0; k < m; k++)
+            {
+                for (size_t i = 0; i < dims; i++)
+                {
+                    var[index_vars_index + i][k] = index[i];
+                }
+                for (size_t i = 0; i < dims && ++index[i] == hdr.dimension_size(i); i++)
+                {
+                    index[i] = 0;
+                }
+            }
+            for (size_t v = 0; v < comp_vars.size(); v++)
+            {
+                get_comp_var(comp_vars[v], chunk, element_size, m, var[v]);
+            }
+            // evaluate the expressions
+            rng_streams = &streams;
+            for (size_t p = 0; p < parsers.size(); p++)
+            {
+                if (m == 1)
+                {
+                    results[0] = parsers[p].Eval();
+                }
+                else
+                {
+                    parsers[p].Eval(&(results[0]), m);
+                }
+            }
+            // read back the component variables
+            for (size_t v = 0; v < comp_vars.size(); v++)
+            {
+                set_comp_var(comp_vars[v], var[v], m, chunk, element_size);
+            }
+        }
+    }
+};
+
+/* Compute a batch of elements. Each call of run() uses an evaluator that is
+ * not in use by another thread. */
+class compute_job_t : public block_job_t
+{
+private:
+    std::mutex _mutex;
+    std::vector<evaluator_t *> _idle;
+
+public:
+    uintmax_t first_element;
+    size_t n;
+    unsigned char *elements;
+    size_t element_size;
+
+    compute_job_t(std::vector<evaluator_t> &evaluators) : first_element(0), n(0), elements(NULL), element_size(0)
+    {
+        for (size_t j = 0; j < evaluators.size(); j++)
+        {
+            _idle.push_back(&(evaluators[j]));
+        }
+    }
+
+    void run(size_t first_block, size_t blocks)
+    {
+        evaluator_t *evaluator;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            evaluator = _idle.back();
+            _idle.pop_back();
+        }
+        std::exception_ptr exception;
+        try
+        {
+            size_t offset = first_block * block_size;
+            evaluator->compute(first_element + offset, std::min(n - offset, blocks * block_size),
+                    elements + offset * element_size);
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _idle.push_back(evaluator);
+        }
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
 extern "C" int gtatool_component_compute(int argc, char *argv[])
 {
     std::vector<opt::option *> options;
@@ -167,6 +721,12 @@ extern "C" int gtatool_component_compute(int argc, char *argv[])
     options.push_back(&help);
     opt::string expressions("expression", 'e', opt::required);
     options.push_back(&expressions);
+    opt::val<int> jobs("jobs", 'j', opt::optional, 1, 1024, processor_count());
+    options.push_back(&jobs);
+    opt::val<uint64_t> seed("seed", '\0', opt::optional);
+    options.push_back(&seed);
+    opt::flag compatible_random("compatible-random", '\0', opt::optional);
+    options.push_back(&compatible_random);
     std::vector<std::string> arguments;
     if (!opt::parse(argc, argv, options, -1, -1, arguments))
     {
@@ -178,6 +738,10 @@ extern "C" int gtatool_component_compute(int argc, char *argv[])
         return 0;
     }
 
+    const size_t bulk_size = (compatible_random.value() || !bulk_mode_usable() ? 1 : block_size);
+    const size_t threads = (compatible_random.value() ? 1 : jobs.value());
+    const uint64_t random_seed = (seed.values().empty() ? random_seed_from_system() : seed.value());
+
     try
     {
         array_loop_t array_loop;
@@ -186,8 +750,9 @@ extern "C" int gtatool_component_compute(int argc, char *argv[])
         array_loop.start(arguments, "");
         while (array_loop.read(hdri, namei))
         {
-            // Set up variables
-            std::vector<double> comp_vars;
+            // Determine the component variables
+            std::vector<comp_var_t> comp_vars;
+            size_t comp_offset = 0;
             for (uintmax_t i = 0; i < hdri.components(); i++)
             {
                 if (hdri.component_type(i) == gta::blob)
@@ -212,73 +777,38 @@ extern "C" int gtatool_component_compute(int argc, char *argv[])
                             + type_to_string(hdri.component_type(i), hdri.component_size(i))
                             + " on this platform");
                 }
-                if (hdri.component_type(i) == gta::cfloat32
-                        || hdri.component_type(i) == gta::cfloat64
-                        || hdri.component_type(i) == gta::cfloat128)
-                {
-                    comp_vars.push_back(0.0);
-                    comp_vars.push_back(0.0);
-                }
-                else
+                comp_var_t cv;
+                cv.offset = comp_offset;
+                switch (hdri.component_type(i))
                 {
-                    comp_vars.push_back(0.0);
+                case gta::cfloat32:
+                    cv.type = gta::float32;
+                    comp_vars.push_back(cv);
+                    cv.offset += sizeof(float);
+                    break;
+                case gta::cfloat64:
+                    cv.type = gta::float64;
+                    comp_vars.push_back(cv);
+                    cv.offset += sizeof(double);
+                    break;
+                case gta::cfloat128:
+                    cv.type = gta::float128;
+                    comp_vars.push_back(cv);
+                    cv.offset += hdri.component_size(i) / 2;
+                    break;
+                default:
+                    cv.type = hdri.component_type(i);
+                    break;
                 }
+                comp_vars.push_back(cv);
+                comp_offset += checked_cast<size_t>(hdri.component_size(i));
             }
-            double components_var;
-            double dimensions_var;
-            std::vector<double> dim_vars(checked_cast<size_t>(hdri.dimensions()));
-            std::vector<uintmax_t> index_vars_orig(hdri.dimensions());
-            std::vector<double> index_vars(hdri.dimensions());
-            std::vector<mu::Parser> parsers;
-            parsers.resize(expressions.values().size());
-            for (size_t p = 0; p < expressions.values().size(); p++)
+            // Set up one evaluator per thread. This also checks the expressions.
+            std::vector<evaluator_t> evaluators(threads);
+            for (size_t j = 0; j < threads; j++)
             {
-                parsers[p].ClearConst();
-                parsers[p].DefineConst("e", e);
-                parsers[p].DefineConst("pi", pi);
-                parsers[p].DefineOprt("%", mod, mu::prMUL_DIV, mu::oaLEFT, true);
-                parsers[p].DefineFun("deg", deg);
-                parsers[p].DefineFun("rad", rad);
-                parsers[p].DefineFun("atan2", atan2);
-                parsers[p].DefineFun("fract", fract);
-                parsers[p].DefineFun("pow", pow);
-                parsers[p].DefineFun("exp2", exp2);
-                parsers[p].DefineFun("cbrt", cbrt);
-                parsers[p].DefineFun("int", int_);
-                parsers[p].DefineFun("ceil", ceil);
-                parsers[p].DefineFun("floor", floor);
-                parsers[p].DefineFun("round", round);
-                parsers[p].DefineFun("trunc", trunc);
-                parsers[p].DefineFun("med", med);
-                parsers[p].DefineFun("clamp", clamp);
-                parsers[p].DefineFun("step", step);
-                parsers[p].DefineFun("smoothstep", smoothstep);
-                parsers[p].DefineFun("mix", mix);
-                parsers[p].DefineFun("random", my_random, false);
-                parsers[p].DefineFun("srand48", my_srand48, false);
-                parsers[p].DefineFun("drand48", drand48, false);
-                parsers[p].DefineInfixOprt("+", unary_plus);
-                size_t comp_vars_index = 0;
-                for (uintmax_t i = 0; i < hdri.components(); i++)
-                {
-                    if (hdri.component_type(i) == gta::cfloat32 || hdri.component_type(i) == gta::cfloat64)
-                    {
-                        parsers[p].DefineVar(std::string("c") + str::from(i) + "re", &(comp_vars[comp_vars_index++]));
-                        parsers[p].DefineVar(std::string("c") + str::from(i) + "im", &(comp_vars[comp_vars_index++]));
-                    }
-                    else
-                    {
-                        parsers[p].DefineVar(std::string("c") + str::from(i), &(comp_vars[comp_vars_index++]));
-                    }
-                }
-                parsers[p].DefineVar("c", &components_var);
-                parsers[p].DefineVar("d", &dimensions_var);
-                for (uintmax_t i = 0; i < hdri.dimensions(); i++)
-                {
-                    parsers[p].DefineVar(std::string("d") + str::from(i), &(dim_vars[i]));
-                    parsers[p].DefineVar(std::string("i") + str::from(i), &(index_vars[i]));
-                }
-                parsers[p].SetExpr(expressions.values()[p]);
+                evaluators[j].init(hdri, comp_vars, expressions.values(), bulk_size,
+                        compatible_random.value(), random_seed, array_loop.index_in());
             }
 
             hdro = hdri;
@@ -288,281 +818,20 @@ extern "C" int gtatool_component_compute(int argc, char *argv[])
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                blob element(checked_cast<size_t>(hdri.element_size()));
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                const size_t element_size = checked_cast<size_t>(hdri.element_size());
+                const size_t batch_size = threads * blocks_per_job * block_size;
+                blob elements(std::min(hdro.elements(), static_cast<uintmax_t>(batch_size)), element_size);
+                compute_job_t job(evaluators);
+                job.elements = elements.ptr<unsigned char>();
+                job.element_size = element_size;
+                for (uintmax_t e = 0; e < hdro.elements(); e += batch_size)
                 {
-                    std::memcpy(element.ptr(), element_loop.read(), hdri.element_size());
-                    // set the variables
-                    components_var = hdri.components();
-                    dimensions_var = hdri.dimensions();
-                    for (uintmax_t i = 0; i < hdri.dimensions(); i++)
-                    {
-                        dim_vars[i] = hdri.dimension_size(i);
-                    }
-                    hdri.linear_index_to_indices(e, &(index_vars_orig[0]));
-                    for (uintmax_t i = 0; i < hdri.dimensions(); i++)
-                    {
-                        index_vars[i] = index_vars_orig[i];
-                    }
-                    size_t comp_var_index = 0;
-                    for (uintmax_t i = 0; i < hdri.components(); i++)
-                    {
-                        switch (hdri.component_type(i))
-                        {
-                        case gta::int8:
-                            {
-                                int8_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(int8_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::uint8:
-                            {
-                                uint8_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(uint8_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::int16:
-                            {
-                                int16_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(int16_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::uint16:
-                            {
-                                uint16_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(uint16_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::int32:
-                            {
-                                int32_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(int32_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::uint32:
-                            {
-                                uint32_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(uint32_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::int64:
-                            {
-                                int64_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(int64_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::uint64:
-                            {
-                                uint64_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(uint64_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-#ifdef HAVE_INT128_T
-                        case gta::int128:
-                            {
-                                int128_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(int128_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-#endif
-#ifdef HAVE_UINT128_T
-                        case gta::uint128:
-                            {
-                                uint128_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(uint128_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-#endif
-                        case gta::float32:
-                            {
-                                float v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(float));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::float64:
-                            {
-                                double v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(double));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-#ifdef HAVE_FLOAT128_T
-                        case gta::float128:
-                            {
-                                float128_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(float128_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-#endif
-                        case gta::cfloat32:
-                            {
-                                float v[2];
-                                std::memcpy(v, hdri.component(element.ptr(), i), 2 * sizeof(float));
-                                comp_vars[comp_var_index++] = v[0];
-                                comp_vars[comp_var_index++] = v[1];
-                            }
-                            break;
-                        case gta::cfloat64:
-                            {
-                                double v[2];
-                                std::memcpy(v, hdri.component(element.ptr(), i), 2 * sizeof(double));
-                                comp_vars[comp_var_index++] = v[0];
-                                comp_vars[comp_var_index++] = v[1];
-                            }
-                            break;
-#ifdef HAVE_FLOAT128_T
-                        case gta::cfloat128:
-                            {
-                                float128_t v[2];
-                                std::memcpy(v, hdri.component(element.ptr(), i), 2 * sizeof(float128_t));
-                                comp_vars[comp_var_index++] = v[0];
-                                comp_vars[comp_var_index++] = v[1];
-                            }
-                            break;
-#endif
-                        default:
-                            // cannot happen
-                            assert(false);
-                            break;
-                        }
-                    }
-                    // evaluate the expressions
-                    for (size_t p = 0; p < parsers.size(); p++)
-                    {
-                        parsers[p].Eval();
-                    }
-                    // read back the component variables
-                    comp_var_index = 0;
-                    for (uintmax_t i = 0; i < hdro.components(); i++)
-                    {
-                        switch (hdro.component_type(i))
-                        {
-                        case gta::int8:
-                            {
-                                int8_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(int8_t));
-                            }
-                            break;
-                        case gta::uint8:
-                            {
-                                uint8_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(uint8_t));
-                            }
-                            break;
-                        case gta::int16:
-                            {
-                                int16_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(int16_t));
-                            }
-                            break;
-                        case gta::uint16:
-                            {
-                                uint16_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(uint16_t));
-                            }
-                            break;
-                        case gta::int32:
-                            {
-                                int32_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(int32_t));
-                            }
-                            break;
-                        case gta::uint32:
-                            {
-                                uint32_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(uint32_t));
-                            }
-                            break;
-                        case gta::int64:
-                            {
-                                int64_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(int64_t));
-                            }
-                            break;
-                        case gta::uint64:
-                            {
-                                uint64_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(uint64_t));
-                            }
-                            break;
-#ifdef HAVE_INT128_T
-                        case gta::int128:
-                            {
-                                int128_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(int128_t));
-                            }
-                            break;
-#endif
-#ifdef HAVE_UINT128_T
-                        case gta::uint128:
-                            {
-                                uint128_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(uint128_t));
-                            }
-                            break;
-#endif
-                        case gta::float32:
-                            {
-                                float v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(float));
-                            }
-                            break;
-                        case gta::float64:
-                            {
-                                double v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(double));
-                            }
-                            break;
-#ifdef HAVE_FLOAT128_T
-                        case gta::float128:
-                            {
-                                float128_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(float128_t));
-                            }
-                            break;
-#endif
-                        case gta::cfloat32:
-                            {
-                                float v[2] = { static_cast<float>(comp_vars[comp_var_index]), static_cast<float>(comp_vars[comp_var_index + 1]) };
-                                comp_var_index += 2;
-                                std::memcpy(hdri.component(element.ptr(), i), v, 2 * sizeof(float));
-                            }
-                            break;
-                        case gta::cfloat64:
-                            {
-                                double v[2] = { comp_vars[comp_var_index], comp_vars[comp_var_index + 1] };
-                                comp_var_index += 2;
-                                std::memcpy(hdri.component(element.ptr(), i), v, 2 * sizeof(double));
-                            }
-                            break;
-#ifdef HAVE_FLOAT128_T
-                        case gta::cfloat128:
-                            {
-                                float128_t v[2] = { comp_vars[comp_var_index], comp_vars[comp_var_index + 1] };
-                                comp_var_index += 2;
-                                std::memcpy(hdri.component(element.ptr(), i), v, 2 * sizeof(float128_t));
-                            }
-                            break;
-#endif
-                        default:
-                            // cannot happen
-                            assert(false);
-                            break;
-                        }
-                    }
-                    element_loop.write(element.ptr());
+                    size_t n = checked_cast<size_t>(std::min(hdro.elements() - e, static_cast<uintmax_t>(batch_size)));
+                    std::memcpy(elements.ptr(), element_loop.read(n), n * element_size);
+                    job.first_element = e;
+                    job.n = n;
+                    run_blocks(job, (n - 1) / block_size + 1, threads);
+                    element_loop.write(elements.ptr(), n);
                 }
             }
         }
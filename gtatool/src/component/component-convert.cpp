@@ -27,6 +27,9 @@
 #include <cstdint>
 #include <cctype>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
 
 #include <gta/gta.hpp>
 
@@ -817,6 +820,354 @@ static void convert(void *dst, gta::type dst_type, const void *src, gta::type sr
     }
 }
 
+/* Conversion plans.
+ *
+ * The convert() function above handles every pair of types, but it goes
+ * through maximum-width intermediate types for each single value. For each
+ * array, we therefore set up a plan with one conversion per component. Each
+ * conversion has a kernel function that converts this component for a block
+ * of elements. For common pairs of types, the kernels are specialized
+ * templates that the compiler can vectorize; they are designed to give the
+ * same results as convert(). All other pairs use a kernel that calls
+ * convert() for each value. */
+
+// Maximum size of the input or output data of a block of elements.
+static const size_t max_block_bytes = 64 * 1024;
+
+struct conversion_t;
+
+typedef void (*conversion_kernel_t)(const conversion_t &c,
+        const unsigned char *src, size_t src_stride,
+        unsigned char *dst, size_t dst_stride, size_t n);
+
+struct conversion_t
+{
+    gta::type src_type;
+    size_t src_offset;
+    size_t src_size;
+    gta::type dst_type;
+    size_t dst_offset;
+    size_t dst_size;
+    bool normalize;
+    conversion_kernel_t kernel;
+};
+
+static void generic_kernel(const conversion_t &c,
+        const unsigned char *src, size_t src_stride,
+        unsigned char *dst, size_t dst_stride, size_t n)
+{
+    for (size_t k = 0; k < n; k++)
+    {
+        convert(dst + k * dst_stride, c.dst_type, src + k * src_stride, c.src_type, c.normalize);
+    }
+}
+
+static void copy_kernel(const conversion_t &c,
+        const unsigned char *src, size_t src_stride,
+        unsigned char *dst, size_t dst_stride, size_t n)
+{
+    for (size_t k = 0; k < n; k++)
+    {
+        std::memcpy(dst + k * dst_stride, src + k * src_stride, c.src_size);
+    }
+}
+
+// Apply a value conversion operation to a block of values.
+// The common case of contiguous values gets its own loop.
+template<typename S, typename D, typename OP>
+static void apply(const OP &op,
+        const unsigned char *src, size_t src_stride,
+        unsigned char *dst, size_t dst_stride, size_t n)
+{
+    if (src_stride == sizeof(S) && dst_stride == sizeof(D))
+    {
+        for (size_t k = 0; k < n; k++)
+        {
+            S v;
+            std::memcpy(&v, src + k * sizeof(S), sizeof(S));
+            D d = op(v);
+            std::memcpy(dst + k * sizeof(D), &d, sizeof(D));
+        }
+    }
+    else
+    {
+        for (size_t k = 0; k < n; k++)
+        {
+            S v;
+            std::memcpy(&v, src + k * src_stride, sizeof(S));
+            D d = op(v);
+            std::memcpy(dst + k * dst_stride, &d, sizeof(D));
+        }
+    }
+}
+
+// Integer to integer: negative values become zero for unsigned types,
+// and values are truncated to the destination width.
+template<typename S, typename D>
+struct int_to_int_op
+{
+    D operator()(S v) const
+    {
+        return (std::numeric_limits<D>::is_signed || v >= static_cast<S>(0) ? static_cast<D>(v) : 0);
+    }
+};
+
+// Integer to floating point. With normalization, the quotient is computed in
+// double precision, which is exact enough for 8 and 16 bit integers to round
+// to the same result as the maximum-width computation.
+template<typename S, typename D>
+struct int_to_float_op
+{
+    D operator()(S v) const
+    {
+        return v;
+    }
+};
+
+template<typename S, typename D>
+struct int_to_float_normalized_op
+{
+    D operator()(S v) const
+    {
+        double x = v;
+        if (v < 0)
+            x /= -1.0 * std::numeric_limits<S>::min();
+        else if (v > 0)
+            x /= std::numeric_limits<S>::max();
+        return x;
+    }
+};
+
+template<typename S, typename D>
+struct float_to_float_op
+{
+    D operator()(S v) const
+    {
+        return v;
+    }
+};
+
+// Floating point to integer. Values whose integer part does not fit into
+// 63 bits are rare; they are handed to convert().
+template<typename S, typename D>
+struct float_to_int_op
+{
+    const conversion_t *c;
+
+    D operator()(S v) const
+    {
+        const S limit = static_cast<S>(UINT64_C(1) << 62);
+        if (std::numeric_limits<D>::is_signed ? !std::isfinite(v) : (!(v >= 0) || !std::isfinite(v)))
+        {
+            return 0;
+        }
+        else if (v > -limit && v < limit)
+        {
+            return static_cast<D>(static_cast<int64_t>(v));
+        }
+        else
+        {
+            D d;
+            convert(&d, c->dst_type, &v, c->src_type, false);
+            return d;
+        }
+    }
+};
+
+template<typename S, typename D>
+struct float_to_int_normalized_op
+{
+    float_to_int_op<S, D> op;
+
+    D operator()(S v) const
+    {
+        if (std::numeric_limits<D>::is_signed)
+        {
+            if (v < -1)
+                v = -1;
+            else if (v > 1)
+                v = 1;
+            if (v < 0)
+                v *= static_cast<S>(-1) * static_cast<S>(std::numeric_limits<D>::min());
+            if (v > 0)
+                v *= static_cast<S>(std::numeric_limits<D>::max());
+        }
+        else
+        {
+            if (v < 0)
+                v = 0;
+            else if (v > 1)
+                v = 1;
+            v *= static_cast<S>(std::numeric_limits<D>::max());
+        }
+        return op(v);
+    }
+};
+
+template<typename S, typename D>
+static void int_to_int_kernel(const conversion_t &,
+        const unsigned char *src, size_t src_stride,
+        unsigned char *dst, size_t dst_stride, size_t n)
+{
+    apply<S, D>(int_to_int_op<S, D>(), src, src_stride, dst, dst_stride, n);
+}
+
+template<typename S, typename D>
+static void int_to_float_kernel(const conversion_t &c,
+        const unsigned char *src, size_t src_stride,
+        unsigned char *dst, size_t dst_stride, size_t n)
+{
+    if (c.normalize)
+        apply<S, D>(int_to_float_normalized_op<S, D>(), src, src_stride, dst, dst_stride, n);
+    else
+        apply<S, D>(int_to_float_op<S, D>(), src, src_stride, dst, dst_stride, n);
+}
+
+template<typename S, typename D>
+static void float_to_float_kernel(const conversion_t &,
+        const unsigned char *src, size_t src_stride,
+        unsigned char *dst, size_t dst_stride, size_t n)
+{
+    apply<S, D>(float_to_float_op<S, D>(), src, src_stride, dst, dst_stride, n);
+}
+
+template<typename S, typename D>
+static void float_to_int_kernel(const conversion_t &c,
+        const unsigned char *src, size_t src_stride,
+        unsigned char *dst, size_t dst_stride, size_t n)
+{
+    float_to_int_op<S, D> op;
+    op.c = &c;
+    if (c.normalize)
+    {
+        float_to_int_normalized_op<S, D> nop;
+        nop.op = op;
+        apply<S, D>(nop, src, src_stride, dst, dst_stride, n);
+    }
+    else
+    {
+        apply<S, D>(op, src, src_stride, dst, dst_stride, n);
+    }
+}
+
+// Select a kernel for an integer source type
+template<typename S, typename D>
+static conversion_kernel_t select_kernel(bool normalize, std::true_type)
+{
+    if (std::numeric_limits<D>::is_integer)
+        return int_to_int_kernel<S, D>;
+    else if (!normalize || sizeof(S) <= 2)
+        return int_to_float_kernel<S, D>;
+    else
+        return generic_kernel;
+}
+
+// Select a kernel for a floating point source type
+template<typename S, typename D>
+static conversion_kernel_t select_kernel(bool normalize, std::false_type)
+{
+    if (!std::numeric_limits<D>::is_integer)
+        return float_to_float_kernel<S, D>;
+    // The maximum-width code normalizes float64 to unsigned integers
+    // differently than float32, so we leave this case to it.
+    else if (!normalize || std::numeric_limits<D>::is_signed || sizeof(S) == sizeof(float))
+        return float_to_int_kernel<S, D>;
+    else
+        return generic_kernel;
+}
+
+template<typename S, typename D>
+static conversion_kernel_t select_kernel(bool normalize)
+{
+    return select_kernel<S, D>(normalize, std::is_integral<S>());
+}
+
+template<typename S>
+static conversion_kernel_t select_kernel(gta::type dst_type, bool normalize)
+{
+    switch (dst_type)
+    {
+    case gta::int8:
+        return select_kernel<S, int8_t>(normalize);
+    case gta::uint8:
+        return select_kernel<S, uint8_t>(normalize);
+    case gta::int16:
+        return select_kernel<S, int16_t>(normalize);
+    case gta::uint16:
+        return select_kernel<S, uint16_t>(normalize);
+    case gta::int32:
+        return select_kernel<S, int32_t>(normalize);
+    case gta::uint32:
+        return select_kernel<S, uint32_t>(normalize);
+    case gta::int64:
+        return select_kernel<S, int64_t>(normalize);
+    case gta::uint64:
+        return select_kernel<S, uint64_t>(normalize);
+    case gta::float32:
+        return select_kernel<S, float>(normalize);
+    case gta::float64:
+        return select_kernel<S, double>(normalize);
+    default:
+        return generic_kernel;
+    }
+}
+
+static conversion_kernel_t select_kernel(gta::type src_type, gta::type dst_type, bool normalize)
+{
+    if (src_type == dst_type)
+    {
+        // convert() does not change values of the same type
+        return copy_kernel;
+    }
+    switch (src_type)
+    {
+    case gta::int8:
+        return select_kernel<int8_t>(dst_type, normalize);
+    case gta::uint8:
+        return select_kernel<uint8_t>(dst_type, normalize);
+    case gta::int16:
+        return select_kernel<int16_t>(dst_type, normalize);
+    case gta::uint16:
+        return select_kernel<uint16_t>(dst_type, normalize);
+    case gta::int32:
+        return select_kernel<int32_t>(dst_type, normalize);
+    case gta::uint32:
+        return select_kernel<uint32_t>(dst_type, normalize);
+    case gta::int64:
+        return select_kernel<int64_t>(dst_type, normalize);
+    case gta::uint64:
+        return select_kernel<uint64_t>(dst_type, normalize);
+    case gta::float32:
+        return select_kernel<float>(dst_type, normalize);
+    case gta::float64:
+        return select_kernel<double>(dst_type, normalize);
+    default:
+        return generic_kernel;
+    }
+}
+
+static std::vector<conversion_t> conversion_plan(const gta::header &hdri, const gta::header &hdro, bool normalize)
+{
+    std::vector<conversion_t> plan(checked_cast<size_t>(hdro.components()));
+    size_t src_offset = 0;
+    size_t dst_offset = 0;
+    for (size_t i = 0; i < plan.size(); i++)
+    {
+        conversion_t &c = plan[i];
+        c.src_type = hdri.component_type(i);
+        c.src_offset = src_offset;
+        c.src_size = checked_cast<size_t>(hdri.component_size(i));
+        c.dst_type = hdro.component_type(i);
+        c.dst_offset = dst_offset;
+        c.dst_size = checked_cast<size_t>(hdro.component_size(i));
+        c.normalize = normalize;
+        c.kernel = select_kernel(c.src_type, c.dst_type, normalize);
+        src_offset += c.src_size;
+        dst_offset += c.dst_size;
+    }
+    return plan;
+}
+
 extern "C" void gtatool_component_convert_help(void)
 {
     msg::req_txt(
@@ -929,21 +1280,29 @@ extern "C" int gtatool_component_convert(int argc, char *argv[])
                 hdro.component_taglist(i) = hdri.component_taglist(i);
             }
             array_loop.write(hdro, nameo);
+            if (hdro.data_size() == 0)
+            {
+                continue;
+            }
+            const std::vector<conversion_t> plan = conversion_plan(hdri, hdro, normalize.value());
+            const size_t element_size_in = checked_cast<size_t>(hdri.element_size());
+            const size_t element_size_out = checked_cast<size_t>(hdro.element_size());
+            const size_t block_size = std::max(static_cast<size_t>(1),
+                    max_block_bytes / std::max(element_size_in, element_size_out));
             element_loop_t element_loop;
             array_loop.start_element_loop(element_loop, hdri, hdro);
-            blob element_out(checked_cast<size_t>(hdro.element_size()));
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            blob elements_out(block_size, element_size_out);
+            for (uintmax_t e = 0; e < hdro.elements(); e += block_size)
             {
-                const void *src = element_loop.read();
-                for (uintmax_t i = 0; i < hdro.components(); i++)
+                size_t n = checked_cast<size_t>(std::min(hdro.elements() - e, static_cast<uintmax_t>(block_size)));
+                const unsigned char *src = static_cast<const unsigned char *>(element_loop.read(n));
+                for (size_t i = 0; i < plan.size(); i++)
                 {
-                    convert(hdro.component(element_out.ptr(), i),
-                            hdro.component_type(i),
-                            hdri.component(src, i),
-                            hdri.component_type(i),
-                            normalize.value());
+                    plan[i].kernel(plan[i],
+                            src + plan[i].src_offset, element_size_in,
+                            elements_out.ptr<unsigned char>(plan[i].dst_offset), element_size_out, n);
                 }
-                element_loop.write(element_out.ptr());
+                element_loop.write(elements_out.ptr(), n);
             }
         }
         array_loop.finish();
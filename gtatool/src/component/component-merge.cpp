@@ -24,6 +24,7 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <algorithm>
 #include <vector>
 
 #include <gta/gta.hpp>
@@ -147,20 +148,36 @@ extern "C" int gtatool_component_merge(int argc, char *argv[])
             array_loops[0].write(hdro, nameo);
             if (hdro.data_size() > 0)
             {
+                // Each output element is the concatenation of the input elements
+                std::vector<size_t> element_sizes(arguments.size());
+                for (size_t i = 0; i < arguments.size(); i++)
+                {
+                    element_sizes[i] = checked_cast<size_t>(hdris[i].element_size());
+                }
+                component_shuffle_t shuffle;
+                shuffle.start(element_sizes, checked_cast<size_t>(hdro.element_size()));
+                size_t offset = 0;
+                for (size_t i = 0; i < arguments.size(); i++)
+                {
+                    shuffle.add(i, 0, offset, element_sizes[i]);
+                    offset += element_sizes[i];
+                }
+                shuffle.finish();
                 element_loop_t element_loop;
                 array_loops[0].start_element_loop(element_loop, hdris[0], hdro);
-                blob element_out(checked_cast<size_t>(hdro.element_size()));
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                const size_t block_elements = shuffle.block_elements();
+                blob block_out(checked_cast<size_t>(hdro.element_size()), block_elements);
+                std::vector<const void *> blocks_in(arguments.size());
+                for (uintmax_t e = 0; e < hdro.elements(); e += block_elements)
                 {
-                    void *p = element_out.ptr();
-                    std::memcpy(p, element_loop.read(), hdris[0].element_size());
-                    p = static_cast<void *>(static_cast<char *>(p) + hdris[0].element_size());
-                    for (size_t i = 1; i < arguments.size(); i++)
+                    size_t n = checked_cast<size_t>(std::min(static_cast<uintmax_t>(block_elements), hdro.elements() - e));
+                    for (size_t i = 0; i < arguments.size(); i++)
                     {
-                        std::memcpy(p, element_loops[i].read(), hdris[i].element_size());
-                        p = static_cast<void *>(static_cast<char *>(p) + hdris[i].element_size());
+                        blocks_in[i] = (element_sizes[i] == 0 ? NULL
+                                : i == 0 ? element_loop.read(n) : element_loops[i].read(n));
                     }
-                    element_loop.write(element_out.ptr());
+                    shuffle.run(n, &(blocks_in[0]), block_out.ptr());
+                    element_loop.write(block_out.ptr(), n);
                 }
             }
         }
@@ -24,6 +24,7 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <algorithm>
 
 #include <gta/gta.hpp>
 
@@ -122,26 +123,27 @@ extern "C" int gtatool_component_reorder(int argc, char *argv[])
             array_loop.write(hdro, nameo);
             if (hdro.data_size() > 0)
             {
+                std::vector<size_t> offsets_in = component_offsets(hdri);
+                std::vector<size_t> offsets_out = component_offsets(hdro);
+                component_shuffle_t shuffle;
+                shuffle.start(std::vector<size_t>(1, checked_cast<size_t>(hdri.element_size())),
+                        checked_cast<size_t>(hdro.element_size()));
+                for (size_t i = 0; i < offsets_out.size(); i++)
+                {
+                    size_t j = (indices.value().empty() ? i : checked_cast<size_t>(indices.value()[i]));
+                    shuffle.add(0, offsets_in[j], offsets_out[i], checked_cast<size_t>(hdro.component_size(i)));
+                }
+                shuffle.finish();
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                blob element_out(checked_cast<size_t>(hdro.element_size()));
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                const size_t block_elements = shuffle.block_elements();
+                blob block_out(checked_cast<size_t>(hdro.element_size()), block_elements);
+                for (uintmax_t e = 0; e < hdro.elements(); e += block_elements)
                 {
-                    const void *element_in = element_loop.read();
-                    if (!indices.value().empty())
-                    {
-                        for (uintmax_t i = 0; i < hdro.components(); i++)
-                        {
-                            std::memcpy(hdro.component(element_out.ptr(), i),
-                                    hdri.component(element_in, indices.value()[i]),
-                                hdro.component_size(i));
-                        }
-                    }
-                    else
-                    {
-                        std::memcpy(element_out.ptr(), element_in, hdro.element_size());
-                    }
-                    element_loop.write(element_out.ptr());
+                    size_t n = checked_cast<size_t>(std::min(static_cast<uintmax_t>(block_elements), hdro.elements() - e));
+                    const void *block_in = element_loop.read(n);
+                    shuffle.run(n, &block_in, block_out.ptr());
+                    element_loop.write(block_out.ptr(), n);
                 }
             }
         }
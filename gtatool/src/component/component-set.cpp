@@ -24,6 +24,7 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <algorithm>
 
 #include <gta/gta.hpp>
 
@@ -119,19 +120,43 @@ extern "C" int gtatool_component_set(int argc, char *argv[])
             array_loop.write(hdro, nameo);
             if (hdro.data_size() > 0)
             {
-                element_loop_t element_loop;
-                array_loop.start_element_loop(element_loop, hdri, hdro);
-                blob element(checked_cast<size_t>(hdri.element_size()));
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                // Source 0 is the input element, source 1 the constant new values
+                std::vector<size_t> offsets = component_offsets(hdri);
+                std::vector<size_t> offsets_values = component_offsets(hdrt);
+                std::vector<size_t> value_index(offsets.size(), offsets.size());
+                for (size_t i = 0; i < current_indices.size(); i++)
                 {
-                    std::memcpy(element.ptr(), element_loop.read(), hdri.element_size());
-                    for (size_t i = 0; i < current_indices.size(); i++)
+                    value_index[current_indices[i]] = i;
+                }
+                std::vector<size_t> strides(2);
+                strides[0] = checked_cast<size_t>(hdri.element_size());
+                strides[1] = 0;
+                component_shuffle_t shuffle;
+                shuffle.start(strides, strides[0]);
+                for (size_t c = 0; c < offsets.size(); c++)
+                {
+                    size_t size = checked_cast<size_t>(hdri.component_size(c));
+                    if (value_index[c] < offsets.size())
+                    {
+                        shuffle.add(1, offsets_values[value_index[c]], offsets[c], size);
+                    }
+                    else
                     {
-                        void *component_dst = hdri.component(element.ptr(), current_indices[i]);
-                        void *component_src = hdrt.component(comp_values.ptr(), i);
-                        memcpy(component_dst, component_src, hdri.component_size(current_indices[i]));
+                        shuffle.add(0, offsets[c], offsets[c], size);
                     }
-                    element_loop.write(element.ptr());
+                }
+                shuffle.finish();
+                element_loop_t element_loop;
+                array_loop.start_element_loop(element_loop, hdri, hdro);
+                const size_t block_elements = shuffle.block_elements();
+                blob block_out(strides[0], block_elements);
+                const void *srcs[2] = { NULL, comp_values.ptr() };
+                for (uintmax_t e = 0; e < hdro.elements(); e += block_elements)
+                {
+                    size_t n = checked_cast<size_t>(std::min(static_cast<uintmax_t>(block_elements), hdro.elements() - e));
+                    srcs[0] = element_loop.read(n);
+                    shuffle.run(n, srcs, block_out.ptr());
+                    element_loop.write(block_out.ptr(), n);
                 }
             }
         }
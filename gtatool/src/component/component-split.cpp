@@ -24,6 +24,7 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <algorithm>
 
 #include <gta/gta.hpp>
 
@@ -37,6 +38,9 @@
 #include "lib.h"
 
 
+/* Input data is processed in blocks of this size (in bytes) */
+static const size_t block_size = 1024 * 1024;
+
 extern "C" void gtatool_component_split_help(void)
 {
     msg::req_txt(
@@ -102,59 +106,96 @@ extern "C" int gtatool_component_split(int argc, char *argv[])
                 }
                 comp_indices.push_back(i);
             }
-            // Define the GTA headers and create temporary files
+            // Define the GTA headers
             std::vector<gta::header> hdros(comp_indices.size());
             std::vector<std::string> nameos(hdros.size());
-            std::vector<FILE *> tmpfiles(hdros.size());
-            std::vector<std::string> tmpfilenames(hdros.size());
-            std::vector<array_loop_t> tmpaloops(hdros.size());
-            std::vector<element_loop_t> tmpeloops(hdros.size());
-            std::vector<std::string> tmpnameos(hdros.size());
+            const size_t element_size = checked_cast<size_t>(hdri.element_size());
+            const std::vector<size_t> comp_offsets = component_offsets(hdri);
+            std::vector<component_shuffle_t> shuffles(hdros.size());
             for (size_t i = 0; i < hdros.size(); i++)
             {
                 hdros[i] = hdri;
                 hdros[i].set_compression(gta::none);
                 hdros[i].set_components(hdri.component_type(comp_indices[i]), hdri.component_size(comp_indices[i]));
                 hdros[i].component_taglist(0) = hdri.component_taglist(comp_indices[i]);
-                tmpfilenames[i] = fio::mktempfile(&(tmpfiles[i]));
-                tmpaloops[i].start("", tmpfilenames[i]);
-                tmpaloops[i].start_element_loop(tmpeloops[i], hdri, hdros[i]);
+                const size_t comp_size = checked_cast<size_t>(hdros[i].element_size());
+                shuffles[i].start(std::vector<size_t>(1, element_size), comp_size);
+                shuffles[i].add(0, comp_offsets[comp_indices[i]], 0, comp_size);
+                shuffles[i].finish();
             }
-            // Write the GTA data to temporary files
-            if (hdri.data_size() > 0)
+            const uintmax_t block_elements = (element_size == 0 ? 1
+                    : std::max(static_cast<uintmax_t>(1), static_cast<uintmax_t>(block_size / element_size)));
+            blob column;
+            if (hdri.data_size() == 0)
             {
-                element_loop_t element_loop;
-                array_loop.start_element_loop(element_loop, hdri, hdro);
-                for (uintmax_t e = 0; e < hdri.elements(); e++)
+                for (size_t i = 0; i < hdros.size(); i++)
+                {
+                    array_loop.write(hdros[i], nameos[i]);
+                }
+                array_loop.skip_data(hdri);
+            }
+            else if (fio::seekable(array_loop.file_in()) && hdri.compression() == gta::none)
+            {
+                // Make one pass over the input data per output array
+                uintmax_t data_offset = fio::tell(array_loop.file_in(), array_loop.filename_in());
+                for (size_t i = 0; i < hdros.size(); i++)
                 {
-                    const void *element = element_loop.read();
-                    if (hdros.size() > 0)
+                    array_loop.write(hdros[i], nameos[i]);
+                    const size_t comp_size = checked_cast<size_t>(hdros[i].element_size());
+                    column.resize(checked_cast<size_t>(block_elements), comp_size);
+                    fio::seek(array_loop.file_in(), data_offset, SEEK_SET, array_loop.filename_in());
+                    element_loop_t element_loop;
+                    array_loop.start_element_loop(element_loop, hdri, hdros[i]);
+                    for (uintmax_t e = 0; e < hdri.elements(); e += block_elements)
                     {
-                        size_t out_index = 0;
-                        size_t out_comp_offset = 0;
-                        for (uintmax_t i = 0; i < hdri.components(); i++)
-                        {
-                            if (out_index < comp_indices.size() && i == comp_indices[out_index])
-                            {
-                                tmpeloops[out_index].write(static_cast<const char *>(element) + out_comp_offset);
-                                out_index++;
-                            }
-                            out_comp_offset += hdri.component_size(i);
-                        }
+                        size_t n = checked_cast<size_t>(std::min(block_elements, hdri.elements() - e));
+                        const void *elements = element_loop.read(n);
+                        shuffles[i].run(n, &elements, column.ptr());
+                        element_loop.write(column.ptr(), n);
                     }
                 }
+                fio::seek(array_loop.file_in(), data_offset, SEEK_SET, array_loop.filename_in());
+                array_loop.skip_data(hdri);
             }
-            // Combine the GTA data to a single output stream
-            for (size_t i = 0; i < hdros.size(); i++)
+            else
             {
-                tmpaloops[i].finish();
-                array_loop_t tmploop;
-                tmploop.start(tmpfilenames[i], "");
-                tmploop.write(hdros[i], nameos[i]);
-                tmploop.copy_data(hdros[i], hdros[i]);
-                tmploop.finish();
-                fio::close(tmpfiles[i], tmpfilenames[i]);
-                fio::remove(tmpfilenames[i]);
+                // The input cannot be read more than once. Write the components
+                // to temporary files, and combine these afterwards.
+                std::vector<FILE *> tmpfiles(hdros.size());
+                std::vector<std::string> tmpfilenames(hdros.size());
+                std::vector<array_loop_t> tmpaloops(hdros.size());
+                std::vector<element_loop_t> tmpeloops(hdros.size());
+                for (size_t i = 0; i < hdros.size(); i++)
+                {
+                    tmpfilenames[i] = fio::mktempfile(&(tmpfiles[i]));
+                    tmpaloops[i].start("", tmpfilenames[i]);
+                    tmpaloops[i].start_element_loop(tmpeloops[i], hdri, hdros[i]);
+                }
+                element_loop_t element_loop;
+                array_loop.start_element_loop(element_loop, hdri, hdro);
+                for (uintmax_t e = 0; e < hdri.elements(); e += block_elements)
+                {
+                    size_t n = checked_cast<size_t>(std::min(block_elements, hdri.elements() - e));
+                    const void *elements = element_loop.read(n);
+                    for (size_t i = 0; i < hdros.size(); i++)
+                    {
+                        const size_t comp_size = checked_cast<size_t>(hdros[i].element_size());
+                        column.resize(n, comp_size);
+                        shuffles[i].run(n, &elements, column.ptr());
+                        tmpeloops[i].write(column.ptr(), n);
+                    }
+                }
+                for (size_t i = 0; i < hdros.size(); i++)
+                {
+                    tmpaloops[i].finish();
+                    array_loop_t tmploop;
+                    tmploop.start(tmpfilenames[i], "");
+                    tmploop.write(hdros[i], nameos[i]);
+                    tmploop.copy_data(hdros[i], hdros[i]);
+                    tmploop.finish();
+                    fio::close(tmpfiles[i], tmpfilenames[i]);
+                    fio::remove(tmpfilenames[i]);
+                }
             }
         }
         array_loop.finish();
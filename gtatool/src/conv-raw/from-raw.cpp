@@ -22,6 +22,10 @@
 #include "config.h"
 
 #include <string>
+#include <algorithm>
+
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <gta/gta.hpp>
 
@@ -102,6 +106,8 @@ extern "C" int gtatool_from_raw(int argc, char *argv[])
 
     try
     {
+        /* Elements with swapped endianness are processed in blocks of this size */
+        const uintmax_t block_size = 1 << 20;
         gta::header hdr;
         hdr.set_dimensions(dimensions.value().size(), &(dimensions.value()[0]));
         std::vector<gta::type> comp_types;
@@ -113,6 +119,32 @@ extern "C" int gtatool_from_raw(int argc, char *argv[])
         array_loop.start(std::vector<std::string>(1, arguments[0]), arguments.size() == 2 ? arguments[1] : "");
         std::string nameo;
 
+        /* If the endianness differs from the host, elements are swapped in
+         * blocks. If the input is a regular file, the blocks are read from
+         * memory mappings of the file instead of being read with stdio. */
+        endianness_swap_t swap;
+        size_t block_elements = 0;
+        blob block;
+        bool mappable = false;
+        off_t input_size = 0;
+        off_t page_size = 4096;
+        if (!host_endianness && hdr.data_size() > 0)
+        {
+            swap.start(hdr);
+            block_elements = std::max(static_cast<uintmax_t>(1), block_size / hdr.element_size());
+            block.resize(checked_cast<size_t>(std::min(static_cast<uintmax_t>(block_elements), hdr.elements())),
+                    checked_cast<size_t>(hdr.element_size()));
+#if HAVE_MMAP && HAVE_SYSCONF
+            struct stat st;
+            if (fstat(fileno(array_loop.file_in()), &st) == 0 && S_ISREG(st.st_mode))
+            {
+                mappable = true;
+                input_size = st.st_size;
+                page_size = sysconf(_SC_PAGESIZE);
+            }
+#endif
+        }
+
         if (stream_skip.value() > 0)
         {
             fio::seek(array_loop.file_in(), stream_skip.value(), SEEK_CUR, array_loop.filename_in());
@@ -129,16 +161,44 @@ extern "C" int gtatool_from_raw(int argc, char *argv[])
             {
                 array_loop.copy_data(hdr, hdr);
             }
+            else if (mappable && input_size - fio::tell(array_loop.file_in(), array_loop.filename_in())
+                    >= static_cast<off_t>(hdr.data_size()))
+            {
+                /* Swap directly from mapped windows of the input file into
+                 * the output block, then seek past the array data. Reading
+                 * happens while swapping, so that time counts as i/o time. */
+                element_loop_t element_loop;
+                array_loop.start_element_loop(element_loop, hdr, hdr);
+                stats_t &stats = stats_t::current();
+                off_t data_offset = fio::tell(array_loop.file_in(), array_loop.filename_in());
+                for (uintmax_t e = 0; e < hdr.elements(); e += block_elements)
+                {
+                    size_t n = std::min(static_cast<uintmax_t>(block_elements), hdr.elements() - e);
+                    off_t offset = data_offset + e * hdr.element_size();
+                    off_t map_offset = offset / page_size * page_size;
+                    size_t map_length = offset - map_offset + n * hdr.element_size();
+                    double t = stats_t::now();
+                    void *map = fio::map(array_loop.file_in(), map_offset, map_length, array_loop.filename_in());
+                    swap.run(static_cast<const unsigned char *>(map) + (offset - map_offset), block.ptr(), n);
+                    fio::unmap(map, map_length, array_loop.filename_in());
+                    if (stats.enabled)
+                    {
+                        stats.io_time += stats_t::now() - t;
+                        stats.data_bytes_in += n * hdr.element_size();
+                    }
+                    element_loop.write(block.ptr(), n);
+                }
+                fio::seek(array_loop.file_in(), data_offset + hdr.data_size(), SEEK_SET, array_loop.filename_in());
+            }
             else
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdr, hdr);
-                blob element(checked_cast<size_t>(hdr.element_size()));
-                for (uintmax_t e = 0; e < hdr.elements(); e++)
+                for (uintmax_t e = 0; e < hdr.elements(); e += block_elements)
                 {
-                    std::memcpy(element.ptr(), element_loop.read(1), hdr.element_size());
-                    swap_element_endianness(hdr, element.ptr());
-                    element_loop.write(element.ptr());
+                    size_t n = std::min(static_cast<uintmax_t>(block_elements), hdr.elements() - e);
+                    swap.run(element_loop.read(n), block.ptr(), n);
+                    element_loop.write(block.ptr(), n);
                 }
             }
             if (array_post_skip.value() > 0)
@@ -23,6 +23,7 @@
 
 #include <string>
 #include <limits>
+#include <algorithm>
 
 #include <gta/gta.hpp>
 
@@ -77,6 +78,8 @@ extern "C" int gtatool_to_raw(int argc, char *argv[])
 
     try
     {
+        /* Elements with swapped endianness are processed in blocks of this size */
+        const uintmax_t block_size = 1 << 20;
         std::string namei;
         std::string nameo = arguments.size() == 1 ? arguments[0] : arguments[1];
         gta::header hdri;
@@ -92,16 +95,20 @@ extern "C" int gtatool_to_raw(int argc, char *argv[])
             {
                 array_loop.copy_data(hdri, hdro);
             }
-            else
+            else if (hdri.data_size() > 0)
             {
+                endianness_swap_t swap;
+                swap.start(hdri);
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                blob element(checked_cast<size_t>(hdri.element_size()));
-                for (uintmax_t e = 0; e < hdri.elements(); e++)
+                size_t block_elements = std::max(static_cast<uintmax_t>(1), block_size / hdri.element_size());
+                blob block(checked_cast<size_t>(std::min(static_cast<uintmax_t>(block_elements), hdri.elements())),
+                        checked_cast<size_t>(hdri.element_size()));
+                for (uintmax_t e = 0; e < hdri.elements(); e += block_elements)
                 {
-                    std::memcpy(element.ptr(), element_loop.read(1), hdri.element_size());
-                    swap_element_endianness(hdri, element.ptr());
-                    element_loop.write(element.ptr());
+                    size_t n = std::min(static_cast<uintmax_t>(block_elements), hdri.elements() - e);
+                    swap.run(element_loop.read(n), block.ptr(), n);
+                    element_loop.write(block.ptr(), n);
                 }
             }
         }
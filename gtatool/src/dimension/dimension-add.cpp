@@ -119,12 +119,8 @@ extern "C" int gtatool_dimension_add(int argc, char *argv[])
                 }
                 else
                 {
-                    element_loop_t element_loop;
-                    array_loop.start_element_loop(element_loop, hdri, hdro);
-                    for (uintmax_t i = 0; i < hdri.elements(); i++)
-                    {
-                        element_loop.write(element_loop.read());
-                    }
+                    // The data bytes are unchanged; copy them in bulk.
+                    array_loop.copy_data(hdri, hdri);
                 }
             }
         }
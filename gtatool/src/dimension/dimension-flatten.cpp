@@ -107,27 +107,28 @@ extern "C" int gtatool_dimension_flatten(int argc, char *argv[])
             array_loop.write(hdro, nameo);
             if (hdro.data_size() > 0)
             {
-                if (hdri.element_size() > 0)
+                if (!prepend_coordinates.value())
+                {
+                    // Only the header changes; the data bytes stay the same.
+                    // Copy them in bulk. The input header serves as the
+                    // output header since copy_data() requires identical
+                    // dimensions.
+                    array_loop.copy_data(hdri, hdri);
+                }
+                else if (hdri.element_size() > 0)
                 {
                     element_loop_t element_loop;
                     array_loop.start_element_loop(element_loop, hdri, hdro);
                     for (uintmax_t e = 0; e < hdro.elements(); e++)
                     {
-                        if (prepend_coordinates.value())
-                        {
-                            hdri.linear_index_to_indices(e, &(index[0]));
-                            for (size_t i = 0; i < index.size(); i++)
-                            {
-                                eo.ptr<uint64_t>()[i] = checked_cast<uint64_t>(index[i]);
-                            }
-                            std::memcpy(eo.ptr(hdro.element_size() - hdri.element_size()),
-                                    element_loop.read(), hdri.element_size());
-                            element_loop.write(eo.ptr());
-                        }
-                        else
+                        hdri.linear_index_to_indices(e, &(index[0]));
+                        for (size_t i = 0; i < index.size(); i++)
                         {
-                            element_loop.write(element_loop.read());
+                            eo.ptr<uint64_t>()[i] = checked_cast<uint64_t>(index[i]);
                         }
+                        std::memcpy(eo.ptr(hdro.element_size() - hdri.element_size()),
+                                element_loop.read(), hdri.element_size());
+                        element_loop.write(eo.ptr());
                     }
                 }
                 else
@@ -148,16 +148,11 @@ extern "C" int gtatool_dimension_merge(int argc, char *argv[])
                 hdro.component_taglist(c) = hdris[0].component_taglist(c);
             }
             array_loops[0].write(hdro, nameo);
-            element_loop_t element_loop;
-            array_loops[0].start_element_loop(element_loop, hdris[0], hdro);
+            // The new dimension is the slowest varying one, so the output
+            // data is the concatenation of the input data. Copy it in bulk.
             for (size_t i = 0; i < arguments.size(); i++)
             {
-                element_loop_t element_loop_2;
-                array_loops[i].start_element_loop(element_loop_2, hdris[i], hdro);
-                for (uintmax_t j = 0; j < hdris[i].elements(); j++)
-                {
-                    element_loop.write(element_loop_2.read());
-                }
+                array_loops[i].copy_data(hdris[i], array_loops[0], hdris[i]);
             }
         }
         for (size_t i = 0; i < arguments.size(); i++)
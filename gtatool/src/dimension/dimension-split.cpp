@@ -24,6 +24,8 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <cstring>
+#include <algorithm>
 
 #include <gta/gta.hpp>
 
@@ -52,6 +54,217 @@ extern "C" void gtatool_dimension_split_help(void)
             "Example: dimension-split volume.gta > slices.gta");
 }
 
+/* Sizes used for the block-wise data transfer below. */
+static const size_t chunk_size = 16 * 1024 * 1024;
+static const size_t min_run_size = 64 * 1024;
+static const uintmax_t max_memory_size = 256 * 1024 * 1024;
+
+/* The input data is viewed as a 3D array of size inner x dim_size x outer,
+ * where inner is the product of the sizes of all dimensions below the split
+ * dimension, and outer is the product of the sizes of all dimensions above
+ * it. Output array j consists of the runs (*, j, o) for o = 0, ..., outer-1,
+ * each of which is contiguous in the input. */
+
+static void split(array_loop_t &array_loop, const gta::header &hdri, const gta::header &hdro, uintmax_t dim)
+{
+    const size_t element_size = checked_cast<size_t>(hdri.element_size());
+    const uintmax_t dim_size = hdri.dimension_size(dim);
+    uintmax_t inner = 1;
+    for (uintmax_t i = 0; i < dim; i++)
+    {
+        inner = checked_mul(inner, hdri.dimension_size(i));
+    }
+    const uintmax_t outer = hdri.elements() / dim_size / inner;
+    const size_t run_size = checked_cast<size_t>(checked_mul(inner, hdri.element_size()));
+    const size_t chunk_elements = std::max(chunk_size / element_size, static_cast<size_t>(1));
+    std::string nameo;
+
+    if (outer == 1)
+    {
+        // The output arrays are stored one after another in the input. Stream them.
+        element_loop_t element_loop_in;
+        array_loop.start_element_loop(element_loop_in, hdri, hdro);
+        for (uintmax_t j = 0; j < dim_size; j++)
+        {
+            array_loop.write(hdro, nameo);
+            element_loop_t element_loop_out;
+            array_loop.start_element_loop(element_loop_out, hdri, hdro);
+            for (uintmax_t e = 0; e < inner; e += chunk_elements)
+            {
+                size_t n = std::min(inner - e, static_cast<uintmax_t>(chunk_elements));
+                element_loop_out.write(element_loop_in.read(n), n);
+            }
+        }
+    }
+    else if (fio::seekable(array_loop.file_in()) && hdri.compression() == gta::none && run_size >= min_run_size)
+    {
+        // The runs are large enough to read them directly from the input.
+        // The 2D view of the data makes read_block() read one run per row.
+        gta::header view = hdri;
+        view.set_dimensions(checked_mul(inner, dim_size), outer);
+        uintmax_t data_offset = fio::tell(array_loop.file_in(), array_loop.filename_in());
+        blob buf;
+        uintmax_t lower[2], higher[2];
+        for (uintmax_t j = 0; j < dim_size; j++)
+        {
+            array_loop.write(hdro, nameo);
+            element_loop_t element_loop_out;
+            array_loop.start_element_loop(element_loop_out, hdri, hdro);
+            if (run_size <= chunk_size)
+            {
+                uintmax_t rows = chunk_size / run_size;
+                buf.resize(checked_cast<size_t>(rows), run_size);
+                for (uintmax_t o = 0; o < outer; o += rows)
+                {
+                    uintmax_t n = std::min(outer - o, rows);
+                    lower[0] = j * inner;
+                    lower[1] = o;
+                    higher[0] = lower[0] + inner - 1;
+                    higher[1] = o + n - 1;
+                    view.read_block(array_loop.file_in(), data_offset, lower, higher, buf.ptr());
+                    element_loop_out.write(buf.ptr(), checked_cast<size_t>(n * inner));
+                }
+            }
+            else
+            {
+                buf.resize(chunk_elements, element_size);
+                for (uintmax_t o = 0; o < outer; o++)
+                {
+                    for (uintmax_t e = 0; e < inner; e += chunk_elements)
+                    {
+                        uintmax_t n = std::min(inner - e, static_cast<uintmax_t>(chunk_elements));
+                        lower[0] = j * inner + e;
+                        lower[1] = o;
+                        higher[0] = lower[0] + n - 1;
+                        higher[1] = o;
+                        view.read_block(array_loop.file_in(), data_offset, lower, higher, buf.ptr());
+                        element_loop_out.write(buf.ptr(), checked_cast<size_t>(n));
+                    }
+                }
+            }
+        }
+        fio::seek(array_loop.file_in(), data_offset, SEEK_SET, array_loop.filename_in());
+        array_loop.skip_data(hdri);
+    }
+    else
+    {
+        // Read the input sequentially and scatter the runs to their place in
+        // the output, either in memory or in a temporary file. Runs that end
+        // up next to each other in the output are gathered before writing.
+        const size_t slice_size = checked_cast<size_t>(hdro.data_size());
+        const bool in_memory = (hdri.data_size() <= max_memory_size);
+        blob mem;
+        FILE *tmpf = NULL;
+        if (in_memory)
+        {
+            mem.resize(checked_cast<size_t>(hdri.data_size()));
+        }
+        else
+        {
+            tmpf = fio::tempfile();
+        }
+        try
+        {
+            element_loop_t element_loop_in;
+            array_loop.start_element_loop(element_loop_in, hdri, hdro);
+            // With a temporary file, each write should be as large as
+            // possible: gather as many whole rows as fit into a tile of the
+            // in-memory size limit, so that each output array receives one
+            // contiguous segment per tile. Larger rows are read in segments
+            // of whole runs.
+            const uintmax_t row_elements = checked_mul(inner, dim_size);
+            const size_t tile_elements = (in_memory ? chunk_elements
+                    : std::max(checked_cast<size_t>(max_memory_size / element_size), static_cast<size_t>(1)));
+            if (row_elements <= tile_elements)
+            {
+                uintmax_t rows = tile_elements / row_elements;
+                blob gathered(in_memory ? 0 : checked_cast<size_t>(rows), run_size);
+                for (uintmax_t o = 0; o < outer; o += rows)
+                {
+                    size_t n = checked_cast<size_t>(std::min(outer - o, rows));
+                    const char *data = static_cast<const char *>(element_loop_in.read(checked_cast<size_t>(n * row_elements)));
+                    for (uintmax_t j = 0; j < dim_size; j++)
+                    {
+                        size_t dst_offset = j * slice_size + o * run_size;
+                        char *dst = (in_memory ? mem.ptr<char>(dst_offset) : gathered.ptr<char>());
+                        for (size_t r = 0; r < n; r++)
+                        {
+                            std::memcpy(dst + r * run_size, data + (r * dim_size + j) * run_size, run_size);
+                        }
+                        if (!in_memory)
+                        {
+                            fio::seek(tmpf, dst_offset, SEEK_SET);
+                            fio::write(dst, run_size, n, tmpf);
+                        }
+                    }
+                }
+            }
+            else
+            {
+                uintmax_t read_elements = tile_elements;
+                if (!in_memory && inner <= tile_elements)
+                {
+                    read_elements = tile_elements / inner * inner;
+                }
+                for (uintmax_t o = 0; o < outer; o++)
+                {
+                    for (uintmax_t e = 0; e < row_elements; )
+                    {
+                        size_t n = checked_cast<size_t>(std::min(row_elements - e, read_elements));
+                        const char *data = static_cast<const char *>(element_loop_in.read(n));
+                        for (size_t i = 0; i < n; )
+                        {
+                            uintmax_t j = (e + i) / inner;
+                            uintmax_t k = (e + i) % inner;
+                            size_t l = checked_cast<size_t>(std::min(inner - k, static_cast<uintmax_t>(n - i)));
+                            size_t dst_offset = j * slice_size + (o * inner + k) * element_size;
+                            if (in_memory)
+                            {
+                                std::memcpy(mem.ptr<char>(dst_offset), data + i * element_size, l * element_size);
+                            }
+                            else
+                            {
+                                fio::seek(tmpf, dst_offset, SEEK_SET);
+                                fio::write(data + i * element_size, element_size, l, tmpf);
+                            }
+                            i += l;
+                        }
+                        e += n;
+                    }
+                }
+            }
+            if (!in_memory)
+            {
+                fio::rewind(tmpf);
+            }
+            for (uintmax_t j = 0; j < dim_size; j++)
+            {
+                array_loop.write(hdro, nameo);
+                if (in_memory)
+                {
+                    array_loop.write_data(hdro, mem.ptr(j * slice_size));
+                }
+                else
+                {
+                    hdro.copy_data(tmpf, hdro, array_loop.file_out());
+                }
+            }
+        }
+        catch (...)
+        {
+            if (tmpf)
+            {
+                std::fclose(tmpf);
+            }
+            throw;
+        }
+        if (tmpf)
+        {
+            fio::close(tmpf);
+        }
+    }
+}
+
 extern "C" int gtatool_dimension_split(int argc, char *argv[])
 {
     std::vector<opt::option *> options;
@@ -70,7 +283,6 @@ extern "C" int gtatool_dimension_split(int argc, char *argv[])
         return 0;
     }
 
-    std::string tempdir;
     try
     {
         array_loop_t array_loop;
@@ -124,54 +336,13 @@ extern "C" int gtatool_dimension_split(int argc, char *argv[])
                     }
                 }
             }
-            if (hdri.element_size() > 0)
-            {
-                // Write the GTA data to temporary files "tempdir/index"
-                tempdir = fio::mktempdir();
-                FILE* tmpf = NULL;
-                std::string tmpf_name;
-                uintmax_t tmpf_index = 0;
-                element_loop_t element_loop;
-                array_loop.start_element_loop(element_loop, hdri, hdro);
-                blob element(checked_cast<size_t>(hdri.element_size()));
-                std::vector<uintmax_t> indices(hdri.dimensions());
-                for (uintmax_t i = 0; i < hdri.elements(); i++)
-                {
-                    const void *e = element_loop.read();
-                    hdri.linear_index_to_indices(i, &(indices[0]));
-                    uintmax_t j = indices[dim];
-                    if (!tmpf || tmpf_index != j)
-                    {
-                        if (tmpf)
-                        {
-                            fio::close(tmpf, tmpf_name);
-                        }
-                        tmpf_name = tempdir + "/" + str::from(j);
-                        tmpf = fio::open(tmpf_name, "a");
-                        tmpf_index = j;
-                    }
-                    fio::write(e, element.size(), 1, tmpf, tmpf_name);
-                }
-                if (tmpf)
-                {
-                    fio::close(tmpf, tmpf_name);
-                }
-                // Combine the GTAs to a single output stream
-                for (uintmax_t i = 0; i < dim_size; i++)
-                {
-                    std::string nameo;
-                    array_loop_t tmploop;
-                    tmpf_name = tempdir + "/" + str::from(i);
-                    tmploop.start(tmpf_name, "");
-                    tmploop.write(hdro, nameo);
-                    tmploop.copy_data(hdro, hdro);
-                    tmploop.finish();
-                    fio::remove(tmpf_name);
-                }
-                fio::rmdir(tempdir);
+            if (hdri.element_size() > 0 && hdri.elements() > 0)
+            {
+                split(array_loop, hdri, hdro, dim);
             }
             else
             {
+                array_loop.skip_data(hdri);
                 for (uintmax_t i = 0; i < dim_size; i++)
                 {
                     array_loop.write(hdro, nameo);
@@ -183,10 +354,6 @@ extern "C" int gtatool_dimension_split(int argc, char *argv[])
     catch (std::exception &e)
     {
         msg::err_txt("%s", e.what());
-        if (tempdir.length() > 0 && fio::test_d(tempdir))
-        {
-            fio::rm_r(tempdir);
-        }
         return 1;
     }
 
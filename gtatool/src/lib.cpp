@@ -22,9 +22,22 @@
 #include "config.h"
 
 #include <limits>
+#include <cmath>
 #include <sstream>
 #include <cstring>
 #include <cstddef>
+#include <algorithm>
+#include <thread>
+#include <exception>
+#include <chrono>
+#include <cerrno>
+#ifdef HAVE_SYS_RESOURCE_H
+#   include <sys/resource.h>
+#endif
+#include <sys/stat.h>
+#ifdef HAVE_SPLICE
+#   include <fcntl.h>
+#endif
 
 #include "base/str.h"
 #include "base/fio.h"
@@ -40,6 +53,488 @@ int* gtatool_argc = NULL;
 char** gtatool_argv = NULL;
 FILE *gtatool_stdin = NULL;
 FILE *gtatool_stdout = NULL;
+bool gtatool_splice = false;
+stats_t gtatool_stats;
+
+
+stats_t::stats_t() :
+    enabled(false), json(false), start_time(0.0),
+    arrays_in(0), arrays_out(0),
+    header_bytes_in(0), header_bytes_out(0),
+    data_bytes_in(0), data_bytes_out(0),
+    data_bytes_skipped(0),
+    read_calls(0), write_calls(0), seek_calls(0),
+    io_time(0.0), header_time(0.0)
+{
+}
+
+void stats_t::start(bool json)
+{
+    *this = stats_t();
+    this->enabled = true;
+    this->json = json;
+    this->start_time = now();
+}
+
+void stats_t::add(const stats_t &s)
+{
+    arrays_in += s.arrays_in;
+    arrays_out += s.arrays_out;
+    header_bytes_in += s.header_bytes_in;
+    header_bytes_out += s.header_bytes_out;
+    data_bytes_in += s.data_bytes_in;
+    data_bytes_out += s.data_bytes_out;
+    data_bytes_skipped += s.data_bytes_skipped;
+    read_calls += s.read_calls;
+    write_calls += s.write_calls;
+    seek_calls += s.seek_calls;
+    io_time += s.io_time;
+    header_time += s.header_time;
+}
+
+static thread_local stats_t *current_stats = &gtatool_stats;
+
+stats_t &stats_t::current()
+{
+    return *current_stats;
+}
+
+stats_redirect_t::stats_redirect_t(stats_t &stats) : _previous(current_stats)
+{
+    current_stats = &stats;
+}
+
+stats_redirect_t::~stats_redirect_t()
+{
+    current_stats = _previous;
+}
+
+double stats_t::now()
+{
+    return std::chrono::duration<double>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Read the system call counters of this process from /proc/self/io, if
+ * available. */
+static bool read_proc_io(uintmax_t *syscr, uintmax_t *syscw)
+{
+    FILE *f = std::fopen("/proc/self/io", "r");
+    if (!f)
+    {
+        return false;
+    }
+    bool have_r = false, have_w = false;
+    char line[128];
+    while (std::fgets(line, sizeof(line), f))
+    {
+        unsigned long long v;
+        if (std::sscanf(line, "syscr: %llu", &v) == 1)
+        {
+            *syscr = v;
+            have_r = true;
+        }
+        else if (std::sscanf(line, "syscw: %llu", &v) == 1)
+        {
+            *syscw = v;
+            have_w = true;
+        }
+    }
+    std::fclose(f);
+    return have_r && have_w;
+}
+
+void stats_t::print() const
+{
+    /* Flush pending output first so that its system calls are counted */
+    if (gtatool_stdout)
+    {
+        std::fflush(gtatool_stdout);
+    }
+    double wall = now() - start_time;
+    double compute = wall - io_time - header_time;
+    if (compute < 0.0)
+    {
+        compute = 0.0;
+    }
+    uintmax_t bytes_in = header_bytes_in + data_bytes_in;
+    uintmax_t bytes_out = header_bytes_out + data_bytes_out;
+    double mbs_in = (wall > 0.0 ? bytes_in / wall / 1e6 : 0.0);
+    double mbs_out = (wall > 0.0 ? bytes_out / wall / 1e6 : 0.0);
+    uintmax_t syscr = 0, syscw = 0;
+    bool have_syscalls = read_proc_io(&syscr, &syscw);
+    double user = -1.0, sys = -1.0;
+#ifdef HAVE_SYS_RESOURCE_H
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0)
+    {
+        user = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6;
+        sys = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+    }
+#endif
+
+    if (json)
+    {
+        std::string s = "{ ";
+        s += "\"arrays_in\": " + str::from(arrays_in) + ", ";
+        s += "\"arrays_out\": " + str::from(arrays_out) + ", ";
+        s += "\"header_bytes_in\": " + str::from(header_bytes_in) + ", ";
+        s += "\"header_bytes_out\": " + str::from(header_bytes_out) + ", ";
+        s += "\"data_bytes_in\": " + str::from(data_bytes_in) + ", ";
+        s += "\"data_bytes_out\": " + str::from(data_bytes_out) + ", ";
+        s += "\"data_bytes_skipped\": " + str::from(data_bytes_skipped) + ", ";
+        s += "\"read_calls\": " + str::from(read_calls) + ", ";
+        s += "\"write_calls\": " + str::from(write_calls) + ", ";
+        s += "\"seek_calls\": " + str::from(seek_calls) + ", ";
+        if (have_syscalls)
+        {
+            s += "\"read_syscalls\": " + str::from(syscr) + ", ";
+            s += "\"write_syscalls\": " + str::from(syscw) + ", ";
+        }
+        s += "\"wall_time\": " + str::asprintf("%.6f", wall) + ", ";
+        s += "\"io_time\": " + str::asprintf("%.6f", io_time) + ", ";
+        s += "\"header_time\": " + str::asprintf("%.6f", header_time) + ", ";
+        s += "\"compute_time\": " + str::asprintf("%.6f", compute) + ", ";
+        if (user >= 0.0)
+        {
+            s += "\"user_time\": " + str::asprintf("%.6f", user) + ", ";
+            s += "\"system_time\": " + str::asprintf("%.6f", sys) + ", ";
+        }
+        s += "\"mb_per_s_in\": " + str::asprintf("%.1f", mbs_in) + ", ";
+        s += "\"mb_per_s_out\": " + str::asprintf("%.1f", mbs_out) + " }\n";
+        std::fputs(s.c_str(), stderr);
+    }
+    else
+    {
+        msg::req(std::string("stats: arrays: ") + str::from(arrays_in) + " read, "
+                + str::from(arrays_out) + " written");
+        msg::req(std::string("stats: input: ") + str::from(bytes_in) + " bytes ("
+                + str::from(header_bytes_in) + " header, " + str::from(data_bytes_in) + " data), "
+                + str::from(data_bytes_skipped) + " data bytes skipped");
+        msg::req(std::string("stats: output: ") + str::from(bytes_out) + " bytes ("
+                + str::from(header_bytes_out) + " header, " + str::from(data_bytes_out) + " data)");
+        msg::req(std::string("stats: calls: ") + str::from(read_calls) + " read, "
+                + str::from(write_calls) + " write, " + str::from(seek_calls) + " seek"
+                + (have_syscalls ? std::string("; system calls: ") + str::from(syscr) + " read, "
+                    + str::from(syscw) + " write" : std::string("")));
+        msg::req("stats: time: %.3f s wall = %.3f s i/o + %.3f s header + %.3f s compute",
+                wall, io_time, header_time, compute);
+        if (user >= 0.0)
+        {
+            msg::req("stats: cpu: %.3f s user, %.3f s system", user, sys);
+        }
+        msg::req("stats: throughput: %.1f MB/s in, %.1f MB/s out", mbs_in, mbs_out);
+    }
+}
+
+progress_t gtatool_progress;
+
+std::atomic<bool> progress_t::_due(false);
+
+progress_t::progress_t() :
+    _owner(NULL), _interval(1.0), _start_time(0.0), _reported(false),
+    _output_side(false), _file_offsets(), _stream(NULL), _file(NULL), _file_index(0), _array_offset(0),
+    _arrays(0), _array_elements(0), _array_data_size(0), _array_compressed(false),
+    _elements(0), _data_bytes(0),
+    enabled(false)
+{
+}
+
+void progress_t::tick(double interval)
+{
+    for (;;)
+    {
+        std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+        _due.store(true, std::memory_order_relaxed);
+    }
+}
+
+void progress_t::start(double interval)
+{
+    *this = progress_t();
+    enabled = true;
+    _interval = interval;
+    _start_time = stats_t::now();
+    if (_interval > 0.0)
+    {
+        /* The thread runs until the process exits */
+        std::thread(tick, _interval).detach();
+    }
+    else
+    {
+        _due.store(true);
+    }
+}
+
+void progress_t::array_started(const void *owner, const std::vector<std::string> &filenames,
+        size_t file_index, FILE *f, const gta::header &header)
+{
+    if (!enabled)
+    {
+        return;
+    }
+    if (!_owner)
+    {
+        /* Determine the input size if the input consists of regular files */
+        _owner = owner;
+        bool regular = true;
+        uintmax_t offset = 0;
+        for (size_t i = 0; regular && i < std::max(filenames.size(), static_cast<size_t>(1)); i++)
+        {
+            struct stat st;
+            if (filenames.size() == 0 ? fstat(fileno(gtatool_stdin), &st) != 0
+                    : !fio::stat(filenames[i], &st))
+            {
+                regular = false;
+            }
+            else if (!S_ISREG(st.st_mode))
+            {
+                regular = false;
+            }
+            else
+            {
+                _file_offsets.push_back(offset);
+                offset += st.st_size;
+            }
+        }
+        _file_offsets.push_back(offset);
+        if (!regular)
+        {
+            _file_offsets.clear();
+        }
+    }
+    if (owner != _owner || _output_side)
+    {
+        return;
+    }
+    array(header, f);
+    if (_file_offsets.size() > 0 && file_index + 1 < _file_offsets.size())
+    {
+        _array_offset = ftello(f);
+        if (_array_offset >= 0)
+        {
+            _file = f;
+            _file_index = file_index;
+        }
+    }
+    check();
+}
+
+void progress_t::array_written(const void *owner, FILE *f, const gta::header &header)
+{
+    if (!enabled)
+    {
+        return;
+    }
+    if (!_owner)
+    {
+        _owner = owner;
+        _output_side = true;
+    }
+    if (owner != _owner || !_output_side)
+    {
+        return;
+    }
+    array(header, f);
+    check();
+}
+
+/* Start tracking a new array that is read from or written to f */
+void progress_t::array(const gta::header &header, FILE *f)
+{
+    _data_bytes += _array_data_size;
+    _arrays++;
+    _array_elements = header.elements();
+    _array_data_size = header.data_size();
+    _array_compressed = (header.compression() != gta::none);
+    _elements = 0;
+    _stream = f;
+    _file = NULL;
+}
+
+void progress_t::check()
+{
+    if (enabled && _due.load(std::memory_order_relaxed))
+    {
+        if (_interval > 0.0)
+        {
+            _due.store(false, std::memory_order_relaxed);
+        }
+        report(false);
+    }
+}
+
+void progress_t::finish()
+{
+    if (enabled && _reported)
+    {
+        report(true);
+    }
+}
+
+void progress_t::report(bool final)
+{
+    double now = stats_t::now();
+    double elapsed = now - _start_time;
+    _reported = true;
+
+    /* Progress within the current array */
+    double array_fraction = -1.0;
+    off_t pos = -1;
+    if (!final && _file)
+    {
+        pos = ftello(_file);
+    }
+    if (final)
+    {
+        array_fraction = 1.0;
+    }
+    else if (_array_elements > 0 && (_elements > 0 || _output_side))
+    {
+        array_fraction = std::min(1.0, static_cast<double>(_elements) / _array_elements);
+    }
+    else if (pos >= 0 && _array_data_size > 0)
+    {
+        array_fraction = std::max(0.0, std::min(1.0,
+                    static_cast<double>(pos - _array_offset) / _array_data_size));
+    }
+    uintmax_t arrays_done = (_arrays > 0 && array_fraction < 1.0 ? _arrays - 1 : _arrays);
+
+    /* Progress of the whole input */
+    double done_bytes = _data_bytes + std::max(array_fraction, 0.0) * _array_data_size;
+    double total_bytes = -1.0;
+    if (_file_offsets.size() > 0)
+    {
+        total_bytes = _file_offsets.back();
+        if (final)
+        {
+            done_bytes = total_bytes;
+        }
+        else if (_file && _elements > 0 && !_array_compressed)
+        {
+            /* Count the data consumed by the element loops, not the file
+             * position, which may be ahead because of buffering */
+            done_bytes = _file_offsets[_file_index] + _array_offset + array_fraction * _array_data_size;
+        }
+        else if (pos >= 0)
+        {
+            done_bytes = _file_offsets[_file_index] + pos;
+        }
+    }
+    double mb_per_s = (elapsed > 0.0 ? done_bytes / elapsed / 1e6 : 0.0);
+
+    std::string s = "progress: arrays=" + str::from(arrays_done);
+    if (array_fraction >= 0.0)
+    {
+        s += str::asprintf(" array=%.1f%%", 100.0 * array_fraction);
+    }
+    if (total_bytes > 0.0)
+    {
+        s += str::asprintf(" done=%.1f%%", 100.0 * std::min(1.0, done_bytes / total_bytes));
+    }
+    s += str::asprintf(" mb_per_s=%.1f", mb_per_s);
+    if (total_bytes > 0.0 && done_bytes > 0.0)
+    {
+        s += str::asprintf(" eta=%.0f", std::max(0.0, elapsed * (total_bytes - done_bytes) / done_bytes));
+    }
+    msg::req(s);
+}
+
+/* A gta::custom_io for a FILE that counts and times the calls and adds the
+ * number of bytes transferred to the given counter. If skipped is not NULL,
+ * the bytes that are skipped by seeking forward are added to it. Used instead
+ * of the FILE based libgta functions when statistics are enabled. */
+class stats_io_t : public gta::custom_io
+{
+private:
+    FILE *_f;
+    uintmax_t *_bytes;
+    uintmax_t *_skipped;
+    stats_t &_stats;
+
+public:
+    stats_io_t(FILE *f, uintmax_t *bytes, uintmax_t *skipped = NULL) :
+        _f(f), _bytes(bytes), _skipped(skipped), _stats(stats_t::current())
+    {
+    }
+
+    virtual size_t read(void *buffer, size_t size, bool *error)
+    {
+        double t = stats_t::now();
+        size_t r = std::fread(buffer, 1, size, _f);
+        _stats.io_time += stats_t::now() - t;
+        _stats.read_calls++;
+        *_bytes += r;
+        if (r < size && std::ferror(_f))
+        {
+            *error = true;
+            if (errno == 0)
+            {
+                errno = EIO;
+            }
+        }
+        return r;
+    }
+
+    virtual size_t write(const void *buffer, size_t size, bool *error)
+    {
+        double t = stats_t::now();
+        size_t r = std::fwrite(buffer, 1, size, _f);
+        _stats.io_time += stats_t::now() - t;
+        _stats.write_calls++;
+        *_bytes += r;
+        if (r < size)
+        {
+            *error = true;
+            if (errno == 0)
+            {
+                errno = EIO;
+            }
+        }
+        return r;
+    }
+
+    virtual bool seekable()
+    {
+        return fio::seekable(_f);
+    }
+
+    virtual void seek(intmax_t offset, int whence, bool *error)
+    {
+        double t = stats_t::now();
+        int r = fseeko(_f, offset, whence);
+        _stats.io_time += stats_t::now() - t;
+        _stats.seek_calls++;
+        if (r != 0)
+        {
+            *error = true;
+        }
+        else if (_skipped && whence == SEEK_CUR && offset > 0)
+        {
+            *_skipped += offset;
+        }
+    }
+};
+
+/* Measures the time spent in header i/o, minus the time spent in the i/o
+ * calls themselves */
+class stats_header_timer_t
+{
+private:
+    stats_t &_stats;
+    double _t;
+    double _io_time;
+
+public:
+    stats_header_timer_t() : _stats(stats_t::current()), _t(stats_t::now()), _io_time(_stats.io_time)
+    {
+    }
+
+    ~stats_header_timer_t()
+    {
+        _stats.header_time += (stats_t::now() - _t) - (_stats.io_time - _io_time);
+    }
+};
 
 
 std::string type_to_string(const gta::type t, const uintmax_t size)
@@ -492,47 +987,383 @@ void swap_element_endianness(const gta::header &header, void *element)
     }
 }
 
-std::string from_utf8(const std::string &s)
+void endianness_swap_t::start(const gta::header &header)
 {
-    const std::string localcharset = str::localcharset();
-    std::string r;
-    try
-    {
-        r = str::convert(s, "UTF-8", localcharset);
-    }
-    catch (...)
+    _element_size = header.element_size();
+    _runs.clear();
+    size_t offset = 0;
+    for (uintmax_t i = 0; i < header.components(); i++)
     {
-        r = std::string("(not representable in charset ") + localcharset + std::string(")");
+        size_t component_size = header.component_size(i);
+        size_t word_size;
+        switch (header.component_type(i))
+        {
+        case gta::int16:
+        case gta::uint16:
+            word_size = 2;
+            break;
+        case gta::int32:
+        case gta::uint32:
+        case gta::float32:
+        case gta::cfloat32:
+            word_size = 4;
+            break;
+        case gta::int64:
+        case gta::uint64:
+        case gta::float64:
+        case gta::cfloat64:
+            word_size = 8;
+            break;
+        case gta::int128:
+        case gta::uint128:
+        case gta::float128:
+        case gta::cfloat128:
+            word_size = 16;
+            break;
+        default:
+            word_size = 1;
+            break;
+        }
+        if (component_size > 0)
+        {
+            if (_runs.size() > 0 && _runs.back().word_size == word_size)
+            {
+                _runs.back().words += component_size / word_size;
+            }
+            else
+            {
+                run_t r = { offset, word_size, component_size / word_size };
+                _runs.push_back(r);
+            }
+        }
+        offset += component_size;
     }
-    return r;
 }
 
-std::string to_utf8(const std::string &s)
+template<size_t WORD_SIZE>
+static void swap_words(const unsigned char *src, unsigned char *dst, size_t words)
 {
-    const std::string localcharset = str::localcharset();
-    std::string r;
-    try
-    {
-        r = str::convert(s, localcharset, "UTF-8");
-    }
-    catch (std::exception &e)
+    for (size_t i = 0; i < words; i++)
     {
-        /* This should never happen: everything that can be entered by the user should
-         * be representable in UTF-8. Crash the program and let's see if this ever gets
-         * reported. */
-        msg::err("CANNOT CONVERT TO UTF-8: %s", e.what());
-        dbg::crash();
+        unsigned char w[WORD_SIZE];
+        std::memcpy(w, src + i * WORD_SIZE, WORD_SIZE);
+        switch (WORD_SIZE)
+        {
+        case 2:
+            endianness::swap16(w);
+            break;
+        case 4:
+            endianness::swap32(w);
+            break;
+        case 8:
+            endianness::swap64(w);
+            break;
+        case 16:
+            endianness::swap128(w);
+            break;
+        }
+        std::memcpy(dst + i * WORD_SIZE, w, WORD_SIZE);
     }
-    return r;
 }
 
-const size_t element_loop_t::_max_iobuf_size = 1024 * 1024;
-
-element_loop_t::element_loop_t() throw ()
-    : _header_in(), _name_in(), _file_in(NULL), _state_in(),
-    _header_out(), _name_out(), _file_out(NULL), _state_out(), _buf()
+static void swap_run(size_t word_size, const unsigned char *src, unsigned char *dst, size_t words)
 {
-}
+    switch (word_size)
+    {
+    case 2:
+        swap_words<2>(src, dst, words);
+        break;
+    case 4:
+        swap_words<4>(src, dst, words);
+        break;
+    case 8:
+        swap_words<8>(src, dst, words);
+        break;
+    case 16:
+        swap_words<16>(src, dst, words);
+        break;
+    default:
+        if (src != dst)
+        {
+            std::memmove(dst, src, words);
+        }
+        break;
+    }
+}
+
+void endianness_swap_t::run(const void *src, void *dst, size_t n) const
+{
+    const unsigned char *s = static_cast<const unsigned char *>(src);
+    unsigned char *d = static_cast<unsigned char *>(dst);
+    if (_runs.size() == 1)
+    {
+        swap_run(_runs[0].word_size, s, d, n * _runs[0].words);
+    }
+    else
+    {
+        for (size_t e = 0; e < n; e++)
+        {
+            for (size_t r = 0; r < _runs.size(); r++)
+            {
+                swap_run(_runs[r].word_size, s + _runs[r].offset, d + _runs[r].offset, _runs[r].words);
+            }
+            s += _element_size;
+            d += _element_size;
+        }
+    }
+}
+
+std::string from_utf8(const std::string &s)
+{
+    const std::string localcharset = str::localcharset();
+    std::string r;
+    try
+    {
+        r = str::convert(s, "UTF-8", localcharset);
+    }
+    catch (...)
+    {
+        r = std::string("(not representable in charset ") + localcharset + std::string(")");
+    }
+    return r;
+}
+
+std::string to_utf8(const std::string &s)
+{
+    const std::string localcharset = str::localcharset();
+    std::string r;
+    try
+    {
+        r = str::convert(s, localcharset, "UTF-8");
+    }
+    catch (std::exception &e)
+    {
+        /* This should never happen: everything that can be entered by the user should
+         * be representable in UTF-8. Crash the program and let's see if this ever gets
+         * reported. */
+        msg::err("CANNOT CONVERT TO UTF-8: %s", e.what());
+        dbg::crash();
+    }
+    return r;
+}
+
+int processor_count()
+{
+    int n = std::thread::hardware_concurrency();
+    return (n < 1 ? 1 : n);
+}
+
+static void run_blocks_thread(block_job_t *job, size_t first_block, size_t blocks,
+        std::exception_ptr *exception)
+{
+    try
+    {
+        job->run(first_block, blocks);
+    }
+    catch (...)
+    {
+        *exception = std::current_exception();
+    }
+}
+
+void run_blocks(block_job_t &job, size_t blocks, size_t threads)
+{
+    if (threads <= 1 || blocks <= 1)
+    {
+        if (blocks > 0)
+        {
+            job.run(0, blocks);
+        }
+        return;
+    }
+    size_t job_blocks = (blocks - 1) / threads + 1;
+    std::vector<std::thread> thread_group;
+    std::vector<std::exception_ptr> exceptions(threads);
+    for (size_t j = 0; j < threads && j * job_blocks < blocks; j++)
+    {
+        thread_group.push_back(std::thread(run_blocks_thread, &job,
+                    j * job_blocks, std::min(blocks - j * job_blocks, job_blocks),
+                    &(exceptions[j])));
+    }
+    for (size_t j = 0; j < thread_group.size(); j++)
+    {
+        thread_group[j].join();
+    }
+    for (size_t j = 0; j < exceptions.size(); j++)
+    {
+        if (exceptions[j])
+        {
+            std::rethrow_exception(exceptions[j]);
+        }
+    }
+}
+
+void component_stats_t::add(const component_stats_t &s)
+{
+    if (s.n == 0)
+    {
+        return;
+    }
+    if (n == 0)
+    {
+        *this = s;
+        return;
+    }
+    double na = n;
+    double nb = s.n;
+    double delta = s.mean() - mean();
+    m2 += s.m2 + delta * delta * (na * nb / (na + nb));
+    sum += s.sum;
+    n += s.n;
+    min = std::min(min, s.min);
+    max = std::max(max, s.max);
+}
+
+/* Sum n values pairwise. The rounding error grows only with log(n), and
+ * the 8 independent partial sums at the lowest level can be vectorized. */
+static double pairwise_sum(const double *x, size_t n)
+{
+    if (n <= 128)
+    {
+        double s[8] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+        size_t k = 0;
+        for (; k + 8 <= n; k += 8)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                s[i] += x[k + i];
+            }
+        }
+        for (; k < n; k++)
+        {
+            s[k % 8] += x[k];
+        }
+        return ((s[0] + s[1]) + (s[2] + s[3])) + ((s[4] + s[5]) + (s[6] + s[7]));
+    }
+    else
+    {
+        size_t m = (n / 2) / 8 * 8;
+        return pairwise_sum(x, m) + pairwise_sum(x + m, n - m);
+    }
+}
+
+template<typename T>
+static void stats_kernel(const unsigned char *data, size_t stride, size_t n,
+        const void *nodata, double *buf, unsigned char *valid, component_stats_t &stats)
+{
+    bool have_nodata = (nodata != NULL);
+    T nd = T();
+    if (have_nodata)
+    {
+        std::memcpy(&nd, nodata, sizeof(T));
+    }
+    uintmax_t count = 0;
+    double min = +std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    for (size_t k = 0; k < n; k++)
+    {
+        T v;
+        std::memcpy(&v, data + k * stride, sizeof(T));
+        double x = static_cast<double>(v);
+        bool ok = ((!have_nodata || std::memcmp(&v, &nd, sizeof(T)) != 0) && std::isfinite(x));
+        valid[k] = ok;
+        buf[k] = (ok ? x : 0.0);
+        count += ok;
+        min = (ok && x < min ? x : min);
+        max = (ok && x > max ? x : max);
+    }
+    stats = component_stats_t();
+    if (count > 0)
+    {
+        stats.n = count;
+        stats.min = min;
+        stats.max = max;
+    }
+}
+
+component_stats_kernel_t component_stats_plan(const gta::header &hdr, uintmax_t c,
+        blob &nodata, bool &have_nodata)
+{
+    const char *tagval = hdr.component_taglist(c).get("NO_DATA_VALUE");
+    have_nodata = false;
+    nodata.resize(16);
+    switch (hdr.component_type(c))
+    {
+    case gta::int8:
+        have_nodata = (tagval && str::to(tagval, nodata.ptr<int8_t>()));
+        return stats_kernel<int8_t>;
+    case gta::uint8:
+        have_nodata = (tagval && str::to(tagval, nodata.ptr<uint8_t>()));
+        return stats_kernel<uint8_t>;
+    case gta::int16:
+        have_nodata = (tagval && str::to(tagval, nodata.ptr<int16_t>()));
+        return stats_kernel<int16_t>;
+    case gta::uint16:
+        have_nodata = (tagval && str::to(tagval, nodata.ptr<uint16_t>()));
+        return stats_kernel<uint16_t>;
+    case gta::int32:
+        have_nodata = (tagval && str::to(tagval, nodata.ptr<int32_t>()));
+        return stats_kernel<int32_t>;
+    case gta::uint32:
+        have_nodata = (tagval && str::to(tagval, nodata.ptr<uint32_t>()));
+        return stats_kernel<uint32_t>;
+    case gta::int64:
+        have_nodata = (tagval && str::to(tagval, nodata.ptr<int64_t>()));
+        return stats_kernel<int64_t>;
+    case gta::uint64:
+        have_nodata = (tagval && str::to(tagval, nodata.ptr<uint64_t>()));
+        return stats_kernel<uint64_t>;
+#ifdef HAVE_INT128_T
+    case gta::int128:
+        have_nodata = (tagval && str::to(tagval, nodata.ptr<int128_t>()));
+        return stats_kernel<int128_t>;
+#endif
+#ifdef HAVE_UINT128_T
+    case gta::uint128:
+        have_nodata = (tagval && str::to(tagval, nodata.ptr<uint128_t>()));
+        return stats_kernel<uint128_t>;
+#endif
+    case gta::float32:
+    case gta::cfloat32:
+        have_nodata = (tagval && str::to(tagval, nodata.ptr<float>()));
+        return stats_kernel<float>;
+    case gta::float64:
+    case gta::cfloat64:
+        have_nodata = (tagval && str::to(tagval, nodata.ptr<double>()));
+        return stats_kernel<double>;
+#ifdef HAVE_FLOAT128_T
+    case gta::float128:
+    case gta::cfloat128:
+        have_nodata = (tagval && str::to(tagval, nodata.ptr<float128_t>()));
+        return stats_kernel<float128_t>;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+void component_stats_finish(double *buf, const unsigned char *valid, size_t n, component_stats_t &stats)
+{
+    if (stats.n > 0)
+    {
+        double sum = pairwise_sum(buf, n);
+        double mean = sum / stats.n;
+        for (size_t k = 0; k < n; k++)
+        {
+            buf[k] = (valid[k] ? (buf[k] - mean) * (buf[k] - mean) : 0.0);
+        }
+        stats.sum = sum;
+        stats.m2 = pairwise_sum(buf, n);
+    }
+}
+
+const size_t element_loop_t::_max_iobuf_size = 1024 * 1024;
+
+element_loop_t::element_loop_t() throw ()
+    : _header_in(), _name_in(), _file_in(NULL), _state_in(),
+    _header_out(), _name_out(), _file_out(NULL), _state_out(), _buf()
+{
+}
 
 element_loop_t::~element_loop_t()
 {
@@ -559,13 +1390,33 @@ const void *element_loop_t::read(size_t n)
     {
         _buf.resize(n * _header_in.element_size());
     }
-    _header_in.read_elements(_state_in, _file_in, n, _buf.ptr());
+    stats_t &stats = stats_t::current();
+    if (stats.enabled)
+    {
+        stats_io_t io(_file_in, &stats.data_bytes_in);
+        _header_in.read_elements(_state_in, io, n, _buf.ptr());
+    }
+    else
+    {
+        _header_in.read_elements(_state_in, _file_in, n, _buf.ptr());
+    }
+    gtatool_progress.elements_read(_file_in, n);
     return _buf.ptr();
 }
 
 void element_loop_t::write(const void *element, size_t n)
 {
-    _header_out.write_elements(_state_out, _file_out, n, element);
+    stats_t &stats = stats_t::current();
+    if (stats.enabled)
+    {
+        stats_io_t io(_file_out, &stats.data_bytes_out);
+        _header_out.write_elements(_state_out, io, n, element);
+    }
+    else
+    {
+        _header_out.write_elements(_state_out, _file_out, n, element);
+    }
+    gtatool_progress.elements_written(_file_out, n);
 }
 
 const std::string array_loop_t::_stdin_name = "standard input";
@@ -689,7 +1540,18 @@ bool array_loop_t::read(gta::header &header_in, std::string &name_in)
     name_in = _array_name_in;
     try
     {
-        header_in.read_from(_file_in);
+        stats_t &stats = stats_t::current();
+        if (stats.enabled)
+        {
+            stats_header_timer_t timer;
+            stats_io_t io(_file_in, &stats.header_bytes_in);
+            header_in.read_from(io);
+            stats.arrays_in++;
+        }
+        else
+        {
+            header_in.read_from(_file_in);
+        }
     }
     catch (std::exception &e)
     {
@@ -697,6 +1559,10 @@ bool array_loop_t::read(gta::header &header_in, std::string &name_in)
     }
     _file_index_in++;
     _index_in++;
+    if (gtatool_progress.enabled)
+    {
+        gtatool_progress.array_started(this, _filenames_in, _filename_index, _file_in, header_in);
+    }
     return true;
 }
 
@@ -710,20 +1576,45 @@ void array_loop_t::write(const gta::header &header_out, std::string &name_out)
     name_out = _array_name_out;
     try
     {
-        header_out.write_to(_file_out);
+        stats_t &stats = stats_t::current();
+        if (stats.enabled)
+        {
+            stats_header_timer_t timer;
+            stats_io_t io(_file_out, &stats.header_bytes_out);
+            header_out.write_to(io);
+            stats.arrays_out++;
+        }
+        else
+        {
+            header_out.write_to(_file_out);
+        }
     }
     catch (std::exception &e)
     {
         throw exc(_array_name_out + ": " + e.what());
     }
     _index_out++;
+    if (gtatool_progress.enabled)
+    {
+        gtatool_progress.array_written(this, _file_out, header_out);
+    }
 }
 
 void array_loop_t::skip_data(const gta::header &header_in)
 {
     try
     {
-        header_in.skip_data(_file_in);
+        stats_t &stats = stats_t::current();
+        if (stats.enabled)
+        {
+            /* Data that cannot be skipped by seeking is read */
+            stats_io_t io(_file_in, &stats.data_bytes_in, &stats.data_bytes_skipped);
+            header_in.skip_data(io);
+        }
+        else
+        {
+            header_in.skip_data(_file_in);
+        }
     }
     catch (std::exception &e)
     {
@@ -731,11 +1622,142 @@ void array_loop_t::skip_data(const gta::header &header_in)
     }
 }
 
+/* Copy the data of an array from pipe fin to pipe fout inside the kernel,
+ * without passing it through user space. This makes chains of gta commands
+ * that pass arrays through unchanged (stream-extract, stream-merge, ...) run
+ * at memory bandwidth. It is only done if enabled with gtatool_splice, and
+ * only for gtatool_stdin, which is unbuffered then. Returns false if this is
+ * not possible for the given headers or files; nothing was copied then. */
+static bool splice_data(const gta::header &header_in, FILE *fin,
+        const gta::header &header_out, FILE *fout)
+{
+#ifdef HAVE_SPLICE
+    if (!gtatool_splice || fin != gtatool_stdin
+            || header_in.compression() != gta::none || header_out.compression() != gta::none
+            || header_in.data_size() < (1 << 16)
+            || header_in.dimensions() != header_out.dimensions()
+            || header_in.components() != header_out.components())
+    {
+        return false;
+    }
+    for (uintmax_t i = 0; i < header_in.dimensions(); i++)
+    {
+        if (header_in.dimension_size(i) != header_out.dimension_size(i))
+        {
+            return false;
+        }
+    }
+    for (uintmax_t i = 0; i < header_in.components(); i++)
+    {
+        if (header_in.component_type(i) != header_out.component_type(i)
+                || header_in.component_size(i) != header_out.component_size(i))
+        {
+            return false;
+        }
+    }
+    struct stat st_in, st_out;
+    if (fstat(fileno(fin), &st_in) != 0 || !S_ISFIFO(st_in.st_mode)
+            || fstat(fileno(fout), &st_out) != 0 || !S_ISFIFO(st_out.st_mode))
+    {
+        return false;
+    }
+
+    /* The input is unbuffered, so all remaining data is still in the pipe.
+     * Since the input is a pipe, stdio does not track a file position that
+     * could become invalid. */
+    uintmax_t size = header_in.data_size();
+    fio::flush(fout);
+    while (size > 0)
+    {
+        size_t k = (size < (1U << 30) ? size : (1U << 30));
+        ssize_t r = splice(fileno(fin), NULL, fileno(fout), NULL, k, SPLICE_F_MOVE);
+        if (r < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (r < 0 && errno == EINVAL)
+        {
+            /* splicing is not supported for these pipes */
+            break;
+        }
+        else if (r <= 0)
+        {
+            throw exc(r == 0 ? std::string("unexpected end of file") : std::strerror(errno));
+        }
+        size -= r;
+    }
+    if (size > 0)
+    {
+        std::vector<unsigned char> buf(size < (1U << 20) ? size : (1U << 20));
+        while (size > 0)
+        {
+            size_t k = (size < buf.size() ? size : buf.size());
+            fio::read(&(buf[0]), 1, k, fin);
+            fio::write(&(buf[0]), 1, k, fout);
+            size -= k;
+        }
+    }
+    return true;
+#else
+    (void)header_in;
+    (void)fin;
+    (void)header_out;
+    (void)fout;
+    return false;
+#endif
+}
+
+/* Copy the data of an uncompressed array through an element loop, in pieces
+ * of about 1 MiB, so that progress reports see the elements. */
+static void copy_data_with_progress(const gta::header &header_in, FILE *fin,
+        const gta::header &header_out, FILE *fout)
+{
+    element_loop_t element_loop;
+    element_loop.start(header_in, "", fin, header_out, "", fout);
+    uintmax_t piece = std::max(static_cast<uintmax_t>(1), (static_cast<uintmax_t>(1) << 20) / header_in.element_size());
+    for (uintmax_t e = 0; e < header_in.elements(); e += piece)
+    {
+        size_t n = checked_cast<size_t>(std::min(piece, header_in.elements() - e));
+        element_loop.write(element_loop.read(n), n);
+    }
+}
+
+static void copy_array_data(const gta::header &header_in, FILE *fin,
+        const gta::header &header_out, FILE *fout)
+{
+    stats_t &stats = stats_t::current();
+    double t = stats_t::now();
+    if (splice_data(header_in, fin, header_out, fout))
+    {
+        if (stats.enabled)
+        {
+            stats.io_time += stats_t::now() - t;
+            stats.data_bytes_in += header_in.data_size();
+            stats.data_bytes_out += header_in.data_size();
+        }
+    }
+    else if (gtatool_progress.enabled && header_in.data_size() > 0
+            && header_in.compression() == gta::none && header_out.compression() == gta::none)
+    {
+        copy_data_with_progress(header_in, fin, header_out, fout);
+    }
+    else if (!stats.enabled)
+    {
+        header_in.copy_data(fin, header_out, fout);
+    }
+    else
+    {
+        stats_io_t io_in(fin, &stats.data_bytes_in);
+        stats_io_t io_out(fout, &stats.data_bytes_out);
+        header_in.copy_data(io_in, header_out, io_out);
+    }
+}
+
 void array_loop_t::copy_data(const gta::header &header_in, const gta::header &header_out)
 {
     try
     {
-        header_in.copy_data(_file_in, header_out, _file_out);
+        copy_array_data(header_in, _file_in, header_out, _file_out);
     }
     catch (std::exception &e)
     {
@@ -747,7 +1769,7 @@ void array_loop_t::copy_data(const gta::header &header_in, const array_loop_t &a
 {
     try
     {
-        header_in.copy_data(_file_in, header_out, array_loop_out._file_out);
+        copy_array_data(header_in, _file_in, header_out, array_loop_out._file_out);
     }
     catch (std::exception &e)
     {
@@ -759,7 +1781,16 @@ void array_loop_t::read_data(const gta::header &header_in, void *data)
 {
     try
     {
-        header_in.read_data(_file_in, data);
+        stats_t &stats = stats_t::current();
+        if (stats.enabled)
+        {
+            stats_io_t io(_file_in, &stats.data_bytes_in);
+            header_in.read_data(io, data);
+        }
+        else
+        {
+            header_in.read_data(_file_in, data);
+        }
     }
     catch (std::exception &e)
     {
@@ -771,7 +1802,16 @@ void array_loop_t::write_data(const gta::header &header_out, const void *data)
 {
     try
     {
-        header_out.write_data(_file_out, data);
+        stats_t &stats = stats_t::current();
+        if (stats.enabled)
+        {
+            stats_io_t io(_file_out, &stats.data_bytes_out);
+            header_out.write_data(io, data);
+        }
+        else
+        {
+            header_out.write_data(_file_out, data);
+        }
     }
     catch (std::exception &e)
     {
@@ -793,3 +1833,241 @@ void buffer_data(const gta::header &header, FILE *f, gta::header &buf_header, FI
     buf_header.set_compression(gta::none);
     header.copy_data(f, buf_header, *buf_f);
 }
+
+const size_t box_data_t::max_piece_size;
+
+static bool box_is_empty(const std::vector<uintmax_t> &low, const std::vector<uintmax_t> &high)
+{
+    for (size_t i = 0; i < low.size(); i++)
+    {
+        if (low[i] > high[i])
+        {
+            return true;
+        }
+    }
+    return low.empty();
+}
+
+// Go to the next box row by incrementing the indices in dimensions 1 and up.
+// Return false if there is no next row.
+static bool next_box_row(std::vector<uintmax_t> &index,
+        const std::vector<uintmax_t> &low, const std::vector<uintmax_t> &high)
+{
+    for (size_t i = 1; i < index.size(); i++)
+    {
+        if (index[i] < high[i])
+        {
+            index[i]++;
+            return true;
+        }
+        index[i] = low[i];
+    }
+    return false;
+}
+
+static void pass_through(element_loop_t &element_loop, size_t piece_elements, uintmax_t n)
+{
+    while (n > 0)
+    {
+        size_t m = checked_cast<size_t>(std::min(n, static_cast<uintmax_t>(piece_elements)));
+        element_loop.write(element_loop.read(m), m);
+        n -= m;
+    }
+}
+
+void replace_box(element_loop_t &element_loop, const gta::header &header,
+        const std::vector<uintmax_t> &low, const std::vector<uintmax_t> &high,
+        box_data_t &data)
+{
+    const size_t piece_elements = std::max(static_cast<size_t>(1),
+            box_data_t::max_piece_size / checked_cast<size_t>(header.element_size()));
+    uintmax_t pos = 0;
+    if (!box_is_empty(low, high))
+    {
+        const uintmax_t row_size = high[0] - low[0] + 1;
+        std::vector<uintmax_t> index(low);
+        do
+        {
+            uintmax_t row_start = header.indices_to_linear_index(&(index[0]));
+            pass_through(element_loop, piece_elements, row_start - pos);
+            for (uintmax_t e = 0; e < row_size; e += piece_elements)
+            {
+                size_t n = checked_cast<size_t>(std::min(row_size - e, static_cast<uintmax_t>(piece_elements)));
+                element_loop.read(n);
+                element_loop.write(data.next(n), n);
+            }
+            pos = row_start + row_size;
+        }
+        while (next_box_row(index, low, high));
+    }
+    pass_through(element_loop, piece_elements, header.elements() - pos);
+}
+
+void replace_box_in_place(const gta::header &header, FILE *f, uintmax_t data_offset,
+        const std::vector<uintmax_t> &low, const std::vector<uintmax_t> &high,
+        box_data_t &data)
+{
+    if (box_is_empty(low, high))
+    {
+        return;
+    }
+    const size_t piece_elements = std::max(static_cast<size_t>(1),
+            box_data_t::max_piece_size / checked_cast<size_t>(header.element_size()));
+    std::vector<uintmax_t> lower(low);
+    std::vector<uintmax_t> higher(low);
+    do
+    {
+        for (size_t i = 1; i < lower.size(); i++)
+        {
+            higher[i] = lower[i];
+        }
+        for (uintmax_t e = low[0]; e <= high[0]; e += piece_elements)
+        {
+            lower[0] = e;
+            higher[0] = std::min(high[0], e + piece_elements - 1);
+            size_t n = checked_cast<size_t>(higher[0] - lower[0] + 1);
+            header.write_block(f, data_offset, &(lower[0]), &(higher[0]), data.next(n));
+        }
+        lower[0] = low[0];
+    }
+    while (next_box_row(lower, low, high));
+}
+
+component_shuffle_t::component_shuffle_t() throw ()
+    : _src_strides(), _dst_element_size(0), _runs()
+{
+}
+
+void component_shuffle_t::start(const std::vector<size_t> &src_strides, size_t dst_element_size)
+{
+    _src_strides = src_strides;
+    _dst_element_size = dst_element_size;
+    _runs.clear();
+}
+
+void component_shuffle_t::add(size_t src, size_t src_offset, size_t dst_offset, size_t size)
+{
+    if (size > 0)
+    {
+        run_t r = { src, src_offset, dst_offset, size };
+        _runs.push_back(r);
+    }
+}
+
+bool component_shuffle_t::run_dst_less(const run_t &a, const run_t &b)
+{
+    return a.dst_offset < b.dst_offset;
+}
+
+void component_shuffle_t::finish()
+{
+    std::sort(_runs.begin(), _runs.end(), run_dst_less);
+    std::vector<run_t> merged;
+    for (size_t i = 0; i < _runs.size(); i++)
+    {
+        if (!merged.empty()
+                && merged.back().src == _runs[i].src
+                && merged.back().src_offset + merged.back().size == _runs[i].src_offset
+                && merged.back().dst_offset + merged.back().size == _runs[i].dst_offset)
+        {
+            merged.back().size += _runs[i].size;
+        }
+        else
+        {
+            merged.push_back(_runs[i]);
+        }
+    }
+    _runs.swap(merged);
+}
+
+size_t component_shuffle_t::block_elements() const
+{
+    size_t max_size = _dst_element_size;
+    for (size_t i = 0; i < _src_strides.size(); i++)
+    {
+        max_size = std::max(max_size, _src_strides[i]);
+    }
+    return std::max(static_cast<size_t>(1), static_cast<size_t>(1024 * 1024) / std::max(max_size, static_cast<size_t>(1)));
+}
+
+// Copy one run for n elements; SIZE is the run length known at compile time.
+template<size_t SIZE>
+static void shuffle_run(size_t n, const unsigned char *src, size_t src_stride,
+        unsigned char *dst, size_t dst_stride)
+{
+    for (size_t e = 0; e < n; e++)
+    {
+        std::memcpy(dst, src, SIZE);
+        src += src_stride;
+        dst += dst_stride;
+    }
+}
+
+static void shuffle_run(size_t n, const unsigned char *src, size_t src_stride,
+        unsigned char *dst, size_t dst_stride, size_t size)
+{
+    for (size_t e = 0; e < n; e++)
+    {
+        std::memcpy(dst, src, size);
+        src += src_stride;
+        dst += dst_stride;
+    }
+}
+
+void component_shuffle_t::run(size_t n, const void *const *srcs, void *dst) const
+{
+    for (size_t r = 0; r < _runs.size(); r++)
+    {
+        const run_t &run = _runs[r];
+        const size_t src_stride = _src_strides[run.src];
+        const unsigned char *s = static_cast<const unsigned char *>(srcs[run.src]) + run.src_offset;
+        unsigned char *d = static_cast<unsigned char *>(dst) + run.dst_offset;
+        if (run.size == _dst_element_size && src_stride == _dst_element_size)
+        {
+            std::memcpy(d, s, n * _dst_element_size);
+            continue;
+        }
+        switch (run.size)
+        {
+        case 1:
+            shuffle_run<1>(n, s, src_stride, d, _dst_element_size);
+            break;
+        case 2:
+            shuffle_run<2>(n, s, src_stride, d, _dst_element_size);
+            break;
+        case 3:
+            shuffle_run<3>(n, s, src_stride, d, _dst_element_size);
+            break;
+        case 4:
+            shuffle_run<4>(n, s, src_stride, d, _dst_element_size);
+            break;
+        case 6:
+            shuffle_run<6>(n, s, src_stride, d, _dst_element_size);
+            break;
+        case 8:
+            shuffle_run<8>(n, s, src_stride, d, _dst_element_size);
+            break;
+        case 12:
+            shuffle_run<12>(n, s, src_stride, d, _dst_element_size);
+            break;
+        case 16:
+            shuffle_run<16>(n, s, src_stride, d, _dst_element_size);
+            break;
+        default:
+            shuffle_run(n, s, src_stride, d, _dst_element_size, run.size);
+            break;
+        }
+    }
+}
+
+std::vector<size_t> component_offsets(const gta::header &header)
+{
+    std::vector<size_t> offsets(checked_cast<size_t>(header.components()));
+    size_t offset = 0;
+    for (size_t i = 0; i < offsets.size(); i++)
+    {
+        offsets[i] = offset;
+        offset += checked_cast<size_t>(header.component_size(i));
+    }
+    return offsets;
+}
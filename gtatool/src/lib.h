@@ -51,6 +51,7 @@ typedef __float128 float128_t;
 
 #include <string>
 #include <vector>
+#include <atomic>
 #include <cerrno>
 #include <cstdio>
 
@@ -75,6 +76,157 @@ extern char** gtatool_argv;
 extern FILE *gtatool_stdin;
 extern FILE *gtatool_stdout;
 
+/* Whether array data may be moved from gtatool_stdin to an output pipe inside
+ * the kernel, with splice(). This is enabled by setting the environment
+ * variable GTATOOL_SPLICE. main.cpp then makes gtatool_stdin unbuffered, so
+ * that stdio never holds data that was read ahead of the current position. */
+extern bool gtatool_splice;
+
+/* I/O and timing statistics of a command, enabled with the global --stats
+ * option. When enabled, array_loop_t and element_loop_t pass all their GTA
+ * i/o through counting and timing wrappers. Input and output that commands
+ * do on their own is only visible in the system call counts.
+ * The i/o of a thread is accounted to stats_t::current(), which is
+ * gtatool_stats unless the thread uses a stats_redirect_t. */
+class stats_t
+{
+public:
+    bool enabled;
+    bool json;
+    double start_time;
+    uintmax_t arrays_in, arrays_out;
+    uintmax_t header_bytes_in, header_bytes_out;
+    uintmax_t data_bytes_in, data_bytes_out;
+    uintmax_t data_bytes_skipped;      // skipped by seeking, without reading
+    uintmax_t read_calls, write_calls, seek_calls;
+    double io_time;             // time spent in read, write and seek calls
+    double header_time;         // time spent in header parsing, excluding io_time
+
+    stats_t();
+
+    /* Start collecting statistics */
+    void start(bool json);
+
+    /* Add the counters and times of s to these statistics */
+    void add(const stats_t &s);
+
+    /* Print the statistics to stderr, as text or JSON */
+    void print() const;
+
+    /* A monotonic clock, in seconds */
+    static double now();
+
+    /* The statistics that the i/o of the calling thread is accounted to */
+    static stats_t &current();
+};
+extern stats_t gtatool_stats;
+
+/* Account the i/o of the calling thread to the given statistics while this
+ * object exists. Threads that do i/o concurrently with the main thread use
+ * this to collect their own statistics, which the main thread then adds to
+ * gtatool_stats after joining them. */
+class stats_redirect_t
+{
+private:
+    stats_t *_previous;
+
+public:
+    stats_redirect_t(stats_t &stats);
+    ~stats_redirect_t();
+};
+
+/* Progress reports for long-running commands, enabled with the global
+ * --progress option. The first array_loop_t that reads an array is tracked.
+ * Element loops that read from its current input file report the elements
+ * they process; other element loops, e.g. on a second input or a temporary
+ * file, are ignored. Commands that produce arrays without reading GTA input,
+ * such as create and the importers, are tracked on the output side instead:
+ * if the first array_loop_t event is a written array, the elements written
+ * to the output file of that loop are counted.
+ * Reports are written at most once per interval, as a line of key=value pairs
+ * that can be read by humans and programs alike:
+ *   progress: arrays=<done> array=<%> done=<%> mb_per_s=<rate> eta=<seconds>
+ * 'array' is the progress within the current array. 'done' and 'eta' are only
+ * given if the GTA input consists of regular files. */
+class progress_t
+{
+private:
+    static std::atomic<bool> _due;              // set when the interval has passed
+
+    const void *_owner;
+    double _interval;
+    double _start_time;
+    bool _reported;
+    bool _output_side;                          // whether output arrays are tracked
+    std::vector<uintmax_t> _file_offsets;       // start of each input file, or empty
+    FILE *_stream;                              // current input (or output) file of the owner
+    FILE *_file;                                // _input if it is a regular file, or NULL
+    size_t _file_index;
+    off_t _array_offset;                        // start of the current array data
+    uintmax_t _arrays;                          // arrays started
+    uintmax_t _array_elements;
+    uintmax_t _array_data_size;
+    bool _array_compressed;
+    uintmax_t _elements;                        // elements of the current array done
+    uintmax_t _data_bytes;                      // data bytes of previous arrays
+
+    static void tick(double interval);
+    void array(const gta::header &header, FILE *f);
+    void report(bool final);
+
+    void elements(uintmax_t n)
+    {
+        _elements += n;
+        if (_due.load(std::memory_order_relaxed))
+        {
+            check();
+        }
+    }
+
+public:
+    bool enabled;
+
+    progress_t();
+
+    /* Start reporting progress, at most once per interval seconds. For a
+     * positive interval, a background thread sets a flag whenever the
+     * interval has passed, so that checking for a due report is cheap. With
+     * an interval of 0, every check writes a report. */
+    void start(double interval = 1.0);
+
+    /* Called by array loops after reading the header of an array from the
+     * input file with the given index */
+    void array_started(const void *owner, const std::vector<std::string> &filenames,
+            size_t file_index, FILE *f, const gta::header &header);
+
+    /* Called by array loops after writing the header of an array to f */
+    void array_written(const void *owner, FILE *f, const gta::header &header);
+
+    /* Called by element loops that read n elements from f, or write n
+     * elements to f. The overhead is a comparison and a flag check. */
+    void elements_read(const FILE *f, uintmax_t n)
+    {
+        if (enabled && f == _stream && !_output_side)
+        {
+            elements(n);
+        }
+    }
+    void elements_written(const FILE *f, uintmax_t n)
+    {
+        if (enabled && f == _stream && _output_side)
+        {
+            elements(n);
+        }
+    }
+
+    /* Write a report if one is due */
+    void check();
+
+    /* Write a final report if any report was written */
+    void finish();
+};
+extern progress_t gtatool_progress;
+
 /* Convert GTA type identifiers to strings and back */
 std::string type_to_string(const gta::type t, const uintmax_t size);
 void type_from_string(const std::string &s, gta::type *t, uintmax_t *size);
@@ -91,10 +243,102 @@ void valuelist_from_string(const std::string &s, const std::vector<gta::type> &t
 void swap_component_endianness(const gta::header &header, uintmax_t i, void *component);
 void swap_element_endianness(const gta::header &header, void *element);
 
+/* Swap the endianness of blocks of GTA elements.
+ * The plan is derived from the component list: each component becomes a run
+ * of words of 1, 2, 4, 8, or 16 bytes, and adjacent runs with the same word
+ * size are merged. If a single run covers the whole element, a block of
+ * elements is swapped in one tight loop. Source and destination may be the
+ * same. */
+class endianness_swap_t
+{
+private:
+    struct run_t
+    {
+        size_t offset;
+        size_t word_size;
+        size_t words;
+    };
+
+    size_t _element_size;
+    std::vector<run_t> _runs;
+
+public:
+    endianness_swap_t() : _element_size(0), _runs()
+    {
+    }
+
+    void start(const gta::header &header);
+    void run(const void *src, void *dst, size_t n) const;
+};
+
 /* Convert strings between the local character set and UTF-8, in a fail-safe way */
 std::string from_utf8(const std::string &s);
 std::string to_utf8(const std::string &s);
 
+/* Return the number of processors, as a default for the number of threads
+ * used by commands that support parallel computation */
+int processor_count();
+
+/* A job that processes a contiguous range of blocks, see run_blocks() */
+class block_job_t
+{
+public:
+    virtual ~block_job_t() {}
+    virtual void run(size_t first_block, size_t blocks) = 0;
+};
+
+/* Run the job on the given number of blocks. The blocks are split into
+ * contiguous ranges of equal size, one for each of at most the given number
+ * of threads. An exception thrown by a thread is rethrown in the calling
+ * thread after all threads have finished. */
+void run_blocks(block_job_t &job, size_t blocks, size_t threads);
+
+/* Statistics of the valid values of one component. The sum of squared
+ * deviations from the mean (m2) is kept instead of the sum of squares, and
+ * partial statistics are combined with the formula of Chan et al., which is
+ * numerically stable. */
+struct component_stats_t
+{
+    uintmax_t n;
+    double min, max, sum, m2;
+
+    component_stats_t() : n(0), min(0.0), max(0.0), sum(0.0), m2(0.0)
+    {
+    }
+
+    double mean() const
+    {
+        return sum / n;
+    }
+
+    void add(const component_stats_t &s);
+};
+
+/* Statistics are computed in blocks of this number of elements. Commands
+ * that combine the block statistics in block order get the same results,
+ * regardless of how the blocks are distributed over threads. */
+const size_t component_stats_block_size = 4096;
+
+/* Convert n values of one component at the given stride to double into buf,
+ * ignoring values that are bitwise equal to *nodata (if nodata is not NULL)
+ * and values that are not finite in double precision. The validity flags
+ * are stored in valid; both must have room for n entries. The count, minimum
+ * and maximum of the valid values are stored in stats; the sums are added by
+ * component_stats_finish(). */
+typedef void (*component_stats_kernel_t)(const unsigned char *data, size_t stride, size_t n,
+        const void *nodata, double *buf, unsigned char *valid, component_stats_t &stats);
+
+/* Get the statistics kernel for component c and parse its NO_DATA_VALUE
+ * tag, if any, into nodata. Complex components use their real part.
+ * Returns NULL if the component type is not supported. */
+component_stats_kernel_t component_stats_plan(const gta::header &hdr, uintmax_t c,
+        blob &nodata, bool &have_nodata);
+
+/* Sum the valid values in buf and their squared deviations from the mean,
+ * in two passes, and store the sums in stats. The contents of buf are
+ * overwritten. */
+void component_stats_finish(double *buf, const unsigned char *valid, size_t n, component_stats_t &stats);
+
 /* Loop over all input and output array elements.
  * This loop provides input/output buffering for filtering commands that
  * work on array element level. */
@@ -214,4 +458,83 @@ public:
  */
 void buffer_data(const gta::header &header, FILE *f, gta::header &buf_header, FILE **buf_f);
 
+/* Replace the elements inside a box of an array with new data, and keep all
+ * other elements. The box is given by its low and high coordinates
+ * (inclusive); it must lie inside the array, and it is empty if a low
+ * coordinate is greater than the corresponding high coordinate.
+ *
+ * The new data is requested from a box_data_t object, in the order of the box
+ * elements. Each request is for a piece of a box row (a run of elements along
+ * dimension 0) of at most max_piece_size bytes.
+ */
+class box_data_t
+{
+public:
+    static const size_t max_piece_size = 1024 * 1024;
+
+    virtual ~box_data_t() {}
+    /* Return the next n elements of the box */
+    virtual const void *next(size_t n) = 0;
+};
+
+/* Copy the array data from input to output via the element loop, and replace
+ * the box on the way. */
+void replace_box(element_loop_t &element_loop, const gta::header &header,
+        const std::vector<uintmax_t> &low, const std::vector<uintmax_t> &high,
+        box_data_t &data);
+
+/* Replace the box directly in the array data that starts at data_offset in
+ * the seekable file f. The data must not be compressed. Only the box is
+ * written; the file position afterwards is undefined. */
+void replace_box_in_place(const gta::header &header, FILE *f, uintmax_t data_offset,
+        const std::vector<uintmax_t> &low, const std::vector<uintmax_t> &high,
+        box_data_t &data);
+
+/* Assemble output array elements from the components of one or more source
+ * elements, e.g. to reorder, extract, merge, or set components.
+ *
+ * The plan is a list of byte runs (source, source offset, destination
+ * offset, length). Adjacent runs are merged when the plan is compiled, and
+ * the plan is then applied to blocks of elements at once.
+ * A source can be a constant element that is used for all output elements;
+ * its element stride is 0. */
+class component_shuffle_t
+{
+private:
+    struct run_t
+    {
+        size_t src;
+        size_t src_offset;
+        size_t dst_offset;
+        size_t size;
+    };
+    std::vector<size_t> _src_strides;
+    size_t _dst_element_size;
+    std::vector<run_t> _runs;
+
+    static bool run_dst_less(const run_t &a, const run_t &b);
+
+public:
+    component_shuffle_t() throw ();
+
+    /* Start a new plan. Source i has elements of size src_strides[i]; use 0
+     * for a constant element. */
+    void start(const std::vector<size_t> &src_strides, size_t dst_element_size);
+    /* Copy size bytes at src_offset of the source element to dst_offset of
+     * the output element. */
+    void add(size_t src, size_t src_offset, size_t dst_offset, size_t size);
+    /* Compile the plan. Output bytes not covered by any run are left
+     * unchanged by run(). */
+    void finish();
+
+    /* Build n output elements in dst. Source i starts at srcs[i]. */
+    void run(size_t n, const void *const *srcs, void *dst) const;
+
+    /* The number of elements to process per block */
+    size_t block_elements() const;
+};
+
+/* Return the byte offsets of all components in an array element */
+std::vector<size_t> component_offsets(const gta::header &header);
+
 #endif
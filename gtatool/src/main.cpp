@@ -23,6 +23,8 @@
 #include "config.h"
 
 #include <cstring>
+#include <cstdlib>
+#include <cerrno>
 #include <locale.h>
 
 #if W32
@@ -31,6 +33,9 @@
 #   include <fcntl.h>
 #   include <string.h>
 #   include <strings.h>
+#else
+#   include <fcntl.h>
+#   include <sys/stat.h>
 #endif
 
 #include <gta/gta.hpp>
@@ -101,7 +106,15 @@ extern "C" int gtatool_help(int argc, char *argv[])
     if (arguments.size() == 0)
     {
         msg::req_txt(
-                "Usage: %s [-q|--quiet] [-v|--verbose] <command> [argument...]",
+                "Usage: %s [-q|--quiet] [-v|--verbose] [--stats[=json]] [--progress[=<s>]] <command> [argument...]\n"
+                "Global options can be given in any order before the command.\n"
+                "With --stats, i/o and timing statistics are printed when the command finishes.\n"
+                "With --progress, the progress of the command is printed regularly, at most once "
+                "every s seconds (default 1).\n"
+                "If the environment variable GTATOOL_SPLICE is set to a value other than 0, "
+                "array data that is passed through unchanged from a standard input pipe to "
+                "an output pipe is moved inside the kernel, without copying it, and standard "
+                "input and output pipes are enlarged to 1 MiB.",
                 program_name);
         cmd_category_t categories[] = {
             cmd_stream,
@@ -180,6 +193,69 @@ extern "C" int gtatool_help(int argc, char *argv[])
     }
 }
 
+/* When standard input or output is a pipe, e.g. between two chained gta
+ * commands, enlarge the pipe buffer and the stdio buffer of the stream. All
+ * array data passes through these buffers, and the default pipe size of 64 KiB
+ * means one system call and one context switch per 64 KiB on each side.
+ * If unbuffered is set, the stream is made unbuffered instead of getting a
+ * larger stdio buffer. Failures are harmless and ignored. This must be called
+ * before any i/o.
+ * This is only done when splicing is requested: each enlarged pipe counts
+ * against the per-user limit of pipe pages, and when that is exhausted, all
+ * new pipes of the user, also those of unrelated programs, get a single page. */
+static void enlarge_pipe_buffer(FILE *f, bool unbuffered)
+{
+#if !W32 && defined F_SETPIPE_SZ
+    const int pipe_size = 1 << 20;
+    struct stat st;
+    int fd = fileno(f);
+    if (fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode))
+    {
+        int size = fcntl(fd, F_GETPIPE_SZ);
+        if (size >= 0 && size < pipe_size)
+        {
+            size = fcntl(fd, F_SETPIPE_SZ, pipe_size);
+        }
+        if (unbuffered)
+        {
+            setvbuf(f, NULL, _IONBF, 0);
+        }
+        else if (size > BUFSIZ)
+        {
+            setvbuf(f, NULL, _IOFBF, size);
+        }
+    }
+#else
+    (void)f;
+    (void)unbuffered;
+#endif
+}
+
+/* Whether splicing array data between pipes was requested with the
+ * environment variable GTATOOL_SPLICE, and is supported. */
+static bool splice_requested()
+{
+#ifdef HAVE_SPLICE
+    const char *env = std::getenv("GTATOOL_SPLICE");
+    return (env && env[0] && std::strcmp(env, "0") != 0);
+#else
+    return false;
+#endif
+}
+
+/* Whether array data can be spliced from the given input. It must be a pipe,
+ * and it must be unbuffered then, which makes reading headers more expensive. */
+static bool splice_possible(FILE *f)
+{
+#ifdef HAVE_SPLICE
+    struct stat st;
+    return (fstat(fileno(f), &st) == 0 && S_ISFIFO(st.st_mode));
+#else
+    (void)f;
+    return false;
+#endif
+}
+
 int main(int argc, char *argv[])
 {
     // We want the character set of the user's locale, but everything else
@@ -230,18 +306,44 @@ int main(int argc, char *argv[])
     }
     else
     {
+        /* Global options, in any order, up to the command name */
         int argv_cmd_index = 1;
-        if (argc > argv_cmd_index + 1 && (strcmp(argv[argv_cmd_index], "-q") == 0
-                    || strcmp(argv[argv_cmd_index], "--quiet") == 0))
-        {
-            argv_cmd_index++;
-            msg::set_level(msg::ERR);
-        }
-        if (argc > argv_cmd_index + 1 && (strcmp(argv[argv_cmd_index], "-v") == 0
-                    || strcmp(argv[argv_cmd_index], "--verbose") == 0))
+        while (argc > argv_cmd_index + 1)
         {
+            const char *arg = argv[argv_cmd_index];
+            if (strcmp(arg, "-q") == 0 || strcmp(arg, "--quiet") == 0)
+            {
+                msg::set_level(msg::ERR);
+            }
+            else if (strcmp(arg, "-v") == 0 || strcmp(arg, "--verbose") == 0)
+            {
+                msg::set_level(msg::DBG);
+            }
+            else if (strcmp(arg, "--stats") == 0 || strcmp(arg, "--stats=json") == 0)
+            {
+                gtatool_stats.start(strcmp(arg, "--stats=json") == 0);
+            }
+            else if (strcmp(arg, "--progress") == 0)
+            {
+                gtatool_progress.start();
+            }
+            else if (strncmp(arg, "--progress=", 11) == 0)
+            {
+                char *end;
+                errno = 0;
+                double interval = std::strtod(arg + 11, &end);
+                if (end == arg + 11 || *end != '\0' || errno != 0 || !(interval >= 0.0))
+                {
+                    msg::err("invalid progress interval: %s", arg + 11);
+                    return 1;
+                }
+                gtatool_progress.start(interval);
+            }
+            else
+            {
+                break;
+            }
             argv_cmd_index++;
-            msg::set_level(msg::DBG);
         }
         int cmd_index = cmd_find(argv[argv_cmd_index]);
         if (cmd_index < 0)
@@ -251,7 +353,7 @@ int main(int argc, char *argv[])
         }
         else if (!cmd_is_available(cmd_index))
         {
-            msg::err("command %s is not available in this version of %s", argv[1], PACKAGE_NAME);
+            msg::err("command %s is not available in this version of %s", argv[argv_cmd_index], PACKAGE_NAME);
             exitcode = 1;
         }
         else
@@ -262,8 +364,22 @@ int main(int argc, char *argv[])
             gtatool_argv = argv;
             gtatool_stdin = stdin;
             gtatool_stdout = stdout;
+            if (splice_requested())
+            {
+                gtatool_splice = splice_possible(gtatool_stdin);
+                enlarge_pipe_buffer(gtatool_stdin, gtatool_splice);
+                enlarge_pipe_buffer(gtatool_stdout, false);
+            }
             exitcode = cmd_run(cmd_index, argc - argv_cmd_index, &(argv[argv_cmd_index]));
             cmd_close(cmd_index);
+            if (exitcode == 0)
+            {
+                gtatool_progress.finish();
+            }
+            if (gtatool_stats.enabled)
+            {
+                gtatool_stats.print();
+            }
         }
     }
     return exitcode;
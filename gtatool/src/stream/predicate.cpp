@@ -0,0 +1,683 @@
+/*
+ * This file is part of gtatool, a tool to manipulate Generic Tagged Arrays
+ * (GTAs).
+ *
+ * Copyright (C) 2014
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "base/exc.h"
+#include "base/blb.h"
+#include "base/str.h"
+#include "base/chk.h"
+
+#include "lib.h"
+
+#include "stream/predicate.h"
+
+
+/*
+ * Statistics
+ */
+
+/* The elements are read in batches, and the blocks of each batch are
+ * distributed over the threads. The block statistics are combined in block
+ * order, as in info, so that the results do not depend on the number of
+ * threads. */
+
+static const size_t block_size = component_stats_block_size;
+
+// Number of blocks that each thread computes in one batch.
+static const size_t blocks_per_job = 16;
+
+class array_stats_job_t : public block_job_t
+{
+public:
+    size_t element_size;
+    std::vector<size_t> offsets;
+    std::vector<component_stats_kernel_t> kernels;        // NULL for unsupported components
+    std::vector<blob> nodata;
+    std::vector<bool> have_nodata;
+    const unsigned char *elements;
+    size_t n;
+    std::vector<component_stats_t> block_stats;
+
+    void run(size_t first_block, size_t blocks)
+    {
+        const size_t components = kernels.size();
+        std::vector<double> buf(block_size);
+        std::vector<unsigned char> valid(block_size);
+        for (size_t b = first_block; b < first_block + blocks; b++)
+        {
+            size_t m = std::min(n - b * block_size, block_size);
+            for (size_t c = 0; c < components; c++)
+            {
+                if (kernels[c])
+                {
+                    component_stats_t &s = block_stats[b * components + c];
+                    kernels[c](elements + b * block_size * element_size + offsets[c], element_size, m,
+                            have_nodata[c] ? nodata[c].ptr() : NULL, &(buf[0]), &(valid[0]), s);
+                    component_stats_finish(&(buf[0]), &(valid[0]), m, s);
+                }
+            }
+        }
+    }
+};
+
+array_stats_t::array_stats_t() : _stats()
+{
+}
+
+void array_stats_t::compute(const gta::header &header, FILE *f, const std::string &name, int threads)
+{
+    const size_t components = checked_cast<size_t>(header.components());
+    _stats.assign(components, component_stats_t());
+    if (header.data_size() == 0)
+    {
+        return;
+    }
+    array_stats_job_t job;
+    job.element_size = checked_cast<size_t>(header.element_size());
+    job.offsets = component_offsets(header);
+    job.kernels.resize(components);
+    job.nodata.resize(components);
+    job.have_nodata.resize(components);
+    for (size_t c = 0; c < components; c++)
+    {
+        bool have_nodata;
+        job.kernels[c] = component_stats_plan(header, c, job.nodata[c], have_nodata);
+        job.have_nodata[c] = have_nodata;
+    }
+    const size_t batch_size = threads * blocks_per_job * block_size;
+    job.block_stats.resize(threads * blocks_per_job * components);
+    blob batch(job.element_size, checked_cast<size_t>(std::min(header.elements(), static_cast<uintmax_t>(batch_size))));
+    gta::io_state state;
+    for (uintmax_t e = 0; e < header.elements(); e += batch_size)
+    {
+        job.n = checked_cast<size_t>(std::min(header.elements() - e, static_cast<uintmax_t>(batch_size)));
+        try
+        {
+            header.read_elements(state, f, job.n, batch.ptr());
+        }
+        catch (std::exception &ex)
+        {
+            throw exc(name + ": " + ex.what());
+        }
+        job.elements = batch.ptr<const unsigned char>();
+        size_t blocks = (job.n - 1) / block_size + 1;
+        run_blocks(job, blocks, threads);
+        for (size_t b = 0; b < blocks; b++)
+        {
+            for (size_t c = 0; c < components; c++)
+            {
+                _stats[c].add(job.block_stats[b * components + c]);
+            }
+        }
+    }
+}
+
+double array_stats_t::min(uintmax_t c) const
+{
+    return (c < _stats.size() && _stats[c].n > 0 ? _stats[c].min : std::numeric_limits<double>::quiet_NaN());
+}
+
+double array_stats_t::max(uintmax_t c) const
+{
+    return (c < _stats.size() && _stats[c].n > 0 ? _stats[c].max : std::numeric_limits<double>::quiet_NaN());
+}
+
+double array_stats_t::mean(uintmax_t c) const
+{
+    return (c < _stats.size() && _stats[c].n > 0 ? _stats[c].mean() : std::numeric_limits<double>::quiet_NaN());
+}
+
+double array_stats_t::stddev(uintmax_t c) const
+{
+    return (c < _stats.size() && _stats[c].n > 1 ? std::sqrt(_stats[c].m2 / (_stats[c].n - 1))
+            : std::numeric_limits<double>::quiet_NaN());
+}
+
+
+/*
+ * Predicates
+ */
+
+enum
+{
+    op_const,
+    op_or, op_and, op_not,
+    op_eq, op_ne, op_lt, op_le, op_gt, op_ge,
+    op_add, op_sub, op_mul, op_div, op_mod, op_neg,
+    op_dimensions, op_components, op_elements, op_element_size, op_data_size, op_index,
+    op_dim, op_type, op_tag, op_has_tag, op_dim_tag, op_comp_tag,
+    op_min, op_max, op_mean, op_stddev
+};
+
+static const struct
+{
+    const char *name;
+    int op;
+    int args;           // -1 for variables without parentheses
+    bool needs_data;
+} symbols[] =
+{
+    { "dimensions",   op_dimensions,   -1, false },
+    { "components",   op_components,   -1, false },
+    { "elements",     op_elements,     -1, false },
+    { "element_size", op_element_size, -1, false },
+    { "data_size",    op_data_size,    -1, false },
+    { "index",        op_index,        -1, false },
+    { "dim",          op_dim,           1, false },
+    { "type",         op_type,          1, false },
+    { "tag",          op_tag,           1, false },
+    { "has_tag",      op_has_tag,       1, false },
+    { "dim_tag",      op_dim_tag,       2, false },
+    { "comp_tag",     op_comp_tag,      2, false },
+    { "min",          op_min,           1, true },
+    { "max",          op_max,           1, true },
+    { "mean",         op_mean,          1, true },
+    { "stddev",       op_stddev,        1, true },
+};
+
+static predicate_t::value_t num_value(double x)
+{
+    predicate_t::value_t v;
+    v.is_string = false;
+    v.num = x;
+    return v;
+}
+
+static predicate_t::value_t str_value(const char *s)
+{
+    predicate_t::value_t v;
+    v.is_string = true;
+    v.num = 0.0;
+    v.str = (s ? s : "");
+    return v;
+}
+
+// Convert a string to a number, or return false if it is not a number.
+static bool str_to_num(const std::string &s, double *x)
+{
+    const char *p = s.c_str();
+    char *end;
+    errno = 0;
+    *x = std::strtod(p, &end);
+    while (*end == ' ' || *end == '\t')
+    {
+        end++;
+    }
+    return (end != p && *end == '\0');
+}
+
+static double to_num(const predicate_t::value_t &v)
+{
+    double x;
+    if (!v.is_string)
+    {
+        return v.num;
+    }
+    return str_to_num(v.str, &x) ? x : std::numeric_limits<double>::quiet_NaN();
+}
+
+static bool to_bool(const predicate_t::value_t &v)
+{
+    return v.is_string ? !v.str.empty() : (v.num != 0.0 && !std::isnan(v.num));
+}
+
+// Compare two values: numerically if both are numbers or numeric strings,
+// otherwise as strings. Return false if the values are not comparable (NaN).
+static bool compare(int op, const predicate_t::value_t &a, const predicate_t::value_t &b)
+{
+    double x, y;
+    bool numeric = (a.is_string ? str_to_num(a.str, &x) : (x = a.num, true))
+        && (b.is_string ? str_to_num(b.str, &y) : (y = b.num, true));
+    int cmp;
+    if (numeric)
+    {
+        if (std::isnan(x) || std::isnan(y))
+        {
+            return (op == op_ne);
+        }
+        cmp = (x < y ? -1 : x > y ? +1 : 0);
+    }
+    else
+    {
+        std::string s = (a.is_string ? a.str : str::from(a.num));
+        std::string t = (b.is_string ? b.str : str::from(b.num));
+        cmp = s.compare(t);
+    }
+    switch (op)
+    {
+    case op_eq:
+        return cmp == 0;
+    case op_ne:
+        return cmp != 0;
+    case op_lt:
+        return cmp < 0;
+    case op_le:
+        return cmp <= 0;
+    case op_gt:
+        return cmp > 0;
+    default:
+        return cmp >= 0;
+    }
+}
+
+// Convert a value to an index (dimension or component), or return false.
+static bool to_index(const predicate_t::value_t &v, uintmax_t *i)
+{
+    double x = to_num(v);
+    if (!(x >= 0.0 && x < 18446744073709551616.0) || x != std::floor(x))
+    {
+        return false;
+    }
+    *i = x;
+    return true;
+}
+
+class predicate_parser
+{
+private:
+    const std::string &_s;
+    size_t _pos;
+    std::vector<predicate_t::node_t> &_nodes;
+    bool &_needs_data;
+
+    void error(const std::string &what)
+    {
+        throw exc("invalid expression: " + what + " at position " + str::from(_pos + 1));
+    }
+
+    void skip_space()
+    {
+        while (_pos < _s.length() && std::isspace(static_cast<unsigned char>(_s[_pos])))
+        {
+            _pos++;
+        }
+    }
+
+    bool accept(const char *token)
+    {
+        skip_space();
+        size_t l = std::strlen(token);
+        if (_s.compare(_pos, l, token) == 0)
+        {
+            _pos += l;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(const char *token)
+    {
+        if (!accept(token))
+        {
+            error(std::string("expected '") + token + "'");
+        }
+    }
+
+    size_t add(int op, size_t arg0 = 0, size_t arg1 = 0, int args = 0)
+    {
+        predicate_t::node_t node;
+        node.op = op;
+        if (args > 0)
+        {
+            node.args.push_back(arg0);
+        }
+        if (args > 1)
+        {
+            node.args.push_back(arg1);
+        }
+        node.value = num_value(0.0);
+        _nodes.push_back(node);
+        return _nodes.size() - 1;
+    }
+
+    size_t parse_or()
+    {
+        size_t a = parse_and();
+        while (accept("||"))
+        {
+            size_t b = parse_and();
+            a = add(op_or, a, b, 2);
+        }
+        return a;
+    }
+
+    size_t parse_and()
+    {
+        size_t a = parse_not();
+        while (accept("&&"))
+        {
+            size_t b = parse_not();
+            a = add(op_and, a, b, 2);
+        }
+        return a;
+    }
+
+    size_t parse_not()
+    {
+        skip_space();
+        if (_s.compare(_pos, 1, "!") == 0 && _s.compare(_pos, 2, "!=") != 0)
+        {
+            _pos++;
+            return add(op_not, parse_not(), 0, 1);
+        }
+        return parse_cmp();
+    }
+
+    size_t parse_cmp()
+    {
+        size_t a = parse_sum();
+        static const struct { const char *token; int op; } ops[] =
+        {
+            { "==", op_eq }, { "!=", op_ne }, { "<=", op_le }, { ">=", op_ge }, { "<", op_lt }, { ">", op_gt }
+        };
+        for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+        {
+            if (accept(ops[i].token))
+            {
+                size_t b = parse_sum();
+                return add(ops[i].op, a, b, 2);
+            }
+        }
+        return a;
+    }
+
+    size_t parse_sum()
+    {
+        size_t a = parse_product();
+        for (;;)
+        {
+            if (accept("+"))
+            {
+                size_t b = parse_product();
+                a = add(op_add, a, b, 2);
+            }
+            else if (accept("-"))
+            {
+                size_t b = parse_product();
+                a = add(op_sub, a, b, 2);
+            }
+            else
+            {
+                return a;
+            }
+        }
+    }
+
+    size_t parse_product()
+    {
+        size_t a = parse_unary();
+        for (;;)
+        {
+            if (accept("*"))
+            {
+                size_t b = parse_unary();
+                a = add(op_mul, a, b, 2);
+            }
+            else if (accept("/"))
+            {
+                size_t b = parse_unary();
+                a = add(op_div, a, b, 2);
+            }
+            else if (accept("%"))
+            {
+                size_t b = parse_unary();
+                a = add(op_mod, a, b, 2);
+            }
+            else
+            {
+                return a;
+            }
+        }
+    }
+
+    size_t parse_unary()
+    {
+        if (accept("-"))
+        {
+            return add(op_neg, parse_unary(), 0, 1);
+        }
+        return parse_primary();
+    }
+
+    size_t parse_primary()
+    {
+        skip_space();
+        if (_pos >= _s.length())
+        {
+            error("unexpected end");
+        }
+        char c = _s[_pos];
+        if (c == '(')
+        {
+            _pos++;
+            size_t a = parse_or();
+            expect(")");
+            return a;
+        }
+        else if (c == '"' || c == '\'')
+        {
+            std::string str;
+            _pos++;
+            while (_pos < _s.length() && _s[_pos] != c)
+            {
+                if (_s[_pos] == '\\' && _pos + 1 < _s.length())
+                {
+                    _pos++;
+                }
+                str.push_back(_s[_pos++]);
+            }
+            if (_pos >= _s.length())
+            {
+                error("unterminated string");
+            }
+            _pos++;
+            size_t a = add(op_const);
+            _nodes[a].value = str_value(str.c_str());
+            return a;
+        }
+        else if (std::isdigit(static_cast<unsigned char>(c)) || c == '.')
+        {
+            const char *p = _s.c_str() + _pos;
+            char *end;
+            double x = std::strtod(p, &end);
+            if (end == p)
+            {
+                error("invalid number");
+            }
+            _pos += end - p;
+            size_t a = add(op_const);
+            _nodes[a].value = num_value(x);
+            return a;
+        }
+        else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_')
+        {
+            size_t start = _pos;
+            while (_pos < _s.length() && (std::isalnum(static_cast<unsigned char>(_s[_pos])) || _s[_pos] == '_'))
+            {
+                _pos++;
+            }
+            std::string name = _s.substr(start, _pos - start);
+            for (size_t i = 0; i < sizeof(symbols) / sizeof(symbols[0]); i++)
+            {
+                if (name == symbols[i].name)
+                {
+                    if (symbols[i].needs_data)
+                    {
+                        _needs_data = true;
+                    }
+                    if (symbols[i].args < 0)
+                    {
+                        return add(symbols[i].op);
+                    }
+                    expect("(");
+                    size_t a0 = parse_or();
+                    size_t a1 = 0;
+                    if (symbols[i].args > 1)
+                    {
+                        expect(",");
+                        a1 = parse_or();
+                    }
+                    expect(")");
+                    return add(symbols[i].op, a0, a1, symbols[i].args);
+                }
+            }
+            _pos = start;
+            error("unknown name '" + name + "'");
+        }
+        error("unexpected character");
+        return 0;
+    }
+
+public:
+    predicate_parser(const std::string &s, std::vector<predicate_t::node_t> &nodes, bool &needs_data) :
+        _s(s), _pos(0), _nodes(nodes), _needs_data(needs_data)
+    {
+    }
+
+    size_t parse()
+    {
+        size_t root = parse_or();
+        skip_space();
+        if (_pos < _s.length())
+        {
+            error("unexpected input");
+        }
+        return root;
+    }
+};
+
+predicate_t::predicate_t() : _nodes(), _root(0), _needs_data(false)
+{
+}
+
+void predicate_t::parse(const std::string &expression)
+{
+    _nodes.clear();
+    _needs_data = false;
+    predicate_parser parser(expression, _nodes, _needs_data);
+    _root = parser.parse();
+}
+
+static const char *get_tag(const gta::taglist &tl, const predicate_t::value_t &name)
+{
+    std::string n = (name.is_string ? name.str : str::from(name.num));
+    return tl.get(n.c_str());
+}
+
+predicate_t::value_t predicate_t::eval(size_t node, const gta::header &header, uintmax_t index,
+        const array_stats_t *stats) const
+{
+    const node_t &n = _nodes[node];
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    uintmax_t i;
+    switch (n.op)
+    {
+    case op_const:
+        return n.value;
+    case op_or:
+        return num_value(to_bool(eval(n.args[0], header, index, stats))
+                || to_bool(eval(n.args[1], header, index, stats)));
+    case op_and:
+        return num_value(to_bool(eval(n.args[0], header, index, stats))
+                && to_bool(eval(n.args[1], header, index, stats)));
+    case op_not:
+        return num_value(!to_bool(eval(n.args[0], header, index, stats)));
+    case op_eq:
+    case op_ne:
+    case op_lt:
+    case op_le:
+    case op_gt:
+    case op_ge:
+        return num_value(compare(n.op, eval(n.args[0], header, index, stats),
+                    eval(n.args[1], header, index, stats)));
+    case op_add:
+    case op_sub:
+    case op_mul:
+    case op_div:
+    case op_mod:
+        {
+            double x = to_num(eval(n.args[0], header, index, stats));
+            double y = to_num(eval(n.args[1], header, index, stats));
+            return num_value(n.op == op_add ? x + y
+                    : n.op == op_sub ? x - y
+                    : n.op == op_mul ? x * y
+                    : n.op == op_div ? x / y
+                    : std::fmod(x, y));
+        }
+    case op_neg:
+        return num_value(-to_num(eval(n.args[0], header, index, stats)));
+    case op_dimensions:
+        return num_value(header.dimensions());
+    case op_components:
+        return num_value(header.components());
+    case op_elements:
+        return num_value(header.elements());
+    case op_element_size:
+        return num_value(header.element_size());
+    case op_data_size:
+        return num_value(header.data_size());
+    case op_index:
+        return num_value(index);
+    case op_dim:
+        return num_value(to_index(eval(n.args[0], header, index, stats), &i) && i < header.dimensions()
+                ? header.dimension_size(i) : nan);
+    case op_type:
+        return str_value(to_index(eval(n.args[0], header, index, stats), &i) && i < header.components()
+                ? type_to_string(header.component_type(i), header.component_size(i)).c_str() : NULL);
+    case op_tag:
+        return str_value(get_tag(header.global_taglist(), eval(n.args[0], header, index, stats)));
+    case op_has_tag:
+        return num_value(get_tag(header.global_taglist(), eval(n.args[0], header, index, stats)) != NULL);
+    case op_dim_tag:
+        return str_value(to_index(eval(n.args[0], header, index, stats), &i) && i < header.dimensions()
+                ? get_tag(header.dimension_taglist(i), eval(n.args[1], header, index, stats)) : NULL);
+    case op_comp_tag:
+        return str_value(to_index(eval(n.args[0], header, index, stats), &i) && i < header.components()
+                ? get_tag(header.component_taglist(i), eval(n.args[1], header, index, stats)) : NULL);
+    case op_min:
+    case op_max:
+    case op_mean:
+    case op_stddev:
+        if (!stats || !to_index(eval(n.args[0], header, index, stats), &i))
+        {
+            return num_value(nan);
+        }
+        return num_value(n.op == op_min ? stats->min(i)
+                : n.op == op_max ? stats->max(i)
+                : n.op == op_mean ? stats->mean(i)
+                : stats->stddev(i));
+    }
+    return num_value(nan);
+}
+
+bool predicate_t::evaluate(const gta::header &header, uintmax_t index, const array_stats_t *stats) const
+{
+    return to_bool(eval(_root, header, index, stats));
+}
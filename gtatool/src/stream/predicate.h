@@ -0,0 +1,105 @@
+/*
+ * This file is part of gtatool, a tool to manipulate Generic Tagged Arrays
+ * (GTAs).
+ *
+ * Copyright (C) 2014
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PREDICATE_H
+#define PREDICATE_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+
+#include <gta/gta.hpp>
+
+#include "lib.h"
+
+/* Per-component statistics of the data of one array, as used by predicates.
+ * They are computed with the same kernels as those of info --statistics and
+ * agree with them: values that are not finite or equal to the NO_DATA_VALUE
+ * tag of a component are ignored, complex components use their real part,
+ * and the deviation is the sample standard deviation. Statistics that are
+ * not available are NaN. */
+class array_stats_t
+{
+private:
+    std::vector<component_stats_t> _stats;
+
+public:
+    array_stats_t();
+
+    /* Compute the statistics of the data that follows the header in f, with
+     * the given number of threads. The data is read completely. */
+    void compute(const gta::header &header, FILE *f, const std::string &name, int threads);
+
+    double min(uintmax_t c) const;
+    double max(uintmax_t c) const;
+    double mean(uintmax_t c) const;
+    double stddev(uintmax_t c) const;
+};
+
+/* A predicate over the header of an array, its tags, its index in the
+ * stream, and optionally its data statistics. It is parsed from a C-like
+ * expression, e.g.
+ *   dim(0) == 1920 && tag("X-SENSOR") == 3
+ *   components == 3 && mean(0) > 10
+ * See stream-grep --help for the full language. */
+class predicate_t
+{
+public:
+    struct value_t
+    {
+        bool is_string;
+        double num;
+        std::string str;
+    };
+
+    struct node_t
+    {
+        int op;
+        std::vector<size_t> args;
+        value_t value;
+    };
+
+private:
+    std::vector<node_t> _nodes;
+    size_t _root;
+    bool _needs_data;
+
+    value_t eval(size_t node, const gta::header &header, uintmax_t index,
+            const array_stats_t *stats) const;
+
+public:
+    predicate_t();
+
+    /* Parse the expression. Throws an exception on syntax errors. */
+    void parse(const std::string &expression);
+
+    /* Whether the predicate needs the data statistics of an array */
+    bool needs_data() const
+    {
+        return _needs_data;
+    }
+
+    /* Evaluate the predicate for an array. The statistics are only used if
+     * needs_data() is true. */
+    bool evaluate(const gta::header &header, uintmax_t index, const array_stats_t *stats) const;
+};
+
+#endif
@@ -201,8 +201,13 @@ extern "C" int gtatool_stream_extract(int argc, char *argv[])
         uintmax_t array_index = 0;
         size_t rangelist_index = 0;
         uintmax_t dropcounter = 0;
+        /* Without --drop, nothing after the end of the last range is needed.
+         * Stop reading there instead of skipping the rest of the input; this
+         * also lets a producer on the other side of a pipe stop early. */
+        const uintmax_t last_index = rangelist.back().b;
         array_loop.start(arguments, "");
-        while (array_loop.read(hdri, namei))
+        while ((drop.value() || array_index <= last_index)
+                && array_loop.read(hdri, namei))
         {
             bool keep = in_range(rangelist, &rangelist_index, array_index);
             if (drop.value())
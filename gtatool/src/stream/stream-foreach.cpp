@@ -23,7 +23,9 @@
 
 #include <cstdio>
 #include <cerrno>
+#include <cstring>
 #include <limits>
+#include <deque>
 #include <unistd.h>
 #ifdef HAVE_SIGACTION
 # include <signal.h>
@@ -38,6 +40,7 @@
 #include <gta/gta.hpp>
 
 #include "base/msg.h"
+#include "base/blb.h"
 #include "base/opt.h"
 #include "base/str.h"
 #include "base/fio.h"
@@ -48,7 +51,7 @@
 extern "C" void gtatool_stream_foreach_help(void)
 {
     msg::req_txt(
-            "stream-foreach [-n|--n=<N>] command [<files...>]\n"
+            "stream-foreach [-n|--n=<N>] [-j|--jobs=<J>] command [<files...>]\n"
             "\n"
             "Executes the given command for each block of N input GTAs.\n"
             "The command must read N GTAs from its standard input, and must "
@@ -56,7 +59,10 @@ extern "C" void gtatool_stream_foreach_help(void)
             "The N orginal GTAs are replaced by these new GTAs in the stream.\n"
             "The default is N=1.\n"
             "The special string %%I in the command is replaced by the index of the "
-            "current block of GTAs."
+            "current block of GTAs.\n"
+            "With -j, up to J commands run concurrently. The output of each command is "
+            "collected and emitted in the order of the input blocks. "
+            "The default is J=1, i.e. one command at a time.\n"
             "Example:\n"
             "stream-foreach 'gta tag --set-global=\"X-INDEX=%%I\"' in.gta > numbered.gta");
 }
@@ -71,6 +77,169 @@ static void sigpipe_handler(int /* signum */)
 static const int sigpipe_flag = 0;
 #endif
 
+/* Check the exit status r of the command cmd, as returned by pclose() or
+ * waitpid(). */
+static void check_status(int r, const std::string &cmd, bool got_sigpipe)
+{
+    if (r == -1 || !WIFEXITED(r) || WEXITSTATUS(r) == 127)
+    {
+        throw exc(std::string("command '") + cmd + "' failed to execute");
+    }
+    else if (got_sigpipe)
+    {
+        throw exc(std::string("command '") + cmd + "' did not read its stdin");
+    }
+    else if (WEXITSTATUS(r) != 0)
+    {
+        throw exc(std::string("command '") + cmd + "' returned exit status "
+                + str::from(WEXITSTATUS(r)));
+    }
+}
+
+/* Write the current input GTA and up to n-1 following ones to the command
+ * input p. Return false if the command did not read its input. */
+static bool write_block(array_loop_t &array_loop, gta::header &hdri, std::string &namei,
+        uintmax_t n, FILE *p)
+{
+    try
+    {
+        uintmax_t i = 0;
+        for (;;)
+        {
+            gta::header hdro = hdri;
+            hdro.set_compression(gta::none);
+            hdro.write_to(p);
+            hdri.copy_data(array_loop.file_in(), hdro, p);
+            i++;
+            if (i >= n || !array_loop.read(hdri, namei))
+                break;
+        }
+        if (i < n)
+        {
+            fflush(msg::file());
+            msg::wrn(std::string("last input block only has ") + str::from(i) + " GTAs");
+            fflush(msg::file());
+        }
+    }
+    catch (gta::exception& e)
+    {
+        if (sigpipe_flag && e.result() == gta::system_error && e.sys_errno() == EPIPE)
+        {
+            // the command did not read its stdin
+            return false;
+        }
+        throw e;
+    }
+    return true;
+}
+
+#if defined HAVE_FORK && defined HAVE_SYS_WAIT_H
+/* A command that runs concurrently with others. Its output is collected in
+ * a temporary file. */
+class child_t
+{
+public:
+    std::string cmd;
+    pid_t pid;
+    FILE *out;
+    bool got_sigpipe;
+
+    child_t() : cmd(), pid(-1), out(NULL), got_sigpipe(false)
+    {
+    }
+};
+
+/* Start the command, with its standard output going to child.out. Return
+ * the stream that feeds the standard input of the command. */
+static FILE *start_child(child_t &child)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        throw exc(std::string("cannot create pipe: ") + std::strerror(errno));
+    }
+    fflush(msg::file());
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        int e = errno;
+        close(fds[0]);
+        close(fds[1]);
+        throw exc(std::string("cannot run command '") + child.cmd + "': " + std::strerror(e));
+    }
+    if (pid == 0)
+    {
+        if (dup2(fds[0], 0) < 0 || dup2(fileno(child.out), 1) < 0)
+        {
+            _exit(127);
+        }
+        close(fds[0]);
+        close(fds[1]);
+        execl("/bin/sh", "sh", "-c", child.cmd.c_str(), static_cast<char *>(NULL));
+        _exit(127);
+    }
+    child.pid = pid;
+    close(fds[0]);
+    FILE *p = fdopen(fds[1], "w");
+    if (!p)
+    {
+        int e = errno;
+        close(fds[1]);
+        throw exc(std::string("cannot run command '") + child.cmd + "': " + std::strerror(e));
+    }
+    return p;
+}
+
+/* Wait for the command to finish. If emit is true, check its exit status
+ * and append its output to gtatool_stdout. */
+static void finish_child(child_t &child, bool emit)
+{
+    int r = -1;
+    if (child.pid > 0)
+    {
+        while (waitpid(child.pid, &r, 0) < 0)
+        {
+            if (errno != EINTR)
+            {
+                r = -1;
+                break;
+            }
+        }
+        child.pid = -1;
+    }
+    FILE *out = child.out;
+    child.out = NULL;
+    if (!out)
+    {
+        return;
+    }
+    try
+    {
+        if (emit)
+        {
+            check_status(r, child.cmd, child.got_sigpipe);
+            fio::rewind(out);
+            blob buf(64 * 1024);
+            size_t k;
+            while ((k = fread(buf.ptr(), 1, buf.size(), out)) > 0)
+            {
+                fio::write(buf.ptr(), 1, k, gtatool_stdout);
+            }
+            if (ferror(out))
+            {
+                throw exc(std::string("command '") + child.cmd + "': cannot read its output");
+            }
+        }
+    }
+    catch (...)
+    {
+        fclose(out);
+        throw;
+    }
+    fclose(out);
+}
+#endif
+
 extern "C" int gtatool_stream_foreach(int argc, char *argv[])
 {
     std::vector<opt::option *> options;
@@ -78,6 +247,8 @@ extern "C" int gtatool_stream_foreach(int argc, char *argv[])
     options.push_back(&help);
     opt::val<uintmax_t> n("n", 'n', opt::optional, 1, std::numeric_limits<uintmax_t>::max(), 1);
     options.push_back(&n);
+    opt::val<int> jobs("jobs", 'j', opt::optional, 1, 1024, 1);
+    options.push_back(&jobs);
     std::vector<std::string> arguments;
     if (!opt::parse(argc, argv, options, 1, -1, arguments))
     {
@@ -121,10 +292,79 @@ extern "C" int gtatool_stream_foreach(int argc, char *argv[])
         std::string command = arguments[0];
         arguments.erase(arguments.begin());
         array_loop_t array_loop;
-        gta::header hdri, hdro;
-        std::string namei, nameo;
+        gta::header hdri;
+        std::string namei;
         uintmax_t block_index = 0;
         array_loop.start(arguments, "");
+#if defined HAVE_FORK && defined HAVE_SYS_WAIT_H
+        if (jobs.value() > 1)
+        {
+            // Run up to J commands concurrently, and emit their output in
+            // the order of the input blocks.
+            std::deque<child_t> children;
+            try
+            {
+                bool have_input = array_loop.read(hdri, namei);
+                while (have_input || !children.empty())
+                {
+                    if (!have_input || children.size() >= static_cast<size_t>(jobs.value()))
+                    {
+                        finish_child(children.front(), true);
+                        children.pop_front();
+                        continue;
+                    }
+                    children.push_back(child_t());
+                    child_t &child = children.back();
+                    child.cmd = str::replace(command, "%I", str::from(block_index));
+                    child.out = fio::tempfile();
+                    FILE *p = start_child(child);
+                    bool complete = false;
+                    try
+                    {
+                        child.got_sigpipe = !write_block(array_loop, hdri, namei, n.value(), p);
+                        complete = true;
+                    }
+                    catch (...)
+                    {
+                        (void)fclose(p);
+                        throw;
+                    }
+                    if (complete && fclose(p) != 0 && errno == EPIPE)
+                    {
+                        child.got_sigpipe = true;
+                    }
+                    if (child.got_sigpipe)
+                    {
+                        // the command will be reported when it is finished;
+                        // the input stream is no longer usable
+#ifdef HAVE_SIGACTION
+                        sigpipe_flag = 0;
+#endif
+                        have_input = false;
+                    }
+                    else
+                    {
+                        have_input = array_loop.read(hdri, namei);
+                    }
+                    block_index++;
+                }
+            }
+            catch (...)
+            {
+                for (size_t i = 0; i < children.size(); i++)
+                {
+                    finish_child(children[i], false);
+                }
+                throw;
+            }
+        }
+        else
+#else
+        if (jobs.value() > 1)
+        {
+            msg::wrn_txt("running commands concurrently is not supported on this system");
+        }
+#endif
         while (array_loop.read(hdri, namei))
         {
             // Open command
@@ -141,35 +381,9 @@ extern "C" int gtatool_stream_foreach(int argc, char *argv[])
             // Write N GTAs to command
             try
             {
-                uintmax_t i = 0;
-                for (;;)
-                {
-                    hdro = hdri;
-                    hdro.set_compression(gta::none);
-                    hdro.write_to(p);
-                    hdri.copy_data(array_loop.file_in(), hdro, p);
-                    i++;
-                    if (i >= n.value() || !array_loop.read(hdri, namei))
-                        break;
-                }
-                if (i < n.value())
-                {
-                    fflush(msg::file());
-                    msg::wrn(std::string("last input block only has ") + str::from(i) + " GTAs");
-                    fflush(msg::file());
-                }
-            }
-            catch (gta::exception& e)
-            {
-                if (sigpipe_flag && e.result() == gta::system_error && e.sys_errno() == EPIPE)
-                {
-                    // ignore: we got sigpipe and handle that below
-                }
-                else
-                {
-                    (void)pclose(p);
-                    throw e;
-                }
+                // if the command does not read its stdin, we get sigpipe
+                // and handle that below
+                (void)write_block(array_loop, hdri, namei, n.value(), p);
             }
             catch (...)
             {
@@ -180,19 +394,7 @@ extern "C" int gtatool_stream_foreach(int argc, char *argv[])
             // Close command
             int r = pclose(p);
             fflush(msg::file());
-            if (r == -1 || !WIFEXITED(r) || WEXITSTATUS(r) == 127)
-            {
-                throw exc(std::string("command '") + cmd + "' failed to execute");
-            }
-            else if (sigpipe_flag)
-            {
-                throw exc(std::string("command '") + cmd + "' did not read its stdin");
-            }
-            else if (WEXITSTATUS(r) != 0)
-            {
-                throw exc(std::string("command '") + cmd + "' returned exit status "
-                        + str::from(WEXITSTATUS(r)));
-            }
+            check_status(r, cmd, sigpipe_flag);
             block_index++;
         }
     }
@@ -23,7 +23,9 @@
 
 #include <cstdio>
 #include <cerrno>
+#include <cstring>
 #include <limits>
+#include <deque>
 #include <unistd.h>
 #ifdef HAVE_SIGACTION
 # include <signal.h>
@@ -38,17 +40,21 @@
 #include <gta/gta.hpp>
 
 #include "base/msg.h"
+#include "base/blb.h"
 #include "base/opt.h"
 #include "base/str.h"
 #include "base/fio.h"
 
 #include "lib.h"
 
+#include "stream/predicate.h"
+
 
 extern "C" void gtatool_stream_grep_help(void)
 {
     msg::req_txt(
-            "stream-grep command [<files...>]\n"
+            "stream-grep [-j|--jobs=<J>] command [<files...>]\n"
+            "stream-grep [-j|--jobs=<J>] -e|--expression=<expr> [<files...>]\n"
             "\n"
             "Executes the given command for each input GTAs, and outputs only those GTAs "
             "for which the command exits successfully.\n"
@@ -57,7 +63,27 @@ extern "C" void gtatool_stream_grep_help(void)
             "The command must read one GTA from standard input and then exit with zero "
             "(success; the GTA passes) or non-zero (failure; the GTA is removed). Any "
             "output of the command is ignored.\n"
+            "With -j, the command runs for up to J GTAs concurrently. The order of the "
+            "GTAs is preserved. The default is J=1.\n"
+            "With -e, no command is run. Instead, the given expression is evaluated for each "
+            "GTA, and only those GTAs for which it is true (non-zero or a non-empty string) "
+            "are output. Expressions use C-like operators (|| && ! == != < <= > >= + - * / %%) "
+            "on numbers and quoted strings, and the following:\n"
+            "dimensions, components, elements, element_size, data_size: properties of the GTA.\n"
+            "index: index of the GTA in the input stream, starting with 0.\n"
+            "dim(d): size of dimension d. type(c): type of component c, e.g. \"uint8\".\n"
+            "tag(\"NAME\"), has_tag(\"NAME\"), dim_tag(d, \"NAME\"), comp_tag(c, \"NAME\"): "
+            "tag values (empty if unset). Strings are compared as numbers if both sides are numbers.\n"
+            "min(c), max(c), mean(c), stddev(c): statistics of component c, as printed by "
+            "info --statistics: values that are not finite or equal to the NO_DATA_VALUE tag "
+            "of the component are ignored, complex components use their real part, and "
+            "stddev(c) is the sample deviation (with n-1 in the denominator). Statistics that "
+            "are unavailable are not-a-number, which compares false. They require "
+            "reading the data of each GTA and are computed with J threads; expressions without "
+            "them only read the headers, and skip the data of rejected GTAs.\n"
             "Examples:\n"
+            "stream-grep -e 'tag(\"X-INDEX\") == 8' all.gta > only-8.gta\n"
+            "stream-grep -e 'dim(0) == 1920 && mean(0) > 10' all.gta > bright-hd.gta\n"
             "stream-grep 'gta tag --get-global=X-INDEX 2>&1 > /dev/null | grep X-INDEX=8' all.gta > only-8.gta\n"
             "stream-grep 'gta info 2>&1 > /dev/null | grep \"dimension 0: 42\"' all.gta > only-width42.gta");
 }
@@ -72,22 +98,235 @@ static void sigpipe_handler(int /* signum */)
 static const int sigpipe_flag = 0;
 #endif
 
-extern "C" int gtatool_stream_grep(int argc, char *argv[])
+#if defined HAVE_FORK && defined HAVE_SYS_WAIT_H
+/* An input GTA for which the command runs concurrently with others. Its data
+ * is read with pread() from fd, either from the original input or from a
+ * temporary copy. */
+class candidate_t
 {
-    std::vector<opt::option *> options;
-    opt::info help("help", '\0', opt::optional);
-    options.push_back(&help);
-    std::vector<std::string> arguments;
-    if (!opt::parse(argc, argv, options, 1, -1, arguments))
+public:
+    gta::header header;
+    std::string cmd;
+    pid_t pid;
+    int fd;
+    off_t offset;
+    FILE *tmpf;
+    bool got_sigpipe;
+
+    candidate_t() : header(), cmd(), pid(-1), fd(-1), offset(0), tmpf(NULL), got_sigpipe(false)
     {
-        return 1;
     }
-    if (help.value())
+};
+
+/* Copy the data of the candidate to f. Return false if f is a pipe whose
+ * reader did not read all data. */
+static bool copy_candidate_data(const candidate_t &c, FILE *f)
+{
+    blob buf(64 * 1024);
+    uintmax_t remaining = c.header.data_size();
+    off_t offset = c.offset;
+    while (remaining > 0)
     {
-        gtatool_stream_grep_help();
-        return 0;
+        size_t k = (remaining < buf.size() ? remaining : buf.size());
+        ssize_t r = pread(c.fd, buf.ptr(), k, offset);
+        if (r <= 0)
+        {
+            throw exc(std::string("cannot read input data: ")
+                    + (r == 0 ? std::string("unexpected end of file") : std::strerror(errno)));
+        }
+        k = r;
+        errno = 0;
+        if (fwrite(buf.ptr(), 1, k, f) != k)
+        {
+            if (sigpipe_flag && errno == EPIPE)
+            {
+                return false;
+            }
+            throw exc(std::string("cannot write data: ") + std::strerror(errno ? errno : EIO));
+        }
+        remaining -= k;
+        offset += k;
+    }
+    return true;
+}
+
+/* Start the command for the candidate, with its standard output going to
+ * fd_null, and feed the candidate GTA to it. */
+static void start_candidate(candidate_t &c, int fd_null)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        throw exc(std::string("cannot create pipe: ") + std::strerror(errno));
+    }
+    fflush(msg::file());
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        int e = errno;
+        close(fds[0]);
+        close(fds[1]);
+        throw exc(std::string("cannot run command '") + c.cmd + "': " + std::strerror(e));
+    }
+    if (pid == 0)
+    {
+        if (dup2(fds[0], 0) < 0 || dup2(fd_null, 1) < 0)
+        {
+            _exit(127);
+        }
+        close(fds[0]);
+        close(fds[1]);
+        execl("/bin/sh", "sh", "-c", c.cmd.c_str(), static_cast<char *>(NULL));
+        _exit(127);
+    }
+    c.pid = pid;
+    close(fds[0]);
+    FILE *p = fdopen(fds[1], "w");
+    if (!p)
+    {
+        int e = errno;
+        close(fds[1]);
+        throw exc(std::string("cannot run command '") + c.cmd + "': " + std::strerror(e));
+    }
+    try
+    {
+        c.header.write_to(p);
+        c.got_sigpipe = !copy_candidate_data(c, p);
+    }
+    catch (gta::exception& e)
+    {
+        if (sigpipe_flag && e.result() == gta::system_error && e.sys_errno() == EPIPE)
+        {
+            c.got_sigpipe = true;
+        }
+        else
+        {
+            (void)fclose(p);
+            throw e;
+        }
+    }
+    catch (...)
+    {
+        (void)fclose(p);
+        throw;
+    }
+    if (fclose(p) != 0 && errno == EPIPE)
+    {
+        c.got_sigpipe = true;
+    }
+}
+
+/* Wait for the command of the candidate to finish, and return its exit
+ * status. */
+static int wait_candidate(candidate_t &c)
+{
+    int r = -1;
+    if (c.pid > 0)
+    {
+        while (waitpid(c.pid, &r, 0) < 0)
+        {
+            if (errno != EINTR)
+            {
+                r = -1;
+                break;
+            }
+        }
+        c.pid = -1;
     }
+    return r;
+}
 
+static void release_candidate(candidate_t &c)
+{
+    if (c.tmpf)
+    {
+        fclose(c.tmpf);
+        c.tmpf = NULL;
+    }
+    else if (c.fd >= 0)
+    {
+        close(c.fd);
+    }
+    c.fd = -1;
+}
+#endif
+
+static int grep_expression(const std::vector<std::string> &arguments, const std::string &expression, int jobs)
+{
+    try
+    {
+        predicate_t predicate;
+        predicate.parse(expression);
+        array_stats_t stats;
+        array_loop_t array_loop;
+        gta::header hdri, hdro;
+        std::string namei, nameo;
+        uintmax_t index = 0;
+        array_loop.start(arguments, "");
+        while (array_loop.read(hdri, namei))
+        {
+            hdro = hdri;
+            hdro.set_compression(gta::none);
+            if (!predicate.needs_data())
+            {
+                if (predicate.evaluate(hdri, index, NULL))
+                {
+                    array_loop.write(hdro, nameo);
+                    array_loop.copy_data(hdri, hdro);
+                }
+                else
+                {
+                    array_loop.skip_data(hdri);
+                }
+            }
+            else if (fio::seekable(array_loop.file_in()) && hdri.compression() == gta::none)
+            {
+                // Compute the statistics, and read the data again if the GTA passes
+                uintmax_t data_offset = fio::tell(array_loop.file_in(), array_loop.filename_in());
+                stats.compute(hdri, array_loop.file_in(), namei, jobs);
+                if (predicate.evaluate(hdri, index, &stats))
+                {
+                    array_loop.write(hdro, nameo);
+                    fio::seek(array_loop.file_in(), data_offset, SEEK_SET, array_loop.filename_in());
+                    array_loop.copy_data(hdri, hdro);
+                }
+            }
+            else
+            {
+                FILE *tmpf = fio::tempfile();
+                try
+                {
+                    hdri.copy_data(array_loop.file_in(), hdro, tmpf);
+                    fio::rewind(tmpf);
+                    stats.compute(hdro, tmpf, namei, jobs);
+                    if (predicate.evaluate(hdri, index, &stats))
+                    {
+                        array_loop.write(hdro, nameo);
+                        fio::rewind(tmpf);
+                        hdro.copy_data(tmpf, hdro, array_loop.file_out());
+                    }
+                }
+                catch (...)
+                {
+                    fclose(tmpf);
+                    throw;
+                }
+                fio::close(tmpf);
+            }
+            index++;
+        }
+        array_loop.finish();
+    }
+    catch (std::exception &e)
+    {
+        msg::err_txt("%s", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+static int grep_command(std::vector<std::string> arguments, int jobs)
+{
 #ifdef HAVE_SIGACTION
     struct sigaction new_sigpipe_handler, old_sigpipe_handler;
     new_sigpipe_handler.sa_handler = sigpipe_handler;
@@ -112,6 +351,98 @@ extern "C" int gtatool_stream_grep(int argc, char *argv[])
         gta::header hdri, hdro;
         std::string namei, nameo;
         array_loop.start(arguments, "");
+#if defined HAVE_FORK && defined HAVE_SYS_WAIT_H
+        if (jobs > 1)
+        {
+            // Run the command for up to J GTAs concurrently, and write the
+            // GTAs that pass in input order.
+            std::deque<candidate_t> candidates;
+            try
+            {
+                bool have_input = array_loop.read(hdri, namei);
+                while (have_input || !candidates.empty())
+                {
+                    if (!have_input || candidates.size() >= static_cast<size_t>(jobs))
+                    {
+                        candidate_t &c = candidates.front();
+                        int r = wait_candidate(c);
+                        fflush(msg::file());
+                        if (r == -1 || !WIFEXITED(r) || WEXITSTATUS(r) == 127)
+                        {
+                            throw exc(std::string("command '") + c.cmd + "' failed to execute");
+                        }
+                        else if (c.got_sigpipe)
+                        {
+                            throw exc(std::string("command '") + c.cmd + "' did not read its stdin");
+                        }
+                        else if (WEXITSTATUS(r) == 0)
+                        {
+                            array_loop.write(c.header, nameo);
+                            if (!copy_candidate_data(c, array_loop.file_out()))
+                            {
+                                throw exc(std::string("cannot write data: ") + std::strerror(EPIPE));
+                            }
+                        }
+                        release_candidate(c);
+                        candidates.pop_front();
+                        continue;
+                    }
+                    candidates.push_back(candidate_t());
+                    candidate_t &c = candidates.back();
+                    c.cmd = command;
+                    c.header = hdri;
+                    c.header.set_compression(gta::none);
+                    if (fio::seekable(array_loop.file_in()) && hdri.compression() == gta::none)
+                    {
+                        // Read the data again from its original location later
+                        c.offset = fio::tell(array_loop.file_in(), array_loop.filename_in());
+                        c.fd = dup(fileno(array_loop.file_in()));
+                        if (c.fd < 0)
+                        {
+                            throw exc(array_loop.filename_in() + ": " + std::strerror(errno));
+                        }
+                        array_loop.skip_data(hdri);
+                    }
+                    else
+                    {
+                        c.tmpf = fio::tempfile();
+                        hdri.copy_data(array_loop.file_in(), c.header, c.tmpf);
+                        fio::flush(c.tmpf);
+                        c.fd = fileno(c.tmpf);
+                    }
+                    start_candidate(c, fileno(fdevnull));
+                    if (c.got_sigpipe)
+                    {
+                        // the command will be reported when it is finished;
+                        // the input stream is no longer usable
+#ifdef HAVE_SIGACTION
+                        sigpipe_flag = 0;
+#endif
+                        have_input = false;
+                    }
+                    else
+                    {
+                        have_input = array_loop.read(hdri, namei);
+                    }
+                }
+            }
+            catch (...)
+            {
+                for (size_t i = 0; i < candidates.size(); i++)
+                {
+                    (void)wait_candidate(candidates[i]);
+                    release_candidate(candidates[i]);
+                }
+                throw;
+            }
+        }
+        else
+#else
+        if (jobs > 1)
+        {
+            msg::wrn_txt("running commands concurrently is not supported on this system");
+        }
+#endif
         while (array_loop.read(hdri, namei))
         {
             // Make sure the output of the child process is ignored.
@@ -131,17 +462,27 @@ extern "C" int gtatool_stream_grep(int argc, char *argv[])
                     errno = ENOMEM;
                 throw exc(std::string("cannot run command '") + cmd + "': " + std::strerror(errno));
             }
-            // Buffer GTA data to temp file
+            // For seekable input, the data is read again from its original
+            // location if the GTA passes. Otherwise, buffer it in a temp file.
             hdro = hdri;
             hdro.set_compression(gta::none);
-            tmpf = fio::tempfile();
-            hdri.copy_data(array_loop.file_in(), hdro, tmpf);
-            fio::rewind(tmpf);
+            bool reread = fio::seekable(array_loop.file_in()) && hdri.compression() == gta::none;
+            uintmax_t data_offset = 0;
+            if (reread)
+            {
+                data_offset = fio::tell(array_loop.file_in(), array_loop.filename_in());
+            }
+            else
+            {
+                tmpf = fio::tempfile();
+                hdri.copy_data(array_loop.file_in(), hdro, tmpf);
+                fio::rewind(tmpf);
+            }
             // Write 1 GTA to command
             try
             {
                 hdro.write_to(p);
-                hdro.copy_data(tmpf, hdro, p);
+                hdro.copy_data(reread ? array_loop.file_in() : tmpf, hdro, p);
             }
             catch (gta::exception& e)
             {
@@ -185,11 +526,22 @@ extern "C" int gtatool_stream_grep(int argc, char *argv[])
             if (keep_gta)
             {
                 array_loop.write(hdro, nameo);
-                fio::rewind(tmpf);
-                hdro.copy_data(tmpf, hdro, array_loop.file_out());
+                if (reread)
+                {
+                    fio::seek(array_loop.file_in(), data_offset, SEEK_SET, array_loop.filename_in());
+                    array_loop.copy_data(hdri, hdro);
+                }
+                else
+                {
+                    fio::rewind(tmpf);
+                    hdro.copy_data(tmpf, hdro, array_loop.file_out());
+                }
+            }
+            if (tmpf)
+            {
+                fio::close(tmpf);
+                tmpf = NULL;
             }
-            fio::close(tmpf);
-            tmpf = NULL;
         }
     }
     catch (std::exception &e)
@@ -209,3 +561,37 @@ extern "C" int gtatool_stream_grep(int argc, char *argv[])
 
     return retval;
 }
+
+extern "C" int gtatool_stream_grep(int argc, char *argv[])
+{
+    std::vector<opt::option *> options;
+    opt::info help("help", '\0', opt::optional);
+    options.push_back(&help);
+    opt::val<int> jobs("jobs", 'j', opt::optional, 1, 1024, 1);
+    options.push_back(&jobs);
+    opt::string expression("expression", 'e', opt::optional);
+    options.push_back(&expression);
+    std::vector<std::string> arguments;
+    if (!opt::parse(argc, argv, options, 0, -1, arguments))
+    {
+        return 1;
+    }
+    if (help.value())
+    {
+        gtatool_stream_grep_help();
+        return 0;
+    }
+    if (expression.values().empty())
+    {
+        if (arguments.empty())
+        {
+            msg::err_txt("no command given");
+            return 1;
+        }
+        return grep_command(arguments, jobs.value());
+    }
+    else
+    {
+        return grep_expression(arguments, expression.value(), jobs.value());
+    }
+}
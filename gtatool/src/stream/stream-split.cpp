@@ -22,14 +22,25 @@
 #include "config.h"
 
 #include <sstream>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 #include <cstdio>
 #include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
 
 #include <gta/gta.hpp>
 
 #include "base/msg.h"
 #include "base/opt.h"
 #include "base/str.h"
+#include "base/fio.h"
 
 #include "lib.h"
 
@@ -37,22 +48,267 @@
 extern "C" void gtatool_stream_split_help(void)
 {
     msg::req_txt(
-            "stream-split [<template>] [<files...>]\n"
+            "stream-split [-j|--jobs=<J>] [<template>] [<files...>]\n"
             "\n"
             "Writes the input arrays into separate files, using a file name template.\n"
             "The template must contain the sequence %%[n]N, which will be replaced by the "
             "index of the array in the input stream. The optional parameter n gives the minimum "
             "number of digits in the index number; small indices will be padded with zeroes. "
             "The default template is %%9N.gta.\n"
+            "With -j, up to J output files are written concurrently. This hides the latency of "
+            "creating and closing files, e.g. on parallel file systems. If the input is not an "
+            "uncompressed regular file, the data of arrays waiting to be written is kept in memory, "
+            "up to a fixed limit. The default is J=1.\n"
+            "If an error occurs, no further output files are written, and an incomplete output "
+            "file is removed.\n"
             "Example:\n"
             "stream-split array-%%3N.gta 129-arrays.gta");
 }
 
+/* One output file. Its data is either in the input file, starting at the
+ * given offset (if fd is set), or in the buffer. */
+class split_job_t
+{
+public:
+    std::string name;
+    gta::header header;
+    std::shared_ptr<int> fd;
+    off_t offset;
+    std::vector<unsigned char> buffer;
+
+    split_job_t() : offset(0)
+    {
+    }
+};
+
+static void close_fd(int *fd)
+{
+    (void)close(*fd);
+    delete fd;
+}
+
+/* Copy size bytes starting at offset in fd to the current position of f.
+ * The copy is done by the kernel if possible. */
+static void copy_range(int fd, off_t offset, uintmax_t size, FILE *f, const std::string &name)
+{
+    fio::flush(f, name);
+    stats_t &stats = stats_t::current();
+    double t = stats_t::now();
+    uintmax_t data_size = size;
+#ifdef HAVE_COPY_FILE_RANGE
+    while (size > 0)
+    {
+        size_t k = (size < (1U << 30) ? size : (1U << 30));
+        ssize_t r = copy_file_range(fd, &offset, fileno(f), NULL, k, 0);
+        if (r < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL
+                    || errno == EOPNOTSUPP || errno == EBADF))
+        {
+            /* not supported for these files; fall back to read/write */
+            break;
+        }
+        else if (r <= 0)
+        {
+            throw exc(name + ": cannot copy data: "
+                    + (r == 0 ? std::string("unexpected end of input file") : std::strerror(errno)));
+        }
+        size -= r;
+    }
+#endif
+    std::vector<unsigned char> buf(size < (1U << 20) ? size : (1U << 20));
+    while (size > 0)
+    {
+        size_t k = (size < buf.size() ? size : buf.size());
+        ssize_t r = pread(fd, &(buf[0]), k, offset);
+        if (r <= 0)
+        {
+            throw exc(name + ": cannot read input data: "
+                    + (r == 0 ? std::string("unexpected end of input file") : std::strerror(errno)));
+        }
+        fio::write(&(buf[0]), 1, r, f, name);
+        size -= r;
+        offset += r;
+    }
+    if (stats.enabled)
+    {
+        stats.io_time += stats_t::now() - t;
+        stats.data_bytes_in += data_size;
+        stats.data_bytes_out += data_size;
+    }
+}
+
+/* Write one output file through an array loop, so that it is accounted for
+ * in the statistics. An incomplete output file is removed. */
+static void write_split_job(const split_job_t &job)
+{
+    array_loop_t array_loop_out;
+    std::string nameo;
+    array_loop_out.start("", job.name);
+    try
+    {
+        array_loop_out.write(job.header, nameo);
+        if (job.fd)
+        {
+            copy_range(*job.fd, job.offset, job.header.data_size(), array_loop_out.file_out(), job.name);
+        }
+        else if (job.buffer.size() > 0)
+        {
+            array_loop_out.write_data(job.header, &(job.buffer[0]));
+        }
+        array_loop_out.finish();
+    }
+    catch (...)
+    {
+        (void)std::remove(job.name.c_str());
+        throw;
+    }
+}
+
+/* A pool of threads that write output files. The number of queued jobs and
+ * the amount of buffered data are bounded; push() blocks until there is
+ * room. The first error of a writer is rethrown by push() or finish(), and
+ * the jobs that are still queued then are dropped, as they are when the pool
+ * is destroyed without finish(). Each thread collects its own statistics,
+ * which finish() adds to the statistics of the main thread. */
+class split_writers_t
+{
+private:
+    std::vector<std::thread> _threads;
+    std::vector<stats_t> _thread_stats;
+    std::mutex _mutex;
+    std::condition_variable _work_cond;         // signalled when there is work
+    std::condition_variable _room_cond;         // signalled when a job is done
+    std::deque<split_job_t> _queue;
+    size_t _max_jobs;
+    size_t _max_buffered;
+    size_t _buffered;
+    bool _done;
+    bool _abort;
+    std::exception_ptr _exception;
+
+    void run(stats_t *stats)
+    {
+        stats_redirect_t stats_redirect(*stats);
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (;;)
+        {
+            while (_queue.empty() && !_done && !_abort && !_exception)
+            {
+                _work_cond.wait(lock);
+            }
+            if (_queue.empty() || _abort || _exception)
+            {
+                break;
+            }
+            split_job_t job;
+            std::swap(job, _queue.front());
+            _queue.pop_front();
+            lock.unlock();
+            std::exception_ptr e;
+            try
+            {
+                write_split_job(job);
+            }
+            catch (...)
+            {
+                e = std::current_exception();
+            }
+            lock.lock();
+            _buffered -= job.buffer.size();
+            if (e && !_exception)
+            {
+                _exception = e;
+                _work_cond.notify_all();
+            }
+            _room_cond.notify_one();
+        }
+    }
+
+    void stop(bool abort)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done = true;
+            _abort = abort;
+            _work_cond.notify_all();
+        }
+        for (size_t i = 0; i < _threads.size(); i++)
+        {
+            _threads[i].join();
+        }
+        _threads.clear();
+        _queue.clear();
+    }
+
+public:
+    split_writers_t() : _max_jobs(0), _max_buffered(0), _buffered(0), _done(false), _abort(false)
+    {
+    }
+
+    ~split_writers_t()
+    {
+        stop(true);
+    }
+
+    void start(size_t threads, size_t max_buffered)
+    {
+        _max_jobs = 4 * threads;
+        _max_buffered = max_buffered;
+        _thread_stats.resize(threads);
+        for (size_t i = 0; i < threads; i++)
+        {
+            _thread_stats[i].enabled = stats_t::current().enabled;
+            _threads.push_back(std::thread(&split_writers_t::run, this, &(_thread_stats[i])));
+        }
+    }
+
+    /* Whether a job with this amount of buffered data can be queued at all */
+    bool fits(uintmax_t buffer_size) const
+    {
+        return buffer_size <= _max_buffered;
+    }
+
+    /* Queue the job. Its contents are moved into the queue. */
+    void push(split_job_t &job)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (!_exception && (_queue.size() >= _max_jobs
+                    || _buffered + job.buffer.size() > _max_buffered))
+        {
+            _room_cond.wait(lock);
+        }
+        if (_exception)
+        {
+            std::rethrow_exception(_exception);
+        }
+        _buffered += job.buffer.size();
+        _queue.push_back(split_job_t());
+        std::swap(_queue.back(), job);
+        _work_cond.notify_one();
+    }
+
+    /* Wait until all queued jobs are written. */
+    void finish()
+    {
+        stop(false);
+        for (size_t i = 0; i < _thread_stats.size(); i++)
+        {
+            stats_t::current().add(_thread_stats[i]);
+        }
+        _thread_stats.clear();
+        if (_exception)
+        {
+            std::rethrow_exception(_exception);
+        }
+    }
+};
+
 extern "C" int gtatool_stream_split(int argc, char *argv[])
 {
     std::vector<opt::option *> options;
     opt::info help("help", '\0', opt::optional);
     options.push_back(&help);
+    opt::val<int> jobs("jobs", 'j', opt::optional, 1, 1024, 1);
+    options.push_back(&jobs);
     std::vector<std::string> arguments;
     if (!opt::parse(argc, argv, options, -1, -1, arguments))
     {
@@ -93,7 +349,7 @@ extern "C" int gtatool_stream_split(int argc, char *argv[])
             min_width = 0;
         }
         else
-        {        
+        {
             try
             {
                 min_width = str::to<unsigned int>(tmpl.substr(seq_start + 1, seq_length - 2));
@@ -104,11 +360,24 @@ extern "C" int gtatool_stream_split(int argc, char *argv[])
             }
         }
 
+        /* With more than one job, output files are written by a pool of
+         * threads. Data that cannot be copied from the input file later is
+         * buffered, up to this limit. Larger arrays are written directly. */
+        const size_t max_buffered = 64 << 20;
+        split_writers_t writers;
+        if (jobs.value() > 1)
+        {
+            writers.start(jobs.value(), max_buffered);
+        }
+
         array_loop_t array_loop;
         gta::header hdri, hdro;
         std::string namei, nameo;
         array_loop.start(arguments, "");
         uintmax_t array_index = 0;
+        std::shared_ptr<int> input_fd;
+        FILE *input_fd_file = NULL;
+        std::string input_fd_name;
         while (array_loop.read(hdri, namei))
         {
             std::string array_index_str = str::from(array_index);
@@ -118,15 +387,72 @@ extern "C" int gtatool_stream_split(int argc, char *argv[])
             }
             std::string foname = tmpl;
             foname.replace(seq_start, seq_length, array_index_str);
-            array_loop_t array_loop_out;
-            array_loop_out.start("", foname);
             hdro = hdri;
             hdro.set_compression(gta::none);
-            array_loop_out.write(hdro, nameo);
-            array_loop.copy_data(hdri, array_loop_out, hdro);
-            array_loop_out.finish();
+            if (hdri.compression() == gta::none && hdri.data_size() > 0
+                    && fio::seekable(array_loop.file_in()))
+            {
+                /* Copy the data directly from the input file later, and skip
+                 * it here. Keep a duplicate of the file descriptor, since the
+                 * array loop closes input files when it is done with them. */
+                if (!input_fd || input_fd_file != array_loop.file_in()
+                        || input_fd_name != array_loop.filename_in())
+                {
+                    int fd = dup(fileno(array_loop.file_in()));
+                    if (fd < 0)
+                    {
+                        throw exc(array_loop.filename_in() + ": " + std::strerror(errno));
+                    }
+                    input_fd = std::shared_ptr<int>(new int(fd), close_fd);
+                    input_fd_file = array_loop.file_in();
+                    input_fd_name = array_loop.filename_in();
+                }
+                split_job_t job;
+                job.name = foname;
+                job.header = hdro;
+                job.fd = input_fd;
+                job.offset = fio::tell(array_loop.file_in(), array_loop.filename_in());
+                array_loop.skip_data(hdri);
+                if (jobs.value() > 1)
+                {
+                    writers.push(job);
+                }
+                else
+                {
+                    write_split_job(job);
+                }
+            }
+            else if (jobs.value() > 1 && writers.fits(hdri.data_size()))
+            {
+                split_job_t job;
+                job.name = foname;
+                job.header = hdro;
+                job.buffer.resize(hdri.data_size());
+                if (job.buffer.size() > 0)
+                {
+                    array_loop.read_data(hdri, &(job.buffer[0]));
+                }
+                writers.push(job);
+            }
+            else
+            {
+                array_loop_t array_loop_out;
+                array_loop_out.start("", foname);
+                try
+                {
+                    array_loop_out.write(hdro, nameo);
+                    array_loop.copy_data(hdri, array_loop_out, hdro);
+                    array_loop_out.finish();
+                }
+                catch (...)
+                {
+                    (void)std::remove(foname.c_str());
+                    throw;
+                }
+            }
             array_index++;
         }
+        writers.finish();
         array_loop.finish();
     }
     catch (std::exception &e)
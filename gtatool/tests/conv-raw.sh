@@ -26,4 +26,29 @@ $GTA tag --unset-all < "$TMPD"/c.gta > "$TMPD"/e.gta
 cmp "$TMPD"/d.gta "$TMPD"/a.gta
 cmp "$TMPD"/e.gta "$TMPD"/a.gta
 
+# Swapped endianness, with mixed component types, skips, and pipe input
+$GTA create -d 300,200 -c uint16 -v 258 "$TMPD"/s.gta
+$GTA to-raw -e big "$TMPD"/s.gta "$TMPD"/s.raw
+test "`od -A n -t x1 -N 4 "$TMPD"/s.raw | tr -d ' '`" = "01020102"
+$GTA from-raw -d 300,200 -c uint16 -e big "$TMPD"/s.raw | $GTA tag --unset-all > "$TMPD"/s2.gta
+cmp "$TMPD"/s2.gta "$TMPD"/s.gta
+$GTA create -d 123,45 -c uint8,int16,float32,cfloat64,uint64 -v 1,-2,3,4,5,6 -n 2 "$TMPD"/m.gta
+$GTA to-raw -e big "$TMPD"/m.gta "$TMPD"/m.raw
+(printf 'abcde'; head -c 1271 "$TMPD"/m.raw; printf 'xyzde'; tail -c +1272 "$TMPD"/m.raw) > "$TMPD"/m-skip.raw
+$GTA from-raw -d 123,45 -c uint8,int16,float32,cfloat64,uint64 -e big "$TMPD"/m.raw | $GTA tag --unset-all > "$TMPD"/m2.gta
+cmp "$TMPD"/m2.gta "$TMPD"/m.gta
+cat "$TMPD"/m.raw | $GTA from-raw -d 123,45 -c uint8,int16,float32,cfloat64,uint64 -e big /dev/stdin | $GTA tag --unset-all > "$TMPD"/m3.gta
+cmp "$TMPD"/m3.gta "$TMPD"/m.gta
+$GTA to-raw -e big "$TMPD"/m4.raw < "$TMPD"/m.gta
+cmp "$TMPD"/m4.raw "$TMPD"/m.raw
+$GTA from-raw -d 41 -c uint8,int16,float32,cfloat64,uint64 -e big --stream-skip=3 --array-pre-skip=2 --array-post-skip=3 -n 2 "$TMPD"/m-skip.raw "$TMPD"/m5.gta
+$GTA from-raw -d 41 -c uint8,int16,float32,cfloat64,uint64 -e big -n 2 "$TMPD"/m.raw "$TMPD"/m6.gta
+cmp "$TMPD"/m5.gta "$TMPD"/m6.gta
+if $GTA from-raw -d 1000 -c uint16 -e big "$TMPD"/s.raw -n 1000 > /dev/null 2>&1; then false; fi
+# Mapped and piped input count the same data bytes
+$GTA --stats=json from-raw -d 300,200 -c uint16 -e big "$TMPD"/s.raw 2> "$TMPD"/s-stats.json > /dev/null
+grep -q '"data_bytes_in": 120000, "data_bytes_out": 120000,' "$TMPD"/s-stats.json
+cat "$TMPD"/s.raw | $GTA --stats=json from-raw -d 300,200 -c uint16 -e big /dev/stdin 2> "$TMPD"/s-stats.json > /dev/null
+grep -q '"data_bytes_in": 120000, "data_bytes_out": 120000,' "$TMPD"/s-stats.json
+
 rm -r "$TMPD"
@@ -0,0 +1,55 @@
+# Copyright (C) 2014
+# Martin Lambers <marlam@marlam.de>
+#
+# Copying and distribution of this file, with or without modification, are
+# permitted in any medium without royalty provided the copyright notice and this
+# notice are preserved. This file is offered as-is, without any warranty.
+
+# Helper functions that create test arrays with varying data, without
+# depending on optional commands such as component-compute. The arrays are
+# converted from raw bytes with from-raw; tests that source this file are
+# skipped if from-raw is not available.
+#
+# Source this file after setting TMPD.
+
+$GTA from-raw --help 2> /dev/null || exit 77
+
+# Write the given byte values to standard output.
+fixture_bytes()
+{
+    local b
+    for b in "$@"; do
+        printf "\\`printf %03o $b`"
+    done
+}
+
+# Write an array with the given dimensions and component types to standard
+# output. Its data consists of the given bytes, with multi-byte values in
+# little endian byte order.
+# Usage: fixture_array <d0,d1,...> <c0,c1,...> <byte>...
+fixture_array()
+{
+    local dimensions="$1" components="$2"
+    shift 2
+    fixture_bytes "$@" > "$TMPD"/fixture.raw
+    $GTA from-raw -n 1 -d "$dimensions" -c "$components" "$TMPD"/fixture.raw
+}
+
+# Write an array with the given dimensions and component types to standard
+# output. Its data bytes count up from the given start value (default 0),
+# wrapping around at 256.
+# Usage: fixture_ramp <d0,d1,...> <c0,c1,...> [<start>]
+fixture_ramp()
+{
+    local dimensions="$1" components="$2" start="${3:-0}" size i
+    size="`$GTA create -d "$dimensions" -c "$components" | $GTA info 2>&1 | sed -n 's/^.* array 0: \([0-9]*\) bytes.*$/\1/p'`"
+    for ((i = 0; i < 256; i++)); do
+        fixture_bytes $(((start + i) % 256))
+    done > "$TMPD"/fixture.raw
+    while test "`wc -c < "$TMPD"/fixture.raw`" -lt "$size"; do
+        cat "$TMPD"/fixture.raw "$TMPD"/fixture.raw > "$TMPD"/fixture2.raw
+        mv "$TMPD"/fixture2.raw "$TMPD"/fixture.raw
+    done
+    head -c "$size" "$TMPD"/fixture.raw > "$TMPD"/fixture2.raw
+    $GTA from-raw -n 1 -d "$dimensions" -c "$components" "$TMPD"/fixture2.raw
+}
@@ -66,6 +66,22 @@ cmp "$TMPD"/f8.gta "$TMPD"/n.gta
 $GTA combine -m div "$TMPD"/f8.gta "$TMPD"/f4.gta > "$TMPD"/o.gta
 cmp "$TMPD"/f2.gta "$TMPD"/o.gta
 
+# Overflow is an error by default and clamps with -f, also in large arrays
+$GTA create -d 300,300 -c uint8,int16 -v 200,-30000 "$TMPD"/p.gta
+$GTA create -d 300,300 -c uint8,int16 -v 100,-30000 "$TMPD"/q.gta
+$GTA create -d 300,300 -c uint8,int16 -v 255,-32768 "$TMPD"/pq.gta
+if $GTA combine -m add "$TMPD"/p.gta "$TMPD"/q.gta > "$TMPD"/r.gta 2>/dev/null; then false; fi
+$GTA combine -f -m add "$TMPD"/p.gta "$TMPD"/q.gta > "$TMPD"/r.gta
+cmp "$TMPD"/pq.gta "$TMPD"/r.gta
+$GTA combine -f -m add "$TMPD"/p.gta "$TMPD"/q.gta "$TMPD"/q.gta > "$TMPD"/s.gta
+cmp "$TMPD"/pq.gta "$TMPD"/s.gta
+
+# Zero times a negative number is not an overflow
+$GTA create -d 300,300 -c int16,int64 -v 0,0 "$TMPD"/z.gta
+$GTA create -d 300,300 -c int16,int64 -v -3,-3 "$TMPD"/y.gta
+$GTA combine -m mul "$TMPD"/z.gta "$TMPD"/y.gta > "$TMPD"/t.gta
+cmp "$TMPD"/z.gta "$TMPD"/t.gta
+
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -c uint8 -n5 > "$TMPD"/empty1.gta
 $GTA combine -m min "$TMPD"/empty0.gta "$TMPD"/empty0.gta > "$TMPD"/xempty0.gta
@@ -19,6 +19,21 @@ $GTA create -d 10,10 -c uint8 -v 117 "$TMPD"/b.gta
 $GTA component-compute -e 'c0=42' "$TMPD"/b.gta > "$TMPD"/c.gta
 cmp "$TMPD"/a.gta "$TMPD"/c.gta
 
+$GTA create -d 1500,2 -c uint8,float32 -v 7,0.5 "$TMPD"/d.gta
+$GTA create -d 1500,2 -c uint8,float32 -v 0,1 | $GTA fill -l 0,1 -h 1499,1 -v 1,2 > "$TMPD"/e.gta
+$GTA component-compute -e 'c0 = i1' -e 'c1 = c1 * 2 * (c0 + 1)' "$TMPD"/d.gta > "$TMPD"/f.gta
+cmp "$TMPD"/e.gta "$TMPD"/f.gta
+$GTA component-compute -j 3 -e 'c0 = i1' -e 'c1 = c1 * 2 * (c0 + 1)' "$TMPD"/d.gta > "$TMPD"/f.gta
+cmp "$TMPD"/e.gta "$TMPD"/f.gta
+
+$GTA component-compute -j 1 --seed=42 -e 'c0 = 255 * random()' -e 'c1 = drand48()' "$TMPD"/d.gta > "$TMPD"/g.gta
+$GTA component-compute -j 4 --seed=42 -e 'c0 = 255 * random()' -e 'c1 = drand48()' "$TMPD"/d.gta > "$TMPD"/h.gta
+cmp "$TMPD"/g.gta "$TMPD"/h.gta
+$GTA component-compute -j 2 -e 'srand48(i0), c1 = drand48()' "$TMPD"/d.gta | $GTA dimension-split -d 1 > "$TMPD"/i.gta
+$GTA stream-extract 0 "$TMPD"/i.gta > "$TMPD"/i0.gta
+$GTA stream-extract 1 "$TMPD"/i.gta > "$TMPD"/i1.gta
+cmp "$TMPD"/i0.gta "$TMPD"/i1.gta
+
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -c uint8 -n5 > "$TMPD"/empty1.gta
 $GTA component-compute -e '5' "$TMPD"/empty0.gta > "$TMPD"/xempty0.gta
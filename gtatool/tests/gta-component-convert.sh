@@ -17,6 +17,14 @@ $GTA create -d 10,10 -c float32,float32,float32 -v 42,42,42 "$TMPD"/b.gta
 $GTA component-convert -c float32,float32,float32 < "$TMPD"/a.gta > "$TMPD"/xb.gta
 cmp "$TMPD"/b.gta "$TMPD"/xb.gta
 
+$GTA create -d 100,300 -c uint8,int16,uint16,float32,float32 -v 255,-32768,65535,0.5,-1 "$TMPD"/c.gta
+$GTA create -d 100,300 -c float32,float64,float32,uint8,int16 -v 1,-1,1,127,-32768 "$TMPD"/d.gta
+$GTA component-convert -n -c float32,float64,float32,uint8,int16 "$TMPD"/c.gta > "$TMPD"/xd.gta
+cmp "$TMPD"/d.gta "$TMPD"/xd.gta
+$GTA create -d 100,300 -c float64,float32,int32,uint8,int16 -v 255,-32768,65535,0,-1 "$TMPD"/e.gta
+$GTA component-convert -c float64,float32,int32,uint8,int16 "$TMPD"/c.gta > "$TMPD"/xe.gta
+cmp "$TMPD"/e.gta "$TMPD"/xe.gta
+
 $GTA create -c uint8 -n5 > "$TMPD"/empty0.gta
 $GTA component-convert -c int16 "$TMPD"/empty0.gta > "$TMPD"/t.gta
 $GTA component-convert -c uint8 "$TMPD"/t.gta > "$TMPD"/xempty0.gta
@@ -10,6 +10,7 @@
 set -e
 
 TMPD="`mktemp -d tmp-\`basename $0 .sh\`.XXXXXX`"
+. "${srcdir:-.}"/fixtures.sh
 
 $GTA create -d 10,10 -c uint8  -v 0 "$TMPD"/a.gta
 $GTA create -d 10,10 -c uint16 -v 1 "$TMPD"/b.gta
@@ -28,6 +29,16 @@ cmp "$TMPD"/abcd.gta "$TMPD"/xabcd.gta
 cmp "$TMPD"/bd.gta "$TMPD"/xbd.gta
 cmp "$TMPD"/ab.gta "$TMPD"/xab.gta
 
+# Varying data, more elements than fit into one block
+fixture_ramp 700,500 uint8,int16,float32 > "$TMPD"/e.gta
+$GTA component-extract -k 0 "$TMPD"/e.gta > "$TMPD"/e0.gta
+$GTA component-extract -k 1,2 "$TMPD"/e.gta > "$TMPD"/e12.gta
+$GTA component-merge "$TMPD"/e0.gta "$TMPD"/e12.gta > "$TMPD"/xe.gta
+cmp "$TMPD"/e.gta "$TMPD"/xe.gta
+$GTA component-set -i 1 -v 5 "$TMPD"/e.gta > "$TMPD"/f.gta
+$GTA component-extract -d 1 "$TMPD"/e.gta | $GTA component-add -i 1 -c int16 -v 5 > "$TMPD"/xf.gta
+cmp "$TMPD"/f.gta "$TMPD"/xf.gta
+
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -c uint8 -n5 > "$TMPD"/empty1.gta
 $GTA create -c uint8,uint8 -n5 > "$TMPD"/empty2.gta
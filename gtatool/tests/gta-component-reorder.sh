@@ -10,6 +10,7 @@
 set -e
 
 TMPD="`mktemp -d tmp-\`basename $0 .sh\`.XXXXXX`"
+. "${srcdir:-.}"/fixtures.sh
 
 $GTA create -d 10,10 -c int8,int16,int32,int64 -v 0,1,2,3 "$TMPD"/a.gta
 $GTA create -d 10,10 -c int64,int32,int16,int8 -v 3,2,1,0 "$TMPD"/b.gta
@@ -23,6 +24,11 @@ cmp "$TMPD"/a.gta "$TMPD"/xa.gta
 cmp "$TMPD"/b.gta "$TMPD"/xb.gta
 cmp "$TMPD"/c.gta "$TMPD"/xc.gta
 
+# Varying data, more elements than fit into one block
+fixture_ramp 700,500 uint8,int16,float32 > "$TMPD"/d.gta
+$GTA component-reorder -i 2,0,1 "$TMPD"/d.gta | $GTA component-reorder -i 1,2,0 > "$TMPD"/xd.gta
+cmp "$TMPD"/d.gta "$TMPD"/xd.gta
+
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -c uint8,uint16 -n5 > "$TMPD"/empty1.gta
 $GTA create -c uint16,uint8 -n5 > "$TMPD"/empty2.gta
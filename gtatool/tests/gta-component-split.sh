@@ -10,6 +10,7 @@
 set -e
 
 TMPD="`mktemp -d tmp-\`basename $0 .sh\`.XXXXXX`"
+. "${srcdir:-.}"/fixtures.sh
 
 $GTA create -d 10,10 -c uint8  -v 0 "$TMPD"/a.gta
 $GTA create -d 10,10 -c uint16 -v 1 "$TMPD"/b.gta
@@ -26,6 +27,22 @@ $GTA component-split -d 0,3 "$TMPD"/all.gta > "$TMPD"/x12.gta
 cmp "$TMPD"/alls.gta "$TMPD"/xalls.gta
 cmp "$TMPD"/12.gta "$TMPD"/x12.gta
 
+# Non-seekable input, and several arrays with varying data in one file
+cat "$TMPD"/all.gta | $GTA component-split > "$TMPD"/xalls.gta
+cmp "$TMPD"/alls.gta "$TMPD"/xalls.gta
+cat "$TMPD"/all.gta | $GTA component-split -d 0,3 > "$TMPD"/x12.gta
+cmp "$TMPD"/12.gta "$TMPD"/x12.gta
+fixture_ramp 7,5 uint8,float32,int16 > "$TMPD"/e.gta
+$GTA stream-merge "$TMPD"/e.gta "$TMPD"/e.gta "$TMPD"/all.gta > "$TMPD"/eeall.gta
+$GTA component-extract -k 0 "$TMPD"/e.gta > "$TMPD"/e0.gta
+$GTA component-extract -k 1 "$TMPD"/e.gta > "$TMPD"/e1.gta
+$GTA component-extract -k 2 "$TMPD"/e.gta > "$TMPD"/e2.gta
+$GTA stream-merge "$TMPD"/e0.gta "$TMPD"/e1.gta "$TMPD"/e2.gta "$TMPD"/e0.gta "$TMPD"/e1.gta "$TMPD"/e2.gta "$TMPD"/alls.gta > "$TMPD"/eealls.gta
+$GTA component-split "$TMPD"/eeall.gta > "$TMPD"/xeealls.gta
+cmp "$TMPD"/eealls.gta "$TMPD"/xeealls.gta
+cat "$TMPD"/eeall.gta | $GTA component-split > "$TMPD"/xeealls.gta
+cmp "$TMPD"/eealls.gta "$TMPD"/xeealls.gta
+
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -c uint8,uint8 -n5 > "$TMPD"/empty1.gta
 $GTA create -c uint8 -n10 > "$TMPD"/empty2.gta
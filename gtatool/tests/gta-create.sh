@@ -25,4 +25,20 @@ LC_NUMERIC=C $GTA create -d 10 \
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -c uint8 -n5 > "$TMPD"/empty1.gta
 
+# Zero data written to a file (sparse) and to a pipe must be identical, and so
+# must large non-zero data written to a file and to a pipe
+$GTA create -d 1000,300 -c uint16,float32 -n 3 "$TMPD"/c0.gta
+$GTA create -d 1000,300 -c uint16,float32 -n 3 | cat > "$TMPD"/c1.gta
+cmp "$TMPD"/c0.gta "$TMPD"/c1.gta
+$GTA create -d 1000,300 -c uint16,float32 -v 7,0.5 -n 3 "$TMPD"/d0.gta
+$GTA create -d 1000,300 -c uint16,float32 -v 7,0.5 -n 3 | cat > "$TMPD"/d1.gta
+cmp "$TMPD"/d0.gta "$TMPD"/d1.gta
+$GTA fill -v 7,0.5 "$TMPD"/c0.gta > "$TMPD"/d2.gta
+cmp "$TMPD"/d0.gta "$TMPD"/d2.gta
+# Sparse zero data counts as written data
+$GTA --stats=json create -d 1000,1000 -c uint8 "$TMPD"/e0.gta 2> "$TMPD"/e0.json
+grep -q '"data_bytes_out": 1000000,' "$TMPD"/e0.json
+$GTA --stats=json create -d 1000,1000 -c uint8 2> "$TMPD"/e1.json | cat > /dev/null
+grep -q '"data_bytes_out": 1000000,' "$TMPD"/e1.json
+
 rm -r "$TMPD"
@@ -21,6 +21,59 @@ cmp "$TMPD"/c.gta "$TMPD"/d.gta
 $GTA diff -a "$TMPD"/b.gta "$TMPD"/a.gta > "$TMPD"/e.gta
 cmp "$TMPD"/c.gta "$TMPD"/e.gta
 
+# Statistics and quiet mode: exit status 0 for equal and 1 for different arrays
+$GTA diff -q "$TMPD"/a.gta "$TMPD"/a.gta
+if $GTA diff -q "$TMPD"/a.gta "$TMPD"/b.gta; then false; fi
+$GTA diff -s "$TMPD"/a.gta "$TMPD"/a.gta 2> "$TMPD"/s0.txt
+grep -q "differing elements: 0 of 100" "$TMPD"/s0.txt
+if $GTA diff -s "$TMPD"/a.gta "$TMPD"/b.gta 2> "$TMPD"/s1.txt; then false; fi
+grep -q "differing elements: 100 of 100" "$TMPD"/s1.txt
+grep -q "maximum absolute error = 18" "$TMPD"/s1.txt
+# Squares of large differences do not overflow, and no statistic is NaN
+$GTA create -d 10,10 -c float64 -v 1e200 "$TMPD"/h0.gta
+$GTA create -d 10,10 -c float64 -v 2e200 "$TMPD"/h1.gta
+$GTA fill -l 0,0 -h 9,4 -v 1e300 "$TMPD"/h1.gta > "$TMPD"/h2.gta
+if $GTA diff -s "$TMPD"/h0.gta "$TMPD"/h1.gta 2> "$TMPD"/h01.txt; then false; fi
+grep -q "root mean square error = 9.99999.*e+199" "$TMPD"/h01.txt
+grep -q "peak signal-to-noise ratio = 6.0205999" "$TMPD"/h01.txt
+if $GTA diff -j3 -s "$TMPD"/h0.gta "$TMPD"/h2.gta 2> "$TMPD"/h02.txt; then false; fi
+grep -q "root mean square error = 7.07106.*e+299" "$TMPD"/h02.txt
+if grep -q "nan\|inf" "$TMPD"/h01.txt "$TMPD"/h02.txt; then false; fi
+$GTA create -d 10,10 -c float64 -v -1e308 "$TMPD"/h3.gta
+$GTA create -d 10,10 -c float64 -v 1e308 "$TMPD"/h4.gta
+if $GTA diff -s "$TMPD"/h3.gta "$TMPD"/h4.gta 2> "$TMPD"/h34.txt; then false; fi
+if grep -q "nan" "$TMPD"/h34.txt; then false; fi
+# Exit status 2 for invalid command lines in these modes only, and no
+# warnings with -q
+set +e
+$GTA diff -q --no-such-option "$TMPD"/a.gta "$TMPD"/a.gta 2>/dev/null
+test $? = 2 || exit 1
+$GTA diff --no-such-option -s "$TMPD"/a.gta "$TMPD"/a.gta 2>/dev/null
+test $? = 2 || exit 1
+$GTA diff --no-such-option "$TMPD"/a.gta "$TMPD"/a.gta 2>/dev/null
+test $? = 1 || exit 1
+$GTA diff -j3 "$TMPD"/a.gta 2>/dev/null
+test $? = 1 || exit 1
+set -e
+$GTA stream-merge "$TMPD"/a.gta "$TMPD"/a.gta > "$TMPD"/aa.gta
+$GTA diff -q "$TMPD"/aa.gta "$TMPD"/a.gta 2> "$TMPD"/q0.txt
+test ! -s "$TMPD"/q0.txt
+$GTA diff -q "$TMPD"/a.gta "$TMPD"/aa.gta 2> "$TMPD"/q1.txt
+test ! -s "$TMPD"/q1.txt
+
+# Large arrays with several threads, and with overflow
+$GTA create -d 300,300 -c int8,uint16,float32 -v 100,5,1.5 "$TMPD"/p.gta
+$GTA create -d 300,300 -c int8,uint16,float32 -v -100,7,0.5 "$TMPD"/q.gta
+$GTA create -d 300,300 -c int8,uint16,float32 -v 127,2,1 "$TMPD"/pq.gta
+$GTA fill -l 10,10 -h 20,20 -v 1,1,1 "$TMPD"/q.gta > "$TMPD"/q1.gta
+if $GTA diff -a "$TMPD"/p.gta "$TMPD"/q.gta > "$TMPD"/r.gta 2>/dev/null; then false; fi
+$GTA diff -j3 -a -f "$TMPD"/p.gta "$TMPD"/q.gta > "$TMPD"/r.gta
+cmp "$TMPD"/pq.gta "$TMPD"/r.gta
+$GTA diff -j1 -s "$TMPD"/q.gta "$TMPD"/q1.gta 2> "$TMPD"/s2.txt || true
+$GTA diff -j3 -s "$TMPD"/q.gta "$TMPD"/q1.gta 2> "$TMPD"/s3.txt || true
+cmp "$TMPD"/s2.txt "$TMPD"/s3.txt
+grep -q "differing elements: 121 of 90000" "$TMPD"/s2.txt
+
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -c uint8 -n5 > "$TMPD"/empty1.gta
 $GTA diff "$TMPD"/empty0.gta "$TMPD"/empty0.gta > "$TMPD"/xempty0.gta
@@ -10,6 +10,7 @@
 set -e
 
 TMPD="`mktemp -d tmp-\`basename $0 .sh\`.XXXXXX`"
+. "${srcdir:-.}"/fixtures.sh
 
 $GTA dimension-add --help 2> "$TMPD"/help.txt
 
@@ -23,6 +24,12 @@ cmp "$TMPD"/xb.gta "$TMPD"/b.gta
 $GTA dimension-add -d 0 < "$TMPD"/a.gta > "$TMPD"/xc.gta
 cmp "$TMPD"/xc.gta "$TMPD"/c.gta
 
+fixture_ramp 3,2 uint8 > "$TMPD"/d.gta
+$GTA dimension-add -d 1 "$TMPD"/d.gta > "$TMPD"/e.gta
+fixture_ramp 3,1,2 uint8 | cmp - "$TMPD"/e.gta
+$GTA dimension-add -d 0 "$TMPD"/e.gta | $GTA dimension-flatten > "$TMPD"/xe.gta
+$GTA dimension-flatten "$TMPD"/d.gta | cmp - "$TMPD"/xe.gta
+
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -d 10,1 -n5 > "$TMPD"/empty1.gta
 $GTA create -c uint8 -n5 > "$TMPD"/empty2.gta
@@ -10,6 +10,7 @@
 set -e
 
 TMPD="`mktemp -d tmp-\`basename $0 .sh\`.XXXXXX`"
+. "${srcdir:-.}"/fixtures.sh
 
 $GTA dimension-flatten --help 2> "$TMPD"/help.txt
 
@@ -31,4 +32,9 @@ $GTA dimension-flatten "$TMPD"/empty3.gta > "$TMPD"/xempty3.gta
 cmp "$TMPD"/empty3.gta "$TMPD"/xempty3.gta
 $GTA dimension-flatten -p "$TMPD"/empty2.gta > "$TMPD"/x.gta
 
+fixture_ramp 3,5 uint8 > "$TMPD"/c.gta
+fixture_ramp 15 uint8 > "$TMPD"/d.gta
+$GTA dimension-flatten "$TMPD"/c.gta > "$TMPD"/xd.gta
+cmp "$TMPD"/xd.gta "$TMPD"/d.gta
+
 rm -r "$TMPD"
@@ -10,6 +10,7 @@
 set -e
 
 TMPD="`mktemp -d tmp-\`basename $0 .sh\`.XXXXXX`"
+. "${srcdir:-.}"/fixtures.sh
 
 $GTA dimension-merge --help 2> "$TMPD"/help.txt
 
@@ -21,4 +22,11 @@ $GTA create -d 5,3 -c uint8 -v 42 "$TMPD"/d.gta
 $GTA dimension-merge "$TMPD"/a.gta "$TMPD"/b.gta "$TMPD"/c.gta > "$TMPD"/xd.gta
 cmp "$TMPD"/xd.gta "$TMPD"/d.gta
 
+fixture_ramp 3 uint8 > "$TMPD"/e.gta
+fixture_ramp 3 uint8 3 > "$TMPD"/f.gta
+fixture_ramp 3 uint8 6 > "$TMPD"/g.gta
+fixture_ramp 3,3 uint8 > "$TMPD"/h.gta
+$GTA dimension-merge "$TMPD"/e.gta "$TMPD"/f.gta "$TMPD"/g.gta > "$TMPD"/xh.gta
+cmp "$TMPD"/xh.gta "$TMPD"/h.gta
+
 rm -r "$TMPD"
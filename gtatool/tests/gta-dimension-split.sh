@@ -10,6 +10,7 @@
 set -e
 
 TMPD="`mktemp -d tmp-\`basename $0 .sh\`.XXXXXX`"
+. "${srcdir:-.}"/fixtures.sh
 
 $GTA dimension-split --help 2> "$TMPD"/help.txt
 
@@ -30,4 +31,31 @@ $GTA create -n 3 -d 5 "$TMPD"/empty2.gta
 $GTA dimension-split "$TMPD"/empty1.gta > "$TMPD"/xempty2.gta
 cmp "$TMPD"/empty2.gta "$TMPD"/xempty2.gta
 
+$GTA create -d 4,3,5 -c uint8,int16 -v 0,0 \
+    | $GTA fill -l 1,0,0 -h 1,2,4 -v 7,-7 \
+    | $GTA fill -l 0,1,2 -h 3,1,3 -v 9,-9 \
+    | $GTA fill -l 2,0,4 -h 3,2,4 -v 11,-11 > "$TMPD"/e.gta
+sizes=(4 3 5)
+for d in 0 1 2; do
+    rm -f "$TMPD"/f.gta
+    for ((i = 0; i < ${sizes[$d]}; i++)); do
+        $GTA dimension-extract -d $d -i $i "$TMPD"/e.gta >> "$TMPD"/f.gta
+    done
+    $GTA dimension-split -d $d "$TMPD"/e.gta > "$TMPD"/xf.gta
+    cmp "$TMPD"/f.gta "$TMPD"/xf.gta
+    cat "$TMPD"/e.gta | $GTA dimension-split -d $d > "$TMPD"/yf.gta
+    cmp "$TMPD"/f.gta "$TMPD"/yf.gta
+done
+
+# Runs of 64 KiB, which are read directly from seekable input
+fixture_ramp 256,128,3,4 uint16 5 > "$TMPD"/g.gta
+rm -f "$TMPD"/h.gta
+for ((i = 0; i < 3; i++)); do
+    $GTA dimension-extract -d 2 -i $i "$TMPD"/g.gta >> "$TMPD"/h.gta
+done
+$GTA dimension-split -d 2 "$TMPD"/g.gta > "$TMPD"/xh.gta
+cmp "$TMPD"/h.gta "$TMPD"/xh.gta
+cat "$TMPD"/g.gta | $GTA dimension-split -d 2 > "$TMPD"/yh.gta
+cmp "$TMPD"/h.gta "$TMPD"/yh.gta
+
 rm -r "$TMPD"
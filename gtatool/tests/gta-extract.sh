@@ -10,6 +10,7 @@
 set -e
 
 TMPD="`mktemp -d tmp-\`basename $0 .sh\`.XXXXXX`"
+. "${srcdir:-.}"/fixtures.sh
 
 $GTA create -d 10,10 -c uint8 -v 42 "$TMPD"/a.gta
 $GTA create -d 5,5 -c uint8 -v 117 "$TMPD"/b.gta
@@ -17,5 +18,32 @@ $GTA fill -l 3,3 -h 7,7 -v 117 < "$TMPD"/a.gta > "$TMPD"/c.gta
 
 $GTA extract -l 3,3 -h 7,7 < "$TMPD"/c.gta > "$TMPD"/d.gta
 cmp "$TMPD"/b.gta "$TMPD"/d.gta
+$GTA extract -l 3,3 -h 7,7 "$TMPD"/c.gta > "$TMPD"/d.gta
+cmp "$TMPD"/b.gta "$TMPD"/d.gta
+
+$GTA create -d 20,30,40 -c uint8,int16 -v 1,2 "$TMPD"/e.gta
+$GTA fill -l 4,5,6 -h 12,25,30 -v 3,4 < "$TMPD"/e.gta > "$TMPD"/f.gta
+$GTA create -d 9,21,25 -c uint8,int16 -v 3,4 "$TMPD"/g.gta
+$GTA extract -l 4,5,6 -h 12,25,30 "$TMPD"/f.gta > "$TMPD"/h.gta
+cmp "$TMPD"/g.gta "$TMPD"/h.gta
+cat "$TMPD"/f.gta | $GTA extract -l 4,5,6 -h 12,25,30 > "$TMPD"/h.gta
+cmp "$TMPD"/g.gta "$TMPD"/h.gta
+
+# Data that differs in every byte, so that wrong offsets or element orders are
+# detected. The expected result is computed from the byte values of the
+# fixture_ramp input: the byte at offset b has the value (start + b) % 256.
+fixture_ramp 20,30,40 uint8,int16 7 > "$TMPD"/r.gta
+LC_ALL=C awk 'BEGIN {
+    for (z = 6; z <= 30; z++)
+        for (y = 5; y <= 25; y++)
+            for (x = 4; x <= 12; x++)
+                for (k = 0; k < 3; k++)
+                    printf "%c", (7 + 3 * (x + 20 * (y + 30 * z)) + k) % 256
+}' > "$TMPD"/s.raw
+$GTA from-raw -d 9,21,25 -c uint8,int16 "$TMPD"/s.raw | $GTA tag --unset-all > "$TMPD"/s.gta
+$GTA extract -l 4,5,6 -h 12,25,30 "$TMPD"/r.gta | $GTA tag --unset-all > "$TMPD"/t.gta
+cmp "$TMPD"/s.gta "$TMPD"/t.gta
+cat "$TMPD"/r.gta | $GTA extract -l 4,5,6 -h 12,25,30 | $GTA tag --unset-all > "$TMPD"/t.gta
+cmp "$TMPD"/s.gta "$TMPD"/t.gta
 
 rm -r "$TMPD"
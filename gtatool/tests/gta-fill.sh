@@ -17,6 +17,15 @@ $GTA create -d 10,10 -c uint8 -v 117 "$TMPD"/b.gta
 $GTA fill -l 0,0 -h 9,9 -v 117 < "$TMPD"/a.gta > "$TMPD"/c.gta
 cmp "$TMPD"/b.gta "$TMPD"/c.gta
 
+$GTA create -d 5,3 -c uint8 -v 42 "$TMPD"/d.gta
+$GTA create -d 5,3 -c uint8 -v 117 | $GTA set -i 0,0 -s "$TMPD"/d.gta "$TMPD"/b.gta > "$TMPD"/e.gta
+$GTA fill -l 5,0 -h 12,2 -v 117 < "$TMPD"/a.gta | $GTA fill -l 0,3 -h 9,9 -v 117 > "$TMPD"/f.gta
+cmp "$TMPD"/e.gta "$TMPD"/f.gta
+cp "$TMPD"/a.gta "$TMPD"/g.gta
+$GTA fill --in-place -l 5,0 -h 12,2 -v 117 "$TMPD"/g.gta
+$GTA fill --in-place -l 0,3 -h 9,9 -v 117 "$TMPD"/g.gta
+cmp "$TMPD"/e.gta "$TMPD"/g.gta
+
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -c uint8 -n5 > "$TMPD"/empty1.gta
 $GTA fill "$TMPD"/empty0.gta > "$TMPD"/xempty0.gta
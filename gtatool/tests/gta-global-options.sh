@@ -0,0 +1,81 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2014
+# Martin Lambers <marlam@marlam.de>
+#
+# Copying and distribution of this file, with or without modification, are
+# permitted in any medium without royalty provided the copyright notice and this
+# notice are preserved. This file is offered as-is, without any warranty.
+
+set -e
+
+TMPD="`mktemp -d tmp-\`basename $0 .sh\`.XXXXXX`"
+
+$GTA create -d 300,300 -c uint8,uint16 -v 1,2 "$TMPD"/l0.gta
+$GTA create -d 3,3 -c uint8 -v 3 "$TMPD"/l1.gta
+$GTA create -d 500,700 -c float32 -v 4 "$TMPD"/l2.gta
+$GTA stream-merge "$TMPD"/l0.gta "$TMPD"/l1.gta "$TMPD"/l2.gta "$TMPD"/l0.gta > "$TMPD"/l.gta
+
+# Statistics do not change the output
+$GTA --stats stream-extract 0,2- "$TMPD"/l.gta > "$TMPD"/sl.gta 2> "$TMPD"/stats.txt
+$GTA stream-extract 0,2- "$TMPD"/l.gta > "$TMPD"/xsl.gta
+cmp "$TMPD"/sl.gta "$TMPD"/xsl.gta
+grep -q 'stats: arrays: 4 read, 3 written' "$TMPD"/stats.txt
+$GTA -q --stats=json stream-extract 1 < "$TMPD"/l.gta > "$TMPD"/sl1.gta 2> "$TMPD"/stats.json
+cmp "$TMPD"/sl1.gta "$TMPD"/l1.gta
+grep -q '"arrays_in": 2, "arrays_out": 1,' "$TMPD"/stats.json
+
+# Global options can be given in any order
+for opts in "--stats -q" "-q --stats" "--stats -v -q" "--progress --stats -q"; do
+    $GTA $opts stream-extract 1 "$TMPD"/l.gta > "$TMPD"/ol1.gta 2> "$TMPD"/stats.txt
+    cmp "$TMPD"/ol1.gta "$TMPD"/l1.gta
+    grep -q 'stats: arrays: 2 read, 1 written' "$TMPD"/stats.txt
+done
+if $GTA --stats --unknown stream-extract 1 "$TMPD"/l.gta > /dev/null 2>&1; then false; fi
+
+# Only data that is skipped by seeking counts as skipped; data that is read to
+# skip it counts as input
+$GTA --stats=json stream-extract 1 "$TMPD"/l.gta 2> "$TMPD"/stats.json > /dev/null
+grep -q '"data_bytes_in": 9, "data_bytes_out": 9, "data_bytes_skipped": 270000,' "$TMPD"/stats.json
+cat "$TMPD"/l.gta | $GTA --stats=json stream-extract 1 2> "$TMPD"/stats.json > /dev/null
+grep -q '"data_bytes_in": 270009, "data_bytes_out": 9, "data_bytes_skipped": 0,' "$TMPD"/stats.json
+
+# Progress reports do not change the output; short runs report nothing
+$GTA --progress stream-extract 1 "$TMPD"/l.gta > "$TMPD"/pl1.gta 2> "$TMPD"/progress.txt
+cmp "$TMPD"/pl1.gta "$TMPD"/l1.gta
+test ! -s "$TMPD"/progress.txt
+
+# Progress counts each array once, from the tracked input only: the
+# percentages never decrease within an array, never exceed 100, and the
+# overall percentage matches the number of arrays done so far
+$GTA stream-merge "$TMPD"/l2.gta "$TMPD"/l2.gta "$TMPD"/l2.gta > "$TMPD"/l222.gta
+$GTA --progress=0 component-convert -c float64 "$TMPD"/l222.gta > /dev/null 2> "$TMPD"/progress.txt
+sed -n 's/^.*progress: arrays=\([0-9]*\) array=\([0-9.]*\)% done=\([0-9.]*\)%.*$/\1 \2 \3/p' \
+    "$TMPD"/progress.txt > "$TMPD"/progress-values.txt
+test "`wc -l < "$TMPD"/progress-values.txt`" -gt 3
+test "`tail -n 1 "$TMPD"/progress-values.txt`" = "3 100.0 100.0"
+awk 'BEGIN { last = 0 }
+    {
+        if ($2 > 100 || $3 > 100 || $3 < last) exit 1
+        expected = 100 * ($1 + ($2 < 100 ? $2 / 100 : 0)) / 3
+        if ($3 < expected - 1 || $3 > expected + 1) exit 1
+        last = $3
+    }' "$TMPD"/progress-values.txt
+# Commands without GTA input report the progress of their output
+$GTA to-raw "$TMPD"/l222.gta "$TMPD"/l222.raw
+$GTA --progress=0 from-raw -d 500,700 -c float32 -n 3 "$TMPD"/l222.raw > "$TMPD"/r222.gta 2> "$TMPD"/progress.txt
+$GTA tag --unset-all "$TMPD"/r222.gta | cmp - "$TMPD"/l222.gta
+sed -n 's/^.*progress: arrays=\([0-9]*\) array=\([0-9.]*\)%.*$/\1 \2/p' \
+    "$TMPD"/progress.txt > "$TMPD"/progress-values.txt
+test "`wc -l < "$TMPD"/progress-values.txt`" -gt 3
+test "`tail -n 1 "$TMPD"/progress-values.txt`" = "3 100.0"
+awk '{
+        done = 100 * $1 + ($2 < 100 ? $2 : 0)
+        if ($2 > 100 || done < last) exit 1
+        last = done
+    }' "$TMPD"/progress-values.txt
+$GTA --progress=0 create -d 300,300 -c uint8 -n 2 "$TMPD"/c2.gta 2> "$TMPD"/progress.txt
+grep -q 'progress: arrays=2 array=100.0%' "$TMPD"/progress.txt
+if $GTA --progress=x stream-extract 1 "$TMPD"/l.gta > /dev/null 2>&1; then false; fi
+
+rm -r "$TMPD"
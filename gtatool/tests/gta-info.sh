@@ -18,6 +18,25 @@ $GTA info --help 2> "$TMPD"/help.txt
 $GTA info "$TMPD"/a.gta "$TMPD"/a.gta "$TMPD"/a.gta 2> /dev/null
 $GTA info -s "$TMPD"/a.gta 2> /dev/null
 
+# Statistics must not depend on the number of threads, and must ignore
+# NO_DATA_VALUE
+$GTA create -d 300,300 -c uint8,float32 -v 3,0.25 "$TMPD"/b.gta
+$GTA fill -l 0,0 -h 99,99 -v 1,1.5 "$TMPD"/b.gta > "$TMPD"/c.gta
+$GTA info -j1 -s "$TMPD"/c.gta 2> "$TMPD"/s1.txt
+$GTA info -j3 -s "$TMPD"/c.gta 2> "$TMPD"/s3.txt
+cmp "$TMPD"/s1.txt "$TMPD"/s3.txt
+grep -q "sample mean = 2.7777777777777777" "$TMPD"/s1.txt
+$GTA tag --set-component=0,NO_DATA_VALUE=1 "$TMPD"/c.gta > "$TMPD"/d.gta
+$GTA info -s "$TMPD"/d.gta 2> "$TMPD"/s4.txt
+grep -q "minimum value = 3" "$TMPD"/s4.txt
+
+# Quantiles and histograms
+$GTA info --quantiles=0,0.5,0.99 --histogram=2 "$TMPD"/c.gta 2> "$TMPD"/s5.txt
+grep -q "quantile 0.5 = 3" "$TMPD"/s5.txt
+grep -q "quantile 0.5 = 0.25" "$TMPD"/s5.txt
+grep -q "\[1, 2): 10000" "$TMPD"/s5.txt
+grep -q "\[2, 3\]: 80000" "$TMPD"/s5.txt
+
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -c uint8 -n5 > "$TMPD"/empty1.gta
 $GTA info "$TMPD"/empty0.gta "$TMPD"/empty1.gta 2> /dev/null
@@ -10,6 +10,7 @@
 set -e
 
 TMPD="`mktemp -d tmp-\`basename $0 .sh\`.XXXXXX`"
+. "${srcdir:-.}"/fixtures.sh
 
 $GTA create -d 10,10 -c uint8 -v 42 "$TMPD"/a.gta
 $GTA create -d 10,10 -c uint8 -v 42 "$TMPD"/b.gta
@@ -19,6 +20,24 @@ $GTA create -d 10,30 -c uint8 -v 42 "$TMPD"/abc.gta
 $GTA merge -d 1 "$TMPD"/a.gta "$TMPD"/b.gta "$TMPD"/c.gta > "$TMPD"/d.gta
 cmp "$TMPD"/abc.gta "$TMPD"/d.gta
 
+fixture_ramp 3,2 uint8 > "$TMPD"/e.gta
+fixture_ramp 3,1 uint8 6 > "$TMPD"/f.gta
+fixture_ramp 3,3 uint8 9 > "$TMPD"/g.gta
+fixture_ramp 3,6 uint8 > "$TMPD"/h.gta
+$GTA merge -d 1 "$TMPD"/e.gta "$TMPD"/f.gta "$TMPD"/g.gta > "$TMPD"/xh.gta
+cmp "$TMPD"/xh.gta "$TMPD"/h.gta
+fixture_array 2,3 uint8 0 1 3 4 6 7 > "$TMPD"/i.gta
+fixture_array 1,3 uint8 2 5 8 > "$TMPD"/j.gta
+fixture_ramp 3,3 uint8 > "$TMPD"/k.gta
+$GTA merge -d 0 "$TMPD"/i.gta "$TMPD"/j.gta > "$TMPD"/xk.gta
+cmp "$TMPD"/xk.gta "$TMPD"/k.gta
+
+fixture_array 2,1,2 uint16 0 0 1 0 6 0 7 0 > "$TMPD"/l.gta
+fixture_array 2,2,2 uint16 2 0 3 0 4 0 5 0 8 0 9 0 10 0 11 0 > "$TMPD"/m.gta
+fixture_array 2,3,2 uint16 0 0 1 0 2 0 3 0 4 0 5 0 6 0 7 0 8 0 9 0 10 0 11 0 > "$TMPD"/n.gta
+$GTA merge -d 1 "$TMPD"/l.gta "$TMPD"/m.gta > "$TMPD"/xn.gta
+cmp "$TMPD"/xn.gta "$TMPD"/n.gta
+
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -d 20 -n5 > "$TMPD"/empty1.gta
 $GTA merge "$TMPD"/empty0.gta "$TMPD"/empty0.gta > "$TMPD"/xempty1.gta
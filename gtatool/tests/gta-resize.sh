@@ -24,6 +24,11 @@ cmp "$TMPD"/e.gta "$TMPD"/a.gta
 $GTA resize -d 10,10 -i -20,-20 -v 0 "$TMPD"/a.gta > "$TMPD"/f.gta
 cmp "$TMPD"/f.gta "$TMPD"/b.gta
 
+$GTA create -d 16,8 -c uint8,int16 -v 5,-5 "$TMPD"/g.gta
+$GTA create -d 10,10 -c uint8,int16 -v 1,2 | $GTA resize -d 16,8 -i 3,-4 -v 5,-5 > "$TMPD"/h.gta
+$GTA fill -l 3,0 -h 12,5 -v 1,2 < "$TMPD"/g.gta > "$TMPD"/i.gta
+cmp "$TMPD"/h.gta "$TMPD"/i.gta
+
 $GTA create -d 1,1 -n2 > "$TMPD"/empty0.gta
 $GTA create -d 2,2 -n2 > "$TMPD"/empty1.gta
 $GTA resize -d 2,2 "$TMPD"/empty0.gta > "$TMPD"/xempty1.gta
@@ -27,6 +27,9 @@ cmp "$TMPD"/g.gta "$TMPD"/a.gta
 
 $GTA set -s "$TMPD"/b.gta -i 3,7 "$TMPD"/c.gta > "$TMPD"/h.gta
 cmp "$TMPD"/h.gta "$TMPD"/d.gta
+cp "$TMPD"/c.gta "$TMPD"/i.gta
+$GTA set --in-place -s "$TMPD"/b.gta -i 3,7 "$TMPD"/i.gta
+cmp "$TMPD"/i.gta "$TMPD"/d.gta
 
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -c uint8 -n5 > "$TMPD"/empty1.gta
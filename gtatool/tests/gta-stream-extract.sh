@@ -39,4 +39,31 @@ cmp "$TMPD"/empty1.gta "$TMPD"/xempty1.gta
 $GTA stream-extract 0,4 "$TMPD"/empty2.gta > "$TMPD"/xempty3.gta
 cmp "$TMPD"/empty3.gta "$TMPD"/xempty3.gta
 
+# Reading stops after the last range: trailing garbage and missing files are never reached
+cp "$TMPD"/012.gta "$TMPD"/012-garbage.gta
+echo "garbage" >> "$TMPD"/012-garbage.gta
+$GTA stream-extract 0-2 "$TMPD"/012-garbage.gta "$TMPD"/nonexistent.gta > "$TMPD"/xg012.gta
+cmp "$TMPD"/xg012.gta "$TMPD"/012.gta
+$GTA stream-extract 1 "$TMPD"/0.gta "$TMPD"/1.gta "$TMPD"/nonexistent.gta > "$TMPD"/xg1.gta
+cmp "$TMPD"/xg1.gta "$TMPD"/1.gta
+cat "$TMPD"/012.gta "$TMPD"/012.gta | $GTA stream-extract 3 > "$TMPD"/xg3.gta
+cmp "$TMPD"/xg3.gta "$TMPD"/0.gta
+if $GTA stream-extract 0-3 "$TMPD"/012-garbage.gta > /dev/null 2>&1; then false; fi
+if $GTA stream-extract -d 0 "$TMPD"/012-garbage.gta > /dev/null 2>&1; then false; fi
+
+# Chained commands pass large arrays from pipe to pipe, with read/write and
+# (if enabled) inside the kernel
+$GTA create -d 300,300 -c uint8,uint16 -v 1,2 "$TMPD"/l0.gta
+$GTA create -d 3,3 -c uint8 -v 3 "$TMPD"/l1.gta
+$GTA create -d 500,700 -c float32 -v 4 "$TMPD"/l2.gta
+$GTA stream-merge "$TMPD"/l0.gta "$TMPD"/l1.gta "$TMPD"/l2.gta "$TMPD"/l0.gta > "$TMPD"/l.gta
+for s in 0 1; do
+    export GTATOOL_SPLICE=$s
+    cat "$TMPD"/l.gta | $GTA stream-extract 0- | $GTA stream-extract 0-3 | cat > "$TMPD"/xl.gta
+    cmp "$TMPD"/xl.gta "$TMPD"/l.gta
+    cat "$TMPD"/l.gta | $GTA stream-extract 1-2 | $GTA stream-extract -d 0 | cat > "$TMPD"/xl2.gta
+    cmp "$TMPD"/xl2.gta "$TMPD"/l2.gta
+done
+unset GTATOOL_SPLICE
+
 rm -r "$TMPD"
@@ -25,4 +25,16 @@ for i in 0 1 5 9; do
     cmp "$TMPD"/$i.gta "$TMPD"/y$i.gta
 done
 
+# Concurrent commands: output in input order, %I substitution, errors
+for i in 0 1 5 9; do
+    $GTA stream-foreach -j 3 "$GTA uncompress" "$TMPD"/$i.gta > "$TMPD"/x$i.gta
+    cmp "$TMPD"/$i.gta "$TMPD"/x$i.gta
+done
+$GTA stream-foreach "$GTA tag --set-global=X=%I" "$TMPD"/9.gta > "$TMPD"/t9.gta
+$GTA stream-foreach -j 4 "$GTA tag --set-global=X=%I" "$TMPD"/9.gta > "$TMPD"/xt9.gta
+cmp "$TMPD"/t9.gta "$TMPD"/xt9.gta
+$GTA stream-foreach -j 2 -n 2 "$GTA uncompress" "$TMPD"/9.gta > "$TMPD"/x9.gta
+cmp "$TMPD"/9.gta "$TMPD"/x9.gta
+if $GTA stream-foreach -j 4 "test %I -ne 3 && $GTA uncompress" "$TMPD"/9.gta > "$TMPD"/x9.gta 2> /dev/null; then false; fi
+
 rm -r "$TMPD"
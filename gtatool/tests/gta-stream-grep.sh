@@ -10,6 +10,7 @@
 set -e
 
 TMPD="`mktemp -d tmp-\`basename $0 .sh\`.XXXXXX`"
+. "${srcdir:-.}"/fixtures.sh
 
 $GTA stream-grep --help 2> "$TMPD"/help.txt
 
@@ -25,4 +26,46 @@ for i in 0 1 5 9; do
     cmp "$TMPD"/$i.gta "$TMPD"/y$i.gta
 done
 
+# Concurrent commands, seekable and non-seekable input
+$GTA stream-foreach "$GTA tag --set-global=X=%I" "$TMPD"/9.gta > "$TMPD"/t9.gta
+$GTA stream-grep "$GTA tag --get-global=X 2>&1 > /dev/null | grep -q 'X=[2357]$'" "$TMPD"/t9.gta > "$TMPD"/p9.gta
+for j in 1 4; do
+    $GTA stream-grep -j $j "$GTA tag --get-global=X 2>&1 > /dev/null | grep -q 'X=[2357]$'" "$TMPD"/t9.gta > "$TMPD"/xp9.gta
+    cmp "$TMPD"/p9.gta "$TMPD"/xp9.gta
+    cat "$TMPD"/t9.gta | $GTA stream-grep -j $j "$GTA tag --get-global=X 2>&1 > /dev/null | grep -q 'X=[2357]$'" > "$TMPD"/xp9.gta
+    cmp "$TMPD"/p9.gta "$TMPD"/xp9.gta
+done
+for i in 0 1 5 9; do
+    $GTA stream-grep -j 3 "$GTA uncompress" "$TMPD"/$i.gta > "$TMPD"/x$i.gta
+    cmp "$TMPD"/$i.gta "$TMPD"/x$i.gta
+done
+
+# Expressions
+$GTA stream-grep -e 'tag("X") % 2 == 1 && index < 6' "$TMPD"/t9.gta | $GTA tag --get-global=X 2> "$TMPD"/tags.txt > /dev/null
+test "`cut -d= -f2 "$TMPD"/tags.txt | tr '\n' ' '`" = "1 3 5 "
+$GTA stream-grep -e 'dim(0) == 10 && dimensions == 2 && !has_tag("Y") && tag("X") != ""' "$TMPD"/t9.gta > "$TMPD"/xt9.gta
+cmp "$TMPD"/t9.gta "$TMPD"/xt9.gta
+fixture_array 4,3 uint8,int8 0 0 1 255 2 254 3 253 3 0 4 255 5 254 6 253 6 0 7 255 8 254 9 253 | $GTA component-convert -c uint8,float32 > "$TMPD"/s.gta
+$GTA stream-merge "$TMPD"/s.gta "$TMPD"/t9.gta "$TMPD"/s.gta > "$TMPD"/sts.gta
+$GTA stream-merge "$TMPD"/s.gta "$TMPD"/s.gta > "$TMPD"/ss.gta
+$GTA stream-grep -e 'type(1) == "float32" && mean(0) == 4.5 && max(0) == 9 && min(1) == -3' "$TMPD"/sts.gta > "$TMPD"/xss.gta
+cmp "$TMPD"/ss.gta "$TMPD"/xss.gta
+cat "$TMPD"/sts.gta | $GTA stream-grep -e 'components == 2 && mean(1) < 0' > "$TMPD"/xss.gta
+cmp "$TMPD"/ss.gta "$TMPD"/xss.gta
+# The statistics agree with info: sample deviation, NO_DATA_VALUE ignored,
+# and independent of the number of threads
+$GTA stream-grep -e 'stddev(1) > 1.167 && stddev(1) < 1.168' "$TMPD"/s.gta > "$TMPD"/xs.gta
+cmp "$TMPD"/s.gta "$TMPD"/xs.gta
+$GTA tag --set-component=0,NO_DATA_VALUE=9 "$TMPD"/s.gta > "$TMPD"/sn.gta
+$GTA stream-grep -e 'max(0) == 8 && min(0) == 0' "$TMPD"/sn.gta > "$TMPD"/xsn.gta
+cmp "$TMPD"/sn.gta "$TMPD"/xsn.gta
+fixture_ramp 100,100 uint16,int8,float32 > "$TMPD"/r.gta
+MEAN="`$GTA info -s "$TMPD"/r.gta 2>&1 | sed -n 's/^.*sample mean = //p' | sed -n 3p`"
+DEV="`$GTA info -s "$TMPD"/r.gta 2>&1 | sed -n 's/^.*sample deviation = //p' | sed -n 1p`"
+for j in 1 3; do
+    $GTA stream-grep -j $j -e "mean(2) == $MEAN && stddev(0) == $DEV" "$TMPD"/r.gta > "$TMPD"/xr.gta
+    cmp "$TMPD"/r.gta "$TMPD"/xr.gta
+done
+if $GTA stream-grep -e 'dim(0) ==' "$TMPD"/sts.gta > /dev/null 2>&1; then false; fi
+
 rm -r "$TMPD"
@@ -41,4 +41,34 @@ cmp "$TMPD"/f000.gta "$TMPD"/empty3.gta
 cmp "$TMPD"/f001.gta "$TMPD"/empty3.gta
 cmp "$TMPD"/f002.gta "$TMPD"/empty3.gta
 
+# Concurrent writers, from a seekable file and from a pipe
+$GTA create -d 7,5 -c uint8,float32 -n 50 "$TMPD"/many.gta
+$GTA stream-split -j 4 "$TMPD"/m%2N.gta "$TMPD"/many.gta "$TMPD"/012.gta
+$GTA stream-split "$TMPD"/n%2N.gta "$TMPD"/many.gta "$TMPD"/012.gta
+cat "$TMPD"/many.gta "$TMPD"/012.gta | $GTA stream-split --jobs=3 "$TMPD"/p%2N.gta
+for i in `seq -w 0 52`; do
+    cmp "$TMPD"/m$i.gta "$TMPD"/n$i.gta
+    cmp "$TMPD"/p$i.gta "$TMPD"/n$i.gta
+done
+cmp "$TMPD"/m52.gta "$TMPD"/2.gta
+$GTA stream-split -j 2 "$TMPD"/q%1N.gta "$TMPD"/empty0.gta
+cmp "$TMPD"/q2.gta "$TMPD"/empty1.gta
+if $GTA stream-split -j 2 "$TMPD"/nonexistent/%1N.gta "$TMPD"/012.gta 2> /dev/null; then false; fi
+
+# The output of concurrent writers is accounted for in the statistics
+for j in 1 3; do
+    $GTA --stats=json stream-split -j $j "$TMPD"/s%2N.gta "$TMPD"/many.gta 2> "$TMPD"/stats$j.txt
+    grep -q '"arrays_out": 50,' "$TMPD"/stats$j.txt
+    grep -q '"data_bytes_out": 8750,' "$TMPD"/stats$j.txt
+done
+
+# Incomplete output files are removed
+head -c $((`wc -c < "$TMPD"/012.gta` - 10)) "$TMPD"/012.gta > "$TMPD"/trunc.gta
+for j in 1 2; do
+    if $GTA stream-split -j $j "$TMPD"/t$j%1N.gta "$TMPD"/trunc.gta 2> /dev/null; then false; fi
+    cmp "$TMPD"/t${j}0.gta "$TMPD"/0.gta
+    cmp "$TMPD"/t${j}1.gta "$TMPD"/1.gta
+    test ! -e "$TMPD"/t${j}2.gta
+done
+
 rm -r "$TMPD"